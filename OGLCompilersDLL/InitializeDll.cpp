@@ -40,25 +40,65 @@
 #include "../glslang/Include/InitializeGlobals.h"
 #include "../glslang/Public/ShaderLang.h"
 #include "../glslang/Include/PoolAlloc.h"
+#include "../glslang/Include/LockStats.h"
 
 namespace glslang {
 
+#ifdef GLSLANG_THREAD_LOCAL
+
+// With GLSLANG_THREAD_LOCAL, the per-thread state is a thread_local starting
+// out null in each thread, as InitThread() would set it, and owning nothing, so
+// threads need no set up or tear down, and none of these need a lock.
+
+bool InitProcess()
+{
+    return InitializePoolIndex();
+}
+
+bool InitThread()
+{
+    return true;
+}
+
+bool DetachThread()
+{
+    return true;
+}
+
+bool DetachProcess()
+{
+    return true;
+}
+
+#else
+
 OS_TLSIndex ThreadInitializeIndex = OS_INVALID_TLS_INDEX;
 
+namespace {
+
+// The OS global lock, as a lockable for GLSLANG_LOCK_GUARD.
+struct TGlobalLock {
+    void lock() { GetGlobalLock(); }
+    bool try_lock() { return TryGetGlobalLock(); }
+    void unlock() { ReleaseGlobalLock(); }
+};
+
+} // end anonymous namespace
+
 // Per-process initialization.
 // Needs to be called at least once before parsing, etc. is done.
 // Will also do thread initialization for the calling thread; other
 // threads will need to do that explicitly.
 bool InitProcess()
 {
-    glslang::GetGlobalLock();
+    TGlobalLock globalLock;
+    GLSLANG_LOCK_GUARD(guard, globalLock, ELockProcess);
 
     if (ThreadInitializeIndex != OS_INVALID_TLS_INDEX) {
         //
         // Function is re-entrant.
         //
 
-        glslang::ReleaseGlobalLock();
         return true;
     }
 
@@ -67,25 +107,21 @@ bool InitProcess()
     if (ThreadInitializeIndex == OS_INVALID_TLS_INDEX) {
         assert(0 && "InitProcess(): Failed to allocate TLS area for init flag");
 
-        glslang::ReleaseGlobalLock();
         return false;
     }
 
     if (! InitializePoolIndex()) {
         assert(0 && "InitProcess(): Failed to initialize global pool");
 
-        glslang::ReleaseGlobalLock();
         return false;
     }
 
     if (! InitThread()) {
         assert(0 && "InitProcess(): Failed to initialize thread");
 
-        glslang::ReleaseGlobalLock();
         return false;
     }
 
-    glslang::ReleaseGlobalLock();
     return true;
 }
 
@@ -162,4 +198,6 @@ bool DetachProcess()
     return success;
 }
 
+#endif
+
 } // end namespace glslang
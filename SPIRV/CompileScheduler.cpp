@@ -0,0 +1,194 @@
+//
+// Copyright (C) 2018 LunarG, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+//    Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//    Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//    Neither the name of 3Dlabs Inc. Ltd. nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+//
+// Asynchronous compiles on a pool of worker threads.  See CompileScheduler.h.
+//
+
+#include "CompileScheduler.h"
+#include "Logger.h"
+
+#include "../glslang/Include/PoolAlloc.h"
+#include "../OGLCompilersDLL/InitializeDll.h"
+
+#include <memory>
+
+namespace glslang {
+
+TCompileResult Compile(const TCompileJob& job)
+{
+    TCompileResult result;
+    if (job.resources == nullptr) {
+        result.log = "ERROR: no built-in resources given for " + job.name + "\n";
+        return result;
+    }
+    if (job.cancellation != nullptr && job.cancellation->stopRequested()) {
+        result.log = job.cancellation->isExpired() ? "ERROR: time budget exceeded\n" : "ERROR: compilation cancelled\n";
+        result.cancelled = true;
+        return result;
+    }
+
+    // The program has to go before the shader, so is declared after it.
+    TShader shader(job.stage);
+    shader.setCompilerContext(job.context);
+    const char* text = job.source.c_str();
+    const int length = (int)job.source.size();
+    const char* name = job.name.c_str();
+    shader.setStringsWithLengthsAndNames(&text, &length, &name, 1);
+    if (job.setup)
+        job.setup(shader);
+    shader.setCancellation(job.cancellation);
+    TProgram program;
+    program.setCompilerContext(job.context);
+
+    TShader::ForbidIncluder forbidIncluder;
+    TShader::Includer& includer = job.includer != nullptr ? *job.includer : forbidIncluder;
+    bool success = shader.parse(job.resources, job.defaultVersion, job.forwardCompatible, job.messages, includer);
+    result.log.append(shader.getInfoLog());
+    result.log.append(shader.getInfoDebugLog());
+
+    if (success) {
+        program.addShader(&shader);
+        success = program.link(job.messages) && program.mapIO();
+        result.log.append(program.getInfoLog());
+        result.log.append(program.getInfoDebugLog());
+    }
+
+    if (success && program.getIntermediate(job.stage) != nullptr) {
+        spv::SpvBuildLogger logger;
+        SpvOptions spvOptions = job.spvOptions;
+        spvOptions.cancellation = job.cancellation;
+        GlslangToSpv(*program.getIntermediate(job.stage), result.spirv, &logger, &spvOptions);
+        result.log.append(logger.getAllMessages());
+    }
+    result.success = success && ! result.spirv.empty();
+    result.cancelled = shader.wasCancelled() ||
+                       (success && result.spirv.empty() && job.cancellation != nullptr && job.cancellation->isStopped());
+
+    return result;
+}
+
+TCompileScheduler::TCompileScheduler(int numThreads) : sequence(0), outstanding(0), stopping(false)
+{
+    if (numThreads <= 0)
+        numThreads = (int)std::thread::hardware_concurrency();
+    if (numThreads <= 0)
+        numThreads = 4;
+
+    for (int t = 0; t < numThreads; ++t)
+        threads.push_back(std::thread(&TCompileScheduler::work, this));
+}
+
+TCompileScheduler::~TCompileScheduler()
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        stopping = true;
+    }
+    queued.notify_all();
+
+    for (auto it = threads.begin(); it != threads.end(); ++it)
+        it->join();
+}
+
+std::future<TCompileResult> TCompileScheduler::submit(const TCompileJob& job, TCompileBatch* batch)
+{
+    // The callback has to be copyable, so it shares the promise.
+    std::shared_ptr<std::promise<TCompileResult>> promise(new std::promise<TCompileResult>);
+    std::future<TCompileResult> future = promise->get_future();
+    submit(job, [promise](const TCompileResult& result) { promise->set_value(result); }, batch);
+
+    return future;
+}
+
+void TCompileScheduler::submit(const TCompileJob& job, const TCallback& done, TCompileBatch* batch)
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        TQueued entry = { job, done, batch, sequence++ };
+        jobs.push(entry);
+        ++outstanding;
+        if (batch != nullptr)
+            ++batch->outstanding;
+    }
+    queued.notify_one();
+}
+
+void TCompileScheduler::wait(TCompileBatch& batch)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [&batch]() { return batch.outstanding == 0; });
+}
+
+void TCompileScheduler::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this]() { return outstanding == 0; });
+}
+
+//
+// Worker thread: run jobs, best first, until stopping with nothing left to do.
+//
+void TCompileScheduler::work()
+{
+    InitThread();
+
+    for (;;) {
+        TQueued entry;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            queued.wait(lock, [this]() { return stopping || ! jobs.empty(); });
+            if (jobs.empty())
+                return;
+            entry = jobs.top();
+            jobs.pop();
+        }
+
+        TCompileResult result = Compile(entry.job);
+
+        // The job's pools are gone; don't leave this thread pointing at one.
+        SetThreadPoolAllocator(nullptr);
+
+        if (entry.done)
+            entry.done(result);
+
+        std::lock_guard<std::mutex> guard(mutex);
+        const bool batchDone = entry.batch != nullptr && --entry.batch->outstanding == 0;
+        if (--outstanding == 0 || batchDone)
+            idle.notify_all();
+    }
+}
+
+} // end namespace glslang
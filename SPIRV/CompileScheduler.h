@@ -0,0 +1,168 @@
+//
+// Copyright (C) 2018 LunarG, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+//    Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//    Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//    Neither the name of 3Dlabs Inc. Ltd. nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+//
+// Asynchronous compiles: a TCompileScheduler owns a pool of worker threads that
+// take TCompileJobs (GLSL or HLSL source and how to compile it) through
+// TShader::parse(), TProgram::link(), and GlslangToSpv(), handing back each
+// TCompileResult through a future or a completion callback.
+//
+// Workers do their own per-thread set up, so embedders don't need to follow
+// glslang's per-thread pool allocator rules for them.  The process must still
+// be initialized: call InitializeProcess() before making a scheduler, and
+// FinalizeProcess() only after destroying it.
+//
+
+#pragma once
+#ifndef CompileScheduler_H
+#define CompileScheduler_H
+
+#include "GlslangToSpv.h"
+#include "../glslang/Public/ShaderLang.h"
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace glslang {
+
+// One shader to compile to SPIR-V, as its own program.
+struct TCompileJob {
+    TCompileJob() : stage(EShLangVertex), resources(nullptr), defaultVersion(100), forwardCompatible(false),
+                    messages(EShMsgDefault), includer(nullptr), cancellation(nullptr), context(nullptr),
+                    priority(0) { }
+
+    EShLanguage stage;
+    std::string name;                 // source name, for messages
+    std::string source;
+    TMacroDedupVariants::TSetup setup; // optional further set up of the TShader (environment, entry point, ...)
+    const TBuiltInResource* resources;  // required; must outlive the job
+    int defaultVersion;
+    bool forwardCompatible;
+    EShMessages messages;
+    TShader::Includer* includer;      // optional; jobs run concurrently, so it must be thread safe
+    SpvOptions spvOptions;
+    TCancellation* cancellation;      // optional; stops the job early, or keeps it from starting
+    TCompilerContext* context;        // optional; caches to share with other jobs, must outlive the job
+    int priority;                     // higher priorities are started first
+};
+
+struct TCompileResult {
+    TCompileResult() : success(false), cancelled(false) { }
+
+    bool success;                     // compiled, linked, and translated to SPIR-V
+    bool cancelled;                   // stopped by the job's cancellation (or deadline)
+    std::string log;                  // info logs and SPIR-V builder messages
+    std::vector<unsigned int> spirv;
+};
+
+// Jobs submitted together, to wait for apart from whatever else the scheduler
+// is running.  Use a batch with just one scheduler, and keep it until its jobs
+// are done.
+class TCompileBatch {
+public:
+    TCompileBatch() : outstanding(0) { }
+
+protected:
+    friend class TCompileScheduler;
+    int outstanding;                  // submitted but not yet finished; guarded by the scheduler's mutex
+
+private:
+    TCompileBatch(const TCompileBatch&);
+    TCompileBatch& operator=(const TCompileBatch&);
+};
+
+class TCompileScheduler {
+public:
+    typedef std::function<void(const TCompileResult&)> TCallback;
+
+    // 0 threads means one per hardware thread.
+    explicit TCompileScheduler(int numThreads = 0);
+    // Finishes all submitted jobs first.
+    virtual ~TCompileScheduler();
+
+    // A job given a 'batch' is counted in it until done; see wait(batch).
+    std::future<TCompileResult> submit(const TCompileJob&, TCompileBatch* batch = nullptr);
+    // 'done' is called on the worker thread that ran the job.
+    void submit(const TCompileJob&, const TCallback& done, TCompileBatch* batch = nullptr);
+
+    // Wait for every job submitted so far with 'batch' to finish.
+    void wait(TCompileBatch& batch);
+    // Wait for every job submitted so far, by any caller, to finish.
+    void wait();
+
+    int getNumThreads() const { return (int)threads.size(); }
+
+protected:
+    struct TQueued {
+        TCompileJob job;
+        TCallback done;
+        TCompileBatch* batch;
+        unsigned long long sequence;  // breaks priority ties in submission order
+        bool operator<(const TQueued& rhs) const
+        {
+            // priority_queue pops the greatest
+            return job.priority != rhs.job.priority ? job.priority < rhs.job.priority
+                                                    : sequence > rhs.sequence;
+        }
+    };
+
+    void work();
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable queued;   // a job was queued, or stopping
+    std::condition_variable idle;     // 'outstanding', or that of a batch, dropped to 0
+    std::priority_queue<TQueued> jobs;
+    unsigned long long sequence;
+    int outstanding;                  // submitted but not yet finished
+    bool stopping;
+
+private:
+    TCompileScheduler(const TCompileScheduler&);
+    TCompileScheduler& operator=(const TCompileScheduler&);
+};
+
+// Run one job on the calling thread; what the scheduler's workers do.
+TCompileResult Compile(const TCompileJob&);
+
+} // end namespace glslang
+
+#endif // CompileScheduler_H
@@ -1045,8 +1045,10 @@ TGlslangToSpvTraverser::TGlslangToSpvTraverser(unsigned int spvVersion, const gl
         }
         if (glslangIntermediate->getSpv().spv < 0x00010100 && (int)processes.size() > 0)
             text.append("#line 1\n");
-        text.append(glslangIntermediate->getSourceText());
         builder.setSourceText(text);
+        const auto& sourceText = glslangIntermediate->getSourceText();
+        for (auto piece = sourceText.begin(); piece != sourceText.end(); ++piece)
+            builder.addSourceText(piece->first, piece->second);
     }
     stdBuiltins = builder.import("GLSL.std.450");
     builder.setMemoryModel(spv::AddressingModelLogical, spv::MemoryModelGLSL450);
@@ -1726,6 +1728,9 @@ bool TGlslangToSpvTraverser::visitAggregate(glslang::TVisit visit, glslang::TInt
     }
     case glslang::EOpFunction:
         if (visit == glslang::EvPreVisit) {
+            // Once stopped, skip the remaining functions; nothing will be output.
+            if (options.cancellation != nullptr && options.cancellation->stopRequested())
+                return false;
             if (isShaderEntryPoint(node)) {
                 inEntryPoint = true;
                 builder.setBuildPoint(shaderEntry->getLastBlock());
@@ -6973,10 +6978,18 @@ void GlslangToSpv(const glslang::TIntermediate& intermediate, std::vector<unsign
 
     glslang::GetThreadPoolAllocator().push();
 
+    glslang::TPhaseTimer translateTimer(options->phaseTimes ? &options->phaseTimes->spirv : nullptr);
     TGlslangToSpvTraverser it(intermediate.getSpv().spv, &intermediate, logger, *options);
     root->traverse(&it);
+    if (options->cancellation != nullptr && options->cancellation->isStopped()) {
+        logger->error(options->cancellation->isExpired() ? "time budget exceeded" : "compilation cancelled");
+        spirv.clear();
+        glslang::GetThreadPoolAllocator().pop();
+        return;
+    }
     it.finishSpv();
     it.dumpSpv(spirv);
+    translateTimer.stop();
 
 #if ENABLE_OPT
     // If from HLSL, run spirv-opt to "legalize" the SPIR-V for Vulkan
@@ -6984,6 +6997,7 @@ void GlslangToSpv(const glslang::TIntermediate& intermediate, std::vector<unsign
     if ((intermediate.getSource() == EShSourceHlsl ||
                 options->optimizeSize) &&
             !options->disableOptimizer) {
+        glslang::TPhaseTimer optimizeTimer(options->phaseTimes ? &options->phaseTimes->optimize : nullptr);
         spv_target_env target_env = SPV_ENV_UNIVERSAL_1_2;
 
         spvtools::Optimizer optimizer(target_env);
@@ -7028,6 +7042,16 @@ void GlslangToSpv(const glslang::TIntermediate& intermediate, std::vector<unsign
     }
 #endif
 
+#ifdef GLSLANG_COMPILE_STATS
+    if (options->compileStats != nullptr && spirv.size() > 5) {
+        options->compileStats->spvIds += spirv[3];
+        unsigned int wordCount;
+        for (size_t word = 5; word < spirv.size() && (wordCount = spirv[word] >> spv::WordCountShift) > 0;
+             word += wordCount)
+            ++options->compileStats->spvInstructions;
+    }
+#endif
+
     glslang::GetThreadPoolAllocator().pop();
 }
 
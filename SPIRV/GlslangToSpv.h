@@ -47,12 +47,20 @@
 
 namespace glslang {
 
+struct TPhaseTimes;
+struct TCompileStats;
+class TCancellation;
+
 struct SpvOptions {
     SpvOptions() : generateDebugInfo(false), disableOptimizer(true),
-        optimizeSize(false) { }
+        optimizeSize(false), phaseTimes(nullptr), compileStats(nullptr),
+        cancellation(nullptr) { }
     bool generateDebugInfo;
     bool disableOptimizer;
     bool optimizeSize;
+    TPhaseTimes* phaseTimes;  // if not null, GlslangToSpv() adds its 'spirv' and 'optimize' times here
+    TCompileStats* compileStats;  // if not null, GlslangToSpv() adds its 'spv' counts here
+    TCancellation* cancellation;  // if not null, can stop GlslangToSpv() early, leaving no SPIR-V
 };
 
 void GetSpirvVersion(std::string&);
@@ -0,0 +1,334 @@
+//
+// Copyright (C) 2018 LunarG, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+//    Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//    Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//    Neither the name of 3Dlabs Inc. Ltd. nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+#include "SPVCompress.h"
+#include "spirv.hpp"
+#include "doc.h"
+
+#include <algorithm>
+
+namespace {
+
+    typedef std::uint32_t spirword_t;
+
+    const int headerSize = 5; // SPIR header = 5 words
+
+    // Opcodes that get a single-byte encoding when their word count is 1..8.
+    // Ordered roughly by frequency in shipped shaders; at most 31 entries fit.
+    const spv::Op frequentOps[] = {
+        spv::OpLoad,             spv::OpStore,               spv::OpAccessChain,
+        spv::OpVariable,         spv::OpLabel,               spv::OpBranch,
+        spv::OpBranchConditional,spv::OpReturn,              spv::OpFunctionEnd,
+        spv::OpDecorate,         spv::OpMemberDecorate,      spv::OpName,
+        spv::OpMemberName,       spv::OpConstant,            spv::OpTypePointer,
+        spv::OpCompositeExtract, spv::OpCompositeConstruct,  spv::OpVectorShuffle,
+        spv::OpFAdd,             spv::OpFMul,                spv::OpFSub,
+        spv::OpIAdd,             spv::OpFunctionCall,        spv::OpSelectionMerge,
+        spv::OpLoopMerge,        spv::OpImageSampleImplicitLod, spv::OpDot,
+        spv::OpVectorTimesScalar,spv::OpMatrixTimesVector,   spv::OpExtInst,
+        spv::OpTypeVector,
+    };
+
+    const int numFrequentOps  = int(sizeof(frequentOps) / sizeof(frequentOps[0]));
+    const int maxPackedCount  = 8;                              // word counts 1..8 pack
+    const int escapeByte      = numFrequentOps * maxPackedCount; // first non-packed value
+
+    static_assert(escapeByte < 256, "packed opcode table too large");
+
+    int frequentOpIndex(spv::Op opCode)
+    {
+        for (int i = 0; i < numFrequentOps; ++i)
+            if (frequentOps[i] == opCode)
+                return i;
+        return -1;
+    }
+
+    // Word positions (relative to instruction start) of the result Id, and of the first
+    // word to copy raw.  0 means "none".  Only depends on the opcode, so the encoder and
+    // decoder always agree.
+    void operandLayout(spv::Op opCode, unsigned& resultPos, unsigned& rawPos)
+    {
+        const spv::InstructionParameters& desc = spv::InstructionDesc[opCode];
+
+        unsigned word = 1;
+        if (desc.hasType())
+            ++word;
+
+        resultPos = desc.hasResult() ? word++ : 0;
+        rawPos    = 0;
+
+        for (int op = 0; op < desc.operands.getNum(); ++op, ++word) {
+            switch (desc.operands.getClass(op)) {
+            case spv::OperandLiteralString:
+            case spv::OperandOptionalLiteralString:
+                rawPos = word;
+                return;
+
+            // Anything variable length ends the fixed prefix; strings can't follow these.
+            case spv::OperandVariableIds:
+            case spv::OperandVariableLiterals:
+            case spv::OperandVariableIdLiteral:
+            case spv::OperandVariableLiteralId:
+            case spv::OperandExecutionMode:
+                return;
+
+            default:
+                break;
+            }
+        }
+    }
+
+    void putVarint(std::vector<std::uint8_t>& out, spirword_t value)
+    {
+        while (value >= 0x80) {
+            out.push_back(std::uint8_t(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(std::uint8_t(value));
+    }
+
+    void putRaw(std::vector<std::uint8_t>& out, spirword_t value)
+    {
+        out.push_back(std::uint8_t(value));
+        out.push_back(std::uint8_t(value >> 8));
+        out.push_back(std::uint8_t(value >> 16));
+        out.push_back(std::uint8_t(value >> 24));
+    }
+
+    // Byte reader with sticky failure on truncation, so callers can check once per instruction.
+    class reader_t {
+    public:
+        reader_t(const std::uint8_t* data, size_t size) : pos(data), end(data + size), failed(false) { }
+
+        bool atEnd() const { return pos == end; }
+        bool fail()  const { return failed; }
+
+        std::uint8_t byte()
+        {
+            if (pos == end) {
+                failed = true;
+                return 0;
+            }
+            return *pos++;
+        }
+
+        spirword_t varint()
+        {
+            spirword_t value = 0;
+            for (int shift = 0; shift < 35; shift += 7) {
+                const std::uint8_t b = byte();
+                // The fifth byte only has the top 4 bits of a word to give
+                if (shift == 28 && (b & 0xf0) != 0)
+                    break;
+                value |= spirword_t(b & 0x7f) << shift;
+                if ((b & 0x80) == 0)
+                    return value;
+            }
+            failed = true;
+            return 0;
+        }
+
+        spirword_t raw()
+        {
+            if (end - pos < 4) {
+                failed = true;
+                pos = end;
+                return 0;
+            }
+            const spirword_t value = spirword_t(pos[0])       | (spirword_t(pos[1]) << 8) |
+                                     (spirword_t(pos[2]) << 16) | (spirword_t(pos[3]) << 24);
+            pos += 4;
+            return value;
+        }
+
+    private:
+        const std::uint8_t* pos;
+        const std::uint8_t* end;
+        bool failed;
+    };
+
+    spirword_t zigzag(spirword_t delta)   { return (delta << 1) ^ spirword_t(std::int32_t(delta) >> 31); }
+    spirword_t unzigzag(spirword_t value) { return (value >> 1) ^ (0u - (value & 1)); }
+
+} // anonymous namespace
+
+namespace spv {
+
+    const std::uint32_t spirvcompress_t::magic = 0x5a565053; // "SPVZ", little endian
+    const std::uint32_t spirvcompress_t::version = 1;
+
+    bool spirvcompress_t::isCompressed(const std::uint8_t* data, size_t size)
+    {
+        return size >= 4 && reader_t(data, size).raw() == magic;
+    }
+
+    bool spirvcompress_t::compress(const std::vector<std::uint32_t>& spv, std::vector<std::uint8_t>& out)
+    {
+        out.clear();
+
+        if (spv.size() < size_t(headerSize) || spv[0] != spv::MagicNumber)
+            return false;
+
+        // Set up opcode tables from SpvDoc
+        spv::Parameterize();
+
+        out.reserve(spv.size() * 2); // initial estimate; can grow if needed.
+
+        putRaw(out, magic);
+        putRaw(out, version);
+        putVarint(out, spirword_t(spv.size()));
+        for (int w = 0; w < headerSize; ++w)
+            putVarint(out, spv[w]);
+
+        spirword_t lastResult = 0;
+
+        for (size_t word = headerSize; word < spv.size(); ) {
+            const unsigned wordCount = spv[word] >> spv::WordCountShift;
+            const spv::Op  opCode    = spv::Op(spv[word] & spv::OpCodeMask);
+
+            if (wordCount == 0 || word + wordCount > spv.size()) {
+                out.clear();
+                return false;
+            }
+
+            const int opIndex = frequentOpIndex(opCode);
+            if (opIndex >= 0 && wordCount <= unsigned(maxPackedCount)) {
+                out.push_back(std::uint8_t(opIndex * maxPackedCount + wordCount - 1));
+            } else {
+                out.push_back(std::uint8_t(escapeByte));
+                putVarint(out, opCode);
+                putVarint(out, wordCount);
+            }
+
+            unsigned resultPos, rawPos;
+            operandLayout(opCode, resultPos, rawPos);
+            if (rawPos == 0)
+                rawPos = wordCount;
+
+            for (unsigned op = 1; op < wordCount; ++op) {
+                const spirword_t value = spv[word + op];
+
+                if (op >= rawPos) {
+                    putRaw(out, value);
+                } else if (op == resultPos) {
+                    putVarint(out, zigzag(value - lastResult - 1));
+                    lastResult = value;
+                } else {
+                    putVarint(out, value);
+                }
+            }
+
+            word += wordCount;
+        }
+
+        return true;
+    }
+
+    bool spirvcompress_t::decompress(const std::uint8_t* data, size_t size, std::vector<std::uint32_t>& spv)
+    {
+        spv.clear();
+
+        if (!isCompressed(data, size))
+            return false;
+
+        // Set up opcode tables from SpvDoc
+        spv::Parameterize();
+
+        reader_t in(data + 4, size - 4);
+
+        if (in.raw() != version)
+            return false;
+
+        const spirword_t totalWords = in.varint();
+        if (in.fail() || totalWords < spirword_t(headerSize))
+            return false;
+
+        // Don't trust the count for allocation beyond what the input could possibly hold.
+        spv.reserve(std::min<size_t>(totalWords, size));
+
+        for (int w = 0; w < headerSize; ++w)
+            spv.push_back(in.varint());
+
+        spirword_t lastResult = 0;
+
+        while (!in.atEnd() && !in.fail()) {
+            const std::uint8_t opByte = in.byte();
+
+            spv::Op  opCode;
+            unsigned wordCount;
+
+            if (opByte < escapeByte) {
+                opCode    = frequentOps[opByte / maxPackedCount];
+                wordCount = opByte % maxPackedCount + 1;
+            } else if (opByte == escapeByte) {
+                opCode    = spv::Op(in.varint());
+                wordCount = in.varint();
+            } else {
+                break; // unknown opbyte
+            }
+
+            if (in.fail() || wordCount == 0 || (opCode & ~spv::OpCodeMask) != 0 ||
+                (wordCount >> 16) != 0 || spv.size() + wordCount > totalWords)
+                break;
+
+            unsigned resultPos, rawPos;
+            operandLayout(opCode, resultPos, rawPos);
+            if (rawPos == 0)
+                rawPos = wordCount;
+
+            spv.push_back((wordCount << spv::WordCountShift) | opCode);
+
+            for (unsigned op = 1; op < wordCount; ++op) {
+                if (op >= rawPos) {
+                    spv.push_back(in.raw());
+                } else if (op == resultPos) {
+                    lastResult = lastResult + 1 + unzigzag(in.varint());
+                    spv.push_back(lastResult);
+                } else {
+                    spv.push_back(in.varint());
+                }
+            }
+        }
+
+        if (in.fail() || !in.atEnd() || spv.size() != totalWords) {
+            spv.clear();
+            return false;
+        }
+
+        return true;
+    }
+
+} // namespace spv
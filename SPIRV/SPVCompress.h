@@ -0,0 +1,93 @@
+//
+// Copyright (C) 2018 LunarG, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+//    Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//    Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//    Neither the name of 3Dlabs Inc. Ltd. nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+#ifndef SPIRVCOMPRESS_H
+#define SPIRVCOMPRESS_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace spv {
+
+// Compact, lossless byte encoding for SPIR-V modules.  It is meant to be applied after
+// spirvbin_t::remap(), which makes Ids small and similar across modules, but works on
+// any valid word stream.  decompress(compress(x)) reproduces x word for word.
+//
+// Layout:
+//
+//   stream      := magic(4 bytes) version(4 bytes) varint(word count) varint(header word) x 5
+//                  instruction*
+//   instruction := opbyte [varint(opcode) varint(word count)] operand*
+//
+// The opbyte packs one of a small table of frequent opcodes together with a word count
+// of 1..8 into a single byte; anything else is escaped and spelled out.  Operand words
+// are unsigned LEB128 varints, except:
+//
+//   - the result Id is a zigzag delta from (previous result Id + 1), so Ids assigned in
+//     order cost one byte;
+//   - everything from the first literal string onward is copied as raw 32-bit words,
+//     because text does not shrink as varints.
+//
+// Which words are result Ids or strings is derived from the opcode alone, via the
+// InstructionDesc tables, so the decoder never needs to inspect operand values.
+//
+// The magic and version are little-endian 32-bit words.  A decoder only accepts the
+// version it was written for, so any change to the layout or the opcode table must
+// bump it.
+class spirvcompress_t
+{
+public:
+    // Leading 4 bytes of a compressed stream: "SPVZ"
+    static const std::uint32_t magic;
+
+    // The format version, the next 4 bytes
+    static const std::uint32_t version;
+
+    // True if the given bytes start with a compressed stream header
+    static bool isCompressed(const std::uint8_t* data, size_t size);
+
+    // Encode a SPIR-V word stream.  Returns false if the stream is malformed.
+    static bool compress(const std::vector<std::uint32_t>& spv, std::vector<std::uint8_t>& out);
+
+    // Decode a compressed byte stream back to SPIR-V words.  Returns false (and leaves
+    // 'spv' empty) if the stream is of another version, truncated, or otherwise malformed.
+    static bool decompress(const std::uint8_t* data, size_t size, std::vector<std::uint32_t>& spv);
+};
+
+} // namespace spv
+
+#endif // SPIRVCOMPRESS_H
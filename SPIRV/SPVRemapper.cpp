@@ -42,6 +42,8 @@
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cstring>
 #include "../glslang/Include/Common.h"
 
 namespace spv {
@@ -127,38 +129,6 @@ namespace spv {
         }
     }
 
-    // Return the size of a type in 32-bit words.  This currently only
-    // handles ints and floats, and is only invoked by queries which must be
-    // integer types.  If ever needed, it can be generalized.
-    unsigned spirvbin_t::typeSizeInWords(spv::Id id) const
-    {
-        const unsigned typeStart = idPos(id);
-        const spv::Op  opCode    = asOpCode(typeStart);
-
-        if (errorLatch)
-            return 0;
-
-        switch (opCode) {
-        case spv::OpTypeInt:   // fall through...
-        case spv::OpTypeFloat: return (spv[typeStart+2]+31)/32;
-        default:
-            return 0;
-        }
-    }
-
-    // Looks up the type of a given const or variable ID, and
-    // returns its size in 32-bit words.
-    unsigned spirvbin_t::idTypeSizeInWords(spv::Id id) const
-    {
-        const auto tid_it = idTypeSizeMap.find(id);
-        if (tid_it == idTypeSizeMap.end()) {
-            error("type size for ID not found");
-            return 0;
-        }
-
-        return tid_it->second;
-    }
-
     // Is this an opcode we should remove when using --strip?
     bool spirvbin_t::isStripOp(spv::Op opCode) const
     {
@@ -254,6 +224,16 @@ namespace spv {
         return id;
     }
 
+    spv::Id spirvbin_t::nextUnusedHashedId(spv::Id id)
+    {
+        const spv::Id newId = nextUnusedId(id);
+
+        if (newId != id && curStats != nullptr)
+            ++curStats->collisions;
+
+        return newId;
+    }
+
     spv::Id spirvbin_t::localId(spv::Id id, spv::Id newId)
     {
         //assert(id != spv::NoResult && newId != spv::NoResult);
@@ -287,6 +267,9 @@ namespace spv {
             msg(4, 4, std::string("map: ") + std::to_string(id) + " -> " + std::to_string(newId));
             setMapped(newId);
             largestNewId = std::max(largestNewId, newId);
+
+            if (curStats != nullptr)
+                ++curStats->idsMapped;
         }
 
         return idMapL[id] = newId;
@@ -415,6 +398,9 @@ namespace spv {
 
         idMapL.resize(bound(), unused);
 
+        // Index instructions and their ID operands; every later process() walks this
+        parser.parse(spv.data(), spv.size());
+
         int         fnStart = 0;
         spv::Id     fnRes   = spv::NoResult;
 
@@ -427,19 +413,16 @@ namespace spv {
                 if (spv::InstructionDesc[opCode].hasType())
                     typeId = asId(word++);
 
-                // If there's a result ID, remember the size of its type
+                // If there's a result ID, its type must already be defined
                 if (spv::InstructionDesc[opCode].hasResult()) {
                     const spv::Id resultId = asId(word++);
                     idPosR[resultId] = start;
 
                     if (typeId != spv::NoResult) {
-                        const unsigned idTypeSize = typeSizeInWords(typeId);
+                        idPos(typeId);
 
                         if (errorLatch)
                             return false;
-
-                        if (idTypeSize != 0)
-                            idTypeSizeMap[resultId] = idTypeSize;
                     }
                 }
 
@@ -512,164 +495,6 @@ namespace spv {
         }
     }
 
-    int spirvbin_t::processInstruction(unsigned word, instfn_t instFn, idfn_t idFn)
-    {
-        const auto     instructionStart = word;
-        const unsigned wordCount = asWordCount(instructionStart);
-        const int      nextInst  = word++ + wordCount;
-        spv::Op  opCode    = asOpCode(instructionStart);
-
-        if (nextInst > int(spv.size())) {
-            error("spir instruction terminated too early");
-            return -1;
-        }
-
-        // Base for computing number of operands; will be updated as more is learned
-        unsigned numOperands = wordCount - 1;
-
-        if (instFn(opCode, instructionStart))
-            return nextInst;
-
-        // Read type and result ID from instruction desc table
-        if (spv::InstructionDesc[opCode].hasType()) {
-            idFn(asId(word++));
-            --numOperands;
-        }
-
-        if (spv::InstructionDesc[opCode].hasResult()) {
-            idFn(asId(word++));
-            --numOperands;
-        }
-
-        // Extended instructions: currently, assume everything is an ID.
-        // TODO: add whatever data we need for exceptions to that
-        if (opCode == spv::OpExtInst) {
-            word        += 2; // instruction set, and instruction from set
-            numOperands -= 2;
-
-            for (unsigned op=0; op < numOperands; ++op)
-                idFn(asId(word++)); // ID
-
-            return nextInst;
-        }
-
-        // Circular buffer so we can look back at previous unmapped values during the mapping pass.
-        static const unsigned idBufferSize = 4;
-        spv::Id idBuffer[idBufferSize];
-        unsigned idBufferPos = 0;
-
-        // Store IDs from instruction in our map
-        for (int op = 0; numOperands > 0; ++op, --numOperands) {
-            // SpecConstantOp is special: it includes the operands of another opcode which is
-            // given as a literal in the 3rd word.  We will switch over to pretending that the
-            // opcode being processed is the literal opcode value of the SpecConstantOp.  See the
-            // SPIRV spec for details.  This way we will handle IDs and literals as appropriate for
-            // the embedded op.
-            if (opCode == spv::OpSpecConstantOp) {
-                if (op == 0) {
-                    opCode = asOpCode(word++);  // this is the opcode embedded in the SpecConstantOp.
-                    --numOperands;
-                }
-            }
-
-            switch (spv::InstructionDesc[opCode].operands.getClass(op)) {
-            case spv::OperandId:
-            case spv::OperandScope:
-            case spv::OperandMemorySemantics:
-                idBuffer[idBufferPos] = asId(word);
-                idBufferPos = (idBufferPos + 1) % idBufferSize;
-                idFn(asId(word++));
-                break;
-
-            case spv::OperandVariableIds:
-                for (unsigned i = 0; i < numOperands; ++i)
-                    idFn(asId(word++));
-                return nextInst;
-
-            case spv::OperandVariableLiterals:
-                // for clarity
-                // if (opCode == spv::OpDecorate && asDecoration(word - 1) == spv::DecorationBuiltIn) {
-                //     ++word;
-                //     --numOperands;
-                // }
-                // word += numOperands;
-                return nextInst;
-
-            case spv::OperandVariableLiteralId: {
-                if (opCode == OpSwitch) {
-                    // word-2 is the position of the selector ID.  OpSwitch Literals match its type.
-                    // In case the IDs are currently being remapped, we get the word[-2] ID from
-                    // the circular idBuffer.
-                    const unsigned literalSizePos = (idBufferPos+idBufferSize-2) % idBufferSize;
-                    const unsigned literalSize = idTypeSizeInWords(idBuffer[literalSizePos]);
-                    const unsigned numLiteralIdPairs = (nextInst-word) / (1+literalSize);
-
-                    if (errorLatch)
-                        return -1;
-
-                    for (unsigned arg=0; arg<numLiteralIdPairs; ++arg) {
-                        word += literalSize;  // literal
-                        idFn(asId(word++));   // label
-                    }
-                } else {
-                    assert(0); // currentely, only OpSwitch uses OperandVariableLiteralId
-                }
-
-                return nextInst;
-            }
-
-            case spv::OperandLiteralString: {
-                const int stringWordCount = literalStringWords(literalString(word));
-                word += stringWordCount;
-                numOperands -= (stringWordCount-1); // -1 because for() header post-decrements
-                break;
-            }
-
-            // Execution mode might have extra literal operands.  Skip them.
-            case spv::OperandExecutionMode:
-                return nextInst;
-
-            // Single word operands we simply ignore, as they hold no IDs
-            case spv::OperandLiteralNumber:
-            case spv::OperandSource:
-            case spv::OperandExecutionModel:
-            case spv::OperandAddressing:
-            case spv::OperandMemory:
-            case spv::OperandStorage:
-            case spv::OperandDimensionality:
-            case spv::OperandSamplerAddressingMode:
-            case spv::OperandSamplerFilterMode:
-            case spv::OperandSamplerImageFormat:
-            case spv::OperandImageChannelOrder:
-            case spv::OperandImageChannelDataType:
-            case spv::OperandImageOperands:
-            case spv::OperandFPFastMath:
-            case spv::OperandFPRoundingMode:
-            case spv::OperandLinkageType:
-            case spv::OperandAccessQualifier:
-            case spv::OperandFuncParamAttr:
-            case spv::OperandDecoration:
-            case spv::OperandBuiltIn:
-            case spv::OperandSelect:
-            case spv::OperandLoop:
-            case spv::OperandFunction:
-            case spv::OperandMemoryAccess:
-            case spv::OperandGroupOperation:
-            case spv::OperandKernelEnqueueFlags:
-            case spv::OperandKernelProfilingInfo:
-            case spv::OperandCapability:
-                ++word;
-                break;
-
-            default:
-                assert(0 && "Unhandled Operand Class");
-                break;
-            }
-        }
-
-        return nextInst;
-    }
-
     // Make a pass over all the instructions and process them given appropriate functions
     spirvbin_t& spirvbin_t::process(instfn_t instFn, idfn_t idFn, unsigned begin, unsigned end)
     {
@@ -680,19 +505,46 @@ namespace spv {
         begin = (begin == 0 ? header_size          : begin);
         end   = (end   == 0 ? unsigned(spv.size()) : end);
 
-        // basic parsing and InstructionDesc table borrowed from SpvDisassemble.cpp...
-        unsigned nextInst = unsigned(spv.size());
+        // Instruction boundaries and ID operand positions come from the index built
+        // by buildLocalMaps(), which is shared with the disassembler.
+        const auto& instructions = parser.getInstructions();
+        const auto& idPositions  = parser.getIdPositions();
+
+        // The parser indexes past some errors, but nothing from the first one on is processed
+        const unsigned errorOffset = parser.getError() != spv::Parser::ErrorNone ? parser.getErrorOffset() : end;
+        const unsigned processEnd  = std::min(end, errorOffset);
 
-        for (unsigned word = begin; word < end; word = nextInst) {
-            nextInst = processInstruction(word, instFn, idFn);
+        for (size_t i = parser.findInstruction(begin); i < instructions.size() && instructions[i].offset < processEnd; ++i) {
+            const spv::Parser::Instruction& inst = instructions[i];
+
+            if (!instFn(inst.opCode, inst.offset)) {
+                for (unsigned id = inst.idBegin; id < inst.idEnd; ++id)
+                    idFn(asId(idPositions[id]));
+            }
 
             if (errorLatch)
                 return *this;
         }
 
+        // Report the parse error once the instructions before it are processed
+        if (parser.getError() != spv::Parser::ErrorNone && errorOffset >= begin && errorOffset < end)
+            error(parseErrorString(parser.getError()));
+
         return *this;
     }
 
+    const char* spirvbin_t::parseErrorString(spv::Parser::Error err)
+    {
+        switch (err) {
+        case spv::Parser::ErrorHeader:     return "file too short: ";
+        case spv::Parser::ErrorTruncated:  return "spir instruction terminated too early";
+        case spv::Parser::ErrorWordCount:  return "spir instruction has zero word count";
+        case spv::Parser::ErrorString:     return "spir literal string terminated too early";
+        case spv::Parser::ErrorSwitchType: return "type size for ID not found";
+        default:                           return "unknown parse error";
+        }
+    }
+
     // Apply global name mapping to a single module
     void spirvbin_t::mapNames()
     {
@@ -705,7 +557,7 @@ namespace spv {
                 hashval = hashval * 1009 + c;
 
             if (isOldIdUnmapped(name.second)) {
-                localId(name.second, nextUnusedId(hashval % softTypeIdLimit + firstMappedID));
+                localId(name.second, nextUnusedHashedId(hashval % softTypeIdLimit + firstMappedID));
                 if (errorLatch)
                     return;
             }
@@ -769,7 +621,7 @@ namespace spv {
                     }
 
                     if (isOldIdUnmapped(resId)) {
-                        localId(resId, nextUnusedId(hashval % softTypeIdLimit + firstMappedID));
+                        localId(resId, nextUnusedHashedId(hashval % softTypeIdLimit + firstMappedID));
                         if (errorLatch)
                             return;
                     }
@@ -830,188 +682,262 @@ namespace spv {
                     const std::uint32_t hashval = opCounter[thisOpCode] * thisOpCode * 50047 + idCounter + fnId * 117;
 
                     if (isOldIdUnmapped(id))
-                        localId(id, nextUnusedId(hashval % softTypeIdLimit + firstMappedID));
+                        localId(id, nextUnusedHashedId(hashval % softTypeIdLimit + firstMappedID));
                 }
             });
     }
 
-    // EXPERIMENTAL: forward IO and uniform load/stores into operands
-    // This produces invalid Schema-0 SPIRV
-    void spirvbin_t::forwardLoadStores()
+    // Build the def-use index in a single pass over the module.
+    void spirvbin_t::buildDefUse()
     {
-        idset_t fnLocalVars; // set of function local vars
-        idmap_t idMap;       // Map of load result IDs to what they load
+        msg(3, 2, std::string("build def-use index: "));
+
+        const spv::Id idBound = bound();
+
+        defPos.assign(idBound, 0);
+        useStart.assign(idBound + 1, 0);
+        useList.clear();
+        flowCtrlPos.clear();
+
+        // Gather (Id, use) pairs in module order, then bucket them by Id.  The bucketing is
+        // a stable counting sort, so each Id's uses stay in module order.
+        std::vector<std::pair<spv::Id, iduse_t>> refs;
+        refs.reserve(spv.size() / 2); // initial estimate; can grow if needed.
+
+        unsigned instStart = 0;
+        unsigned resultPos = 0;
 
-        // EXPERIMENTAL: Forward input and access chain loads into consumptions
         process(
             [&](spv::Op opCode, unsigned start) {
-                // Add inputs and uniforms to the map
-                if ((opCode == spv::OpVariable && asWordCount(start) == 4) &&
-                    (spv[start+3] == spv::StorageClassUniform ||
-                    spv[start+3] == spv::StorageClassUniformConstant ||
-                    spv[start+3] == spv::StorageClassInput))
-                    fnLocalVars.insert(asId(start+2));
-
-                if (opCode == spv::OpAccessChain && fnLocalVars.count(asId(start+3)) > 0)
-                    fnLocalVars.insert(asId(start+2));
-
-                if (opCode == spv::OpLoad && fnLocalVars.count(asId(start+3)) > 0) {
-                    idMap[asId(start+2)] = asId(start+3);
-                    stripInst(start);
-                }
+                instStart = start;
+                resultPos = 0;
+
+                if (spv::InstructionDesc[opCode].hasResult())
+                    resultPos = start + (spv::InstructionDesc[opCode].hasType() ? 2 : 1);
+
+                if (isFlowCtrl(opCode))
+                    flowCtrlPos.push_back(start);
 
                 return false;
             },
 
-            [&](spv::Id& id) { if (idMap.find(id) != idMap.end()) id = idMap[id]; }
+            [&](spv::Id& id) {
+                if (id >= idBound) {
+                    error(std::string("ID out of range: ") + std::to_string(id));
+                    return;
+                }
+
+                const unsigned pos = unsigned(&id - spv.data());
+
+                if (pos == resultPos) {
+                    defPos[id] = instStart;
+                } else {
+                    iduse_t use;
+                    use.pos  = pos;
+                    use.inst = instStart;
+                    refs.push_back(std::make_pair(id, use));
+                    ++useStart[id + 1];
+                }
+            }
         );
 
         if (errorLatch)
             return;
 
-        // EXPERIMENTAL: Implicit output stores
-        fnLocalVars.clear();
-        idMap.clear();
+        for (spv::Id id = 0; id < idBound; ++id)
+            useStart[id + 1] += useStart[id];
 
-        process(
-            [&](spv::Op opCode, unsigned start) {
-                // Add inputs and uniforms to the map
-                if ((opCode == spv::OpVariable && asWordCount(start) == 4) &&
-                    (spv[start+3] == spv::StorageClassOutput))
-                    fnLocalVars.insert(asId(start+2));
+        useList.resize(refs.size());
 
-                if (opCode == spv::OpStore && fnLocalVars.count(asId(start+1)) > 0) {
-                    idMap[asId(start+2)] = asId(start+1);
-                    stripInst(start);
-                }
+        std::vector<unsigned> fill(useStart.begin(), useStart.end() - 1);
+        for (const auto& ref : refs)
+            useList[fill[ref.first]++] = ref.second;
+    }
 
-                return false;
-            },
-            op_fn_nop);
+    // Number of flow control instructions at or before 'start'.  Two instructions with the
+    // same number are in the same straight-line block.
+    unsigned spirvbin_t::blockNumber(unsigned start) const
+    {
+        return unsigned(std::upper_bound(flowCtrlPos.begin(), flowCtrlPos.end(), start) - flowCtrlPos.begin());
+    }
+
+    // EXPERIMENTAL: forward IO and uniform load/stores into operands
+    // This produces invalid Schema-0 SPIRV
+    void spirvbin_t::forwardLoadStores()
+    {
+        buildDefUse();
 
         if (errorLatch)
             return;
 
-        process(
-            inst_fn_nop,
-            [&](spv::Id& id) { if (idMap.find(id) != idMap.end()) id = idMap[id]; }
-        );
+        idmap_t loadMap;  // Map of load result IDs to what they load
+        idmap_t storeMap; // Map of stored value IDs to the output they're stored to
 
-        if (errorLatch)
-            return;
+        std::vector<spv::Id> ptrs;      // input and uniform pointers, incl. access chains
+        std::vector<spv::Id> outputs;   // output variables
 
-        strip();          // strip out data we decided to eliminate
-    }
+        for (spv::Id id = 0; id < spv::Id(defPos.size()); ++id) {
+            const unsigned start = defPos[id];
+            if (start == 0 || asOpCode(start) != spv::OpVariable || asWordCount(start) != 4)
+                continue;
 
-    // optimize loads and stores
-    void spirvbin_t::optLoadStore()
-    {
-        idset_t    fnLocalVars;  // candidates for removal (only locals)
-        idmap_t    idMap;        // Map of load result IDs to what they load
-        blockmap_t blockMap;     // Map of IDs to blocks they first appear in
-        int        blockNum = 0; // block count, to avoid crossing flow control
+            switch (spv[start+3]) {
+            case spv::StorageClassUniform:
+            case spv::StorageClassUniformConstant:
+            case spv::StorageClassInput:
+                ptrs.push_back(id);
+                break;
+            case spv::StorageClassOutput:
+                outputs.push_back(id);
+                break;
+            default:
+                break;
+            }
+        }
 
-        // Find all the function local pointers stored at most once, and not via access chains
-        process(
-            [&](spv::Op opCode, unsigned start) {
-                const int wordCount = asWordCount(start);
+        // EXPERIMENTAL: Forward input and access chain loads into consumptions.
+        // Access chains off a forwarded pointer are forwarded pointers too.
+        for (size_t p = 0; p < ptrs.size(); ++p) {
+            const spv::Id ptr = ptrs[p];
 
-                // Count blocks, so we can avoid crossing flow control
-                if (isFlowCtrl(opCode))
-                    ++blockNum;
+            for (unsigned u = useStart[ptr]; u < useStart[ptr + 1]; ++u) {
+                const iduse_t& use = useList[u];
+                if (use.pos != use.inst + 3)
+                    continue;
 
-                // Add local variables to the map
-                if ((opCode == spv::OpVariable && spv[start+3] == spv::StorageClassFunction && asWordCount(start) == 4)) {
-                    fnLocalVars.insert(asId(start+2));
-                    return true;
-                }
+                if (asOpCode(use.inst) == spv::OpAccessChain)
+                    ptrs.push_back(asId(use.inst + 2));
 
-                // Ignore process vars referenced via access chain
-                if ((opCode == spv::OpAccessChain || opCode == spv::OpInBoundsAccessChain) && fnLocalVars.count(asId(start+3)) > 0) {
-                    fnLocalVars.erase(asId(start+3));
-                    idMap.erase(asId(start+3));
-                    return true;
+                if (asOpCode(use.inst) == spv::OpLoad) {
+                    loadMap[asId(use.inst + 2)] = ptr;
+                    stripInst(use.inst);
                 }
+            }
+        }
 
-                if (opCode == spv::OpLoad && fnLocalVars.count(asId(start+3)) > 0) {
-                    const spv::Id varId = asId(start+3);
+        // EXPERIMENTAL: Implicit output stores.  Stored values are seen after load
+        // forwarding, and a later store of the same value wins.
+        std::vector<iduse_t> stores;
 
-                    // Avoid loads before stores
-                    if (idMap.find(varId) == idMap.end()) {
-                        fnLocalVars.erase(varId);
-                        idMap.erase(varId);
-                    }
+        for (const spv::Id output : outputs) {
+            for (unsigned u = useStart[output]; u < useStart[output + 1]; ++u) {
+                const iduse_t& use = useList[u];
+                if (asOpCode(use.inst) == spv::OpStore && use.pos == use.inst + 1)
+                    stores.push_back(use);
+            }
+        }
 
-                    // don't do for volatile references
-                    if (wordCount > 4 && (spv[start+4] & spv::MemoryAccessVolatileMask)) {
-                        fnLocalVars.erase(varId);
-                        idMap.erase(varId);
-                    }
+        std::sort(stores.begin(), stores.end(),
+                  [](const iduse_t& a, const iduse_t& b) { return a.inst < b.inst; });
 
-                    // Handle flow control
-                    if (blockMap.find(varId) == blockMap.end()) {
-                        blockMap[varId] = blockNum;  // track block we found it in.
-                    } else if (blockMap[varId] != blockNum) {
-                        fnLocalVars.erase(varId);  // Ignore if crosses flow control
-                        idMap.erase(varId);
-                    }
+        for (const auto& store : stores) {
+            spv::Id value = asId(store.inst + 2);
+            const auto load_it = loadMap.find(value);
+            if (load_it != loadMap.end())
+                value = load_it->second;
 
-                    return true;
-                }
+            storeMap[value] = asId(store.inst + 1);
+            stripInst(store.inst);
+        }
 
-                if (opCode == spv::OpStore && fnLocalVars.count(asId(start+1)) > 0) {
-                    const spv::Id varId = asId(start+1);
+        // Rewrite every use through both maps in one go.
+        const auto rewrite = [&](spv::Id id, spv::Id newId) {
+            const auto store_it = storeMap.find(newId);
+            if (store_it != storeMap.end())
+                newId = store_it->second;
 
-                    if (idMap.find(varId) == idMap.end()) {
-                        idMap[varId] = asId(start+2);
-                    } else {
-                        // Remove if it has more than one store to the same pointer
-                        fnLocalVars.erase(varId);
-                        idMap.erase(varId);
-                    }
+            for (unsigned u = useStart[id]; u < useStart[id + 1]; ++u)
+                spv[useList[u].pos] = newId;
+        };
 
-                    // don't do for volatile references
-                    if (wordCount > 3 && (spv[start+3] & spv::MemoryAccessVolatileMask)) {
-                        fnLocalVars.erase(asId(start+3));
-                        idMap.erase(asId(start+3));
-                    }
+        for (const auto& load : loadMap)
+            rewrite(load.first, load.second);
 
-                    // Handle flow control
-                    if (blockMap.find(varId) == blockMap.end()) {
-                        blockMap[varId] = blockNum;  // track block we found it in.
-                    } else if (blockMap[varId] != blockNum) {
-                        fnLocalVars.erase(varId);  // Ignore if crosses flow control
-                        idMap.erase(varId);
-                    }
+        for (const auto& store : storeMap)
+            if (loadMap.find(store.first) == loadMap.end())
+                rewrite(store.first, store.first);
 
-                    return true;
-                }
+        strip();          // strip out data we decided to eliminate
+    }
 
-                return false;
-            },
+    // optimize loads and stores
+    void spirvbin_t::optLoadStore()
+    {
+        buildDefUse();
 
-            // If local var id used anywhere else, don't eliminate
-            [&](spv::Id& id) {
-                if (fnLocalVars.count(id) > 0) {
-                    fnLocalVars.erase(id);
-                    idMap.erase(id);
+        if (errorLatch)
+            return;
+
+        idmap_t              idMap;        // Map of load result IDs to what they load
+        std::vector<spv::Id> fnLocalVars;  // candidates for removal (only locals)
+
+        // Find all the function local pointers stored at most once, in the same block as
+        // all their loads, with no load before the store, and not otherwise referenced
+        // (e.g, via access chains).
+        for (spv::Id varId = 0; varId < spv::Id(defPos.size()); ++varId) {
+            const unsigned varStart = defPos[varId];
+
+            if (varStart == 0 || asOpCode(varStart) != spv::OpVariable ||
+                spv[varStart+3] != spv::StorageClassFunction || asWordCount(varStart) != 4)
+                continue;
+
+            bool     removable  = true;
+            bool     stored     = false;
+            spv::Id  storedId   = spv::NoResult;
+            unsigned firstBlock = 0;
+            bool     seenBlock  = false;
+
+            for (unsigned u = useStart[varId]; removable && u < useStart[varId + 1]; ++u) {
+                const iduse_t&  use       = useList[u];
+                const spv::Op   opCode    = asOpCode(use.inst);
+                const unsigned  wordCount = asWordCount(use.inst);
+
+                // References ahead of the definition are debug info and annotations
+                if (use.inst < varStart)
+                    continue;
+
+                if (opCode == spv::OpLoad && use.pos == use.inst + 3) {
+                    // Avoid loads before stores, and volatile references
+                    if (!stored || (wordCount > 4 && (spv[use.inst+4] & spv::MemoryAccessVolatileMask)))
+                        removable = false;
+                } else if (opCode == spv::OpStore && use.pos == use.inst + 1) {
+                    // Remove if it has more than one store to the same pointer, or is volatile
+                    if (stored || (wordCount > 3 && (spv[use.inst+3] & spv::MemoryAccessVolatileMask)))
+                        removable = false;
+
+                    stored   = true;
+                    storedId = asId(use.inst + 2);
+                } else {
+                    // Used anywhere else (access chains included): don't eliminate
+                    removable = false;
+                }
+
+                // Handle flow control: ignore if it crosses blocks
+                const unsigned block = blockNumber(use.inst);
+                if (!seenBlock) {
+                    firstBlock = block;
+                    seenBlock  = true;
+                } else if (block != firstBlock) {
+                    removable = false;
                 }
             }
-        );
 
-        if (errorLatch)
-            return;
+            if (!removable)
+                continue;
 
-        process(
-            [&](spv::Op opCode, unsigned start) {
-                if (opCode == spv::OpLoad && fnLocalVars.count(asId(start+3)) > 0)
-                    idMap[asId(start+2)] = idMap[asId(start+3)];
-                return false;
-            },
-            op_fn_nop);
+            fnLocalVars.push_back(varId);
+            if (stored)
+                idMap[varId] = storedId;
+        }
 
-        if (errorLatch)
-            return;
+        // Loads of removable variables take on the stored value
+        for (const spv::Id varId : fnLocalVars) {
+            for (unsigned u = useStart[varId]; u < useStart[varId + 1]; ++u) {
+                const iduse_t& use = useList[u];
+                if (asOpCode(use.inst) == spv::OpLoad && use.inst > defPos[varId])
+                    idMap[asId(use.inst+2)] = idMap[varId];
+            }
+        }
 
         // Chase replacements to their origins, in case there is a chain such as:
         //   2 = store 1
@@ -1028,26 +954,18 @@ namespace spv {
         }
 
         // Remove the load/store/variables for the ones we've discovered
-        process(
-            [&](spv::Op opCode, unsigned start) {
-                if ((opCode == spv::OpLoad  && fnLocalVars.count(asId(start+3)) > 0) ||
-                    (opCode == spv::OpStore && fnLocalVars.count(asId(start+1)) > 0) ||
-                    (opCode == spv::OpVariable && fnLocalVars.count(asId(start+2)) > 0)) {
+        for (const spv::Id varId : fnLocalVars) {
+            stripInst(defPos[varId]);
 
-                    stripInst(start);
-                    return true;
-                }
-
-                return false;
-            },
-
-            [&](spv::Id& id) {
-                if (idMap.find(id) != idMap.end()) id = idMap[id];
-            }
-        );
+            for (unsigned u = useStart[varId]; u < useStart[varId + 1]; ++u)
+                if (useList[u].inst > defPos[varId])
+                    stripInst(useList[u].inst);
+        }
 
-        if (errorLatch)
-            return;
+        // Point the remaining uses at the replacements
+        for (const auto& idPair : idMap)
+            for (unsigned u = useStart[idPair.first]; u < useStart[idPair.first + 1]; ++u)
+                spv[useList[u].pos] = idPair.second;
 
         strip();          // strip out data we decided to eliminate
     }
@@ -1378,14 +1296,15 @@ namespace spv {
                 return;
 
             if (isOldIdUnmapped(resId)) {
-                localId(resId, nextUnusedId(hashval % softTypeIdLimit + firstMappedID));
+                localId(resId, nextUnusedHashedId(hashval % softTypeIdLimit + firstMappedID));
                 if (errorLatch)
                     return;
             }
         }
     }
 
-    // Strip a single binary by removing ranges given in stripRange
+    // Strip a single binary by removing ranges given in stripRange.  This is one
+    // compaction pass within the current buffer: each run of kept words moves down once.
     void spirvbin_t::strip()
     {
         if (stripRange.empty()) // nothing to do
@@ -1394,81 +1313,157 @@ namespace spv {
         // Sort strip ranges in order of traversal
         std::sort(stripRange.begin(), stripRange.end());
 
-        // Allocate a new binary big enough to hold old binary
-        // We'll step this iterator through the strip ranges as we go through the binary
-        auto strip_it = stripRange.begin();
+        unsigned strippedPos = 0; // next free word in the compacted binary
+        unsigned word        = 0; // next unvisited word in the original binary
 
-        int strippedPos = 0;
-        for (unsigned word = 0; word < unsigned(spv.size()); ++word) {
-            while (strip_it != stripRange.end() && word >= strip_it->second)
-                ++strip_it;
+        const auto keep = [&](unsigned end) {
+            if (end <= word)
+                return;
+            if (strippedPos != word)
+                memmove(spv.data() + strippedPos, spv.data() + word, (end - word) * sizeof(spirword_t));
+            strippedPos += end - word;
+        };
 
-            if (strip_it == stripRange.end() || word < strip_it->first || word >= strip_it->second)
-                spv[strippedPos++] = spv[word];
+        // Ranges may overlap (e.g, an instruction inside a dead function)
+        for (const auto& range : stripRange) {
+            keep(range.first);
+            word = std::max(word, range.second);
         }
 
+        keep(unsigned(spv.size()));
+
         spv.resize(strippedPos);
         stripRange.clear();
 
         buildLocalMaps();
     }
 
+    spirvbin_t::passstats_t& spirvbin_t::passstats_t::operator+=(const passstats_t& rhs)
+    {
+        runs        += rhs.runs;
+        seconds     += rhs.seconds;
+        wordsBefore += rhs.wordsBefore;
+        wordsAfter  += rhs.wordsAfter;
+        wordsMarked += rhs.wordsMarked;
+        idsMapped   += rhs.idsMapped;
+        collisions  += rhs.collisions;
+
+        return *this;
+    }
+
+    const char* spirvbin_t::getPassName(Pass pass)
+    {
+        switch (pass) {
+        case PASS_INDEX:           return "index";
+        case PASS_STRIP_DEBUG:     return "strip debug";
+        case PASS_OPT_LOADSTORE:   return "opt loadstore";
+        case PASS_FWD_LOADSTORE:   return "fwd loadstore";
+        case PASS_DCE_FUNCS:       return "dce funcs";
+        case PASS_DCE_VARS:        return "dce vars";
+        case PASS_DCE_TYPES:       return "dce types";
+        case PASS_STRIP:           return "strip";
+        case PASS_STRIP_DCE:       return "strip dce";
+        case PASS_STRIP_DEAD_REFS: return "strip dead refs";
+        case PASS_MAP_TYPES:       return "map types";
+        case PASS_MAP_NAMES:       return "map names";
+        case PASS_MAP_FUNCS:       return "map funcs";
+        case PASS_MAP_REMAINDER:   return "map remainder";
+        case PASS_APPLY_MAP:       return "apply map";
+        default:                   return "unknown";
+        }
+    }
+
+    void spirvbin_t::runPass(Pass pass, const std::function<void()>& fn)
+    {
+        passstats_t& stats = passStats[pass];
+
+        size_t marked = 0;
+        for (const auto& range : stripRange)
+            marked += range.second - range.first;
+
+        ++stats.runs;
+        stats.wordsBefore += spv.size();
+
+        curStats = &stats;
+        const auto start = std::chrono::steady_clock::now();
+
+        fn();
+
+        stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        curStats = nullptr;
+
+        // Passes that strip internally consume their own marks; count what's left over.
+        size_t markedAfter = 0;
+        for (const auto& range : stripRange)
+            markedAfter += range.second - range.first;
+
+        stats.wordsAfter  += spv.size();
+        stats.wordsMarked += markedAfter > marked ? markedAfter - marked : 0;
+    }
+
     // Strip a single binary by removing ranges given in stripRange
     void spirvbin_t::remap(std::uint32_t opts)
     {
         options = opts;
 
+        for (auto& stats : passStats)
+            stats = passstats_t();
+
         // Set up opcode tables from SpvDoc
         spv::Parameterize();
 
-        validate();       // validate header
-        buildLocalMaps(); // build ID maps
+        runPass(PASS_INDEX, [this]() {
+            validate();       // validate header
+            if (!errorLatch)
+                buildLocalMaps(); // build ID maps
+        });
+        if (errorLatch) return;
 
         msg(3, 4, std::string("ID bound: ") + std::to_string(bound()));
 
-        if (options & STRIP)         stripDebug();
-        if (errorLatch) return;
-
-        strip();        // strip out data we decided to eliminate
+        if (options & STRIP)         runPass(PASS_STRIP_DEBUG, [this]() { stripDebug(); });
         if (errorLatch) return;
 
-        if (options & OPT_LOADSTORE) optLoadStore();
+        runPass(PASS_STRIP, [this]() { strip(); }); // strip out data we decided to eliminate
         if (errorLatch) return;
 
-        if (options & OPT_FWD_LS)    forwardLoadStores();
+        if (options & OPT_LOADSTORE) runPass(PASS_OPT_LOADSTORE, [this]() { optLoadStore(); });
         if (errorLatch) return;
 
-        if (options & DCE_FUNCS)     dceFuncs();
+        if (options & OPT_FWD_LS)    runPass(PASS_FWD_LOADSTORE, [this]() { forwardLoadStores(); });
         if (errorLatch) return;
 
-        if (options & DCE_VARS)      dceVars();
+        if (options & DCE_FUNCS)     runPass(PASS_DCE_FUNCS, [this]() { dceFuncs(); });
         if (errorLatch) return;
 
-        if (options & DCE_TYPES)     dceTypes();
+        if (options & DCE_VARS)      runPass(PASS_DCE_VARS, [this]() { dceVars(); });
         if (errorLatch) return;
 
-        strip();         // strip out data we decided to eliminate
+        if (options & DCE_TYPES)     runPass(PASS_DCE_TYPES, [this]() { dceTypes(); });
         if (errorLatch) return;
 
-        stripDeadRefs(); // remove references to things we DCEed
+        runPass(PASS_STRIP_DCE, [this]() { strip(); }); // strip out data we decided to eliminate
         if (errorLatch) return;
 
         // after the last strip, we must clean any debug info referring to now-deleted data
+        runPass(PASS_STRIP_DEAD_REFS, [this]() { stripDeadRefs(); });
+        if (errorLatch) return;
 
-        if (options & MAP_TYPES)     mapTypeConst();
+        if (options & MAP_TYPES)     runPass(PASS_MAP_TYPES, [this]() { mapTypeConst(); });
         if (errorLatch) return;
 
-        if (options & MAP_NAMES)     mapNames();
+        if (options & MAP_NAMES)     runPass(PASS_MAP_NAMES, [this]() { mapNames(); });
         if (errorLatch) return;
 
-        if (options & MAP_FUNCS)     mapFnBodies();
+        if (options & MAP_FUNCS)     runPass(PASS_MAP_FUNCS, [this]() { mapFnBodies(); });
         if (errorLatch) return;
 
         if (options & MAP_ALL) {
-            mapRemainder(); // map any unmapped IDs
+            runPass(PASS_MAP_REMAINDER, [this]() { mapRemainder(); }); // map any unmapped IDs
             if (errorLatch) return;
 
-            applyMap();     // Now remap each shader to the new IDs we've come up with
+            // Now remap each shader to the new IDs we've come up with
+            runPass(PASS_APPLY_MAP, [this]() { applyMap(); });
             if (errorLatch) return;
         }
     }
@@ -1476,9 +1471,18 @@ namespace spv {
     // remap from a memory image
     void spirvbin_t::remap(std::vector<std::uint32_t>& in_spv, std::uint32_t opts)
     {
-        spv.swap(in_spv);
+        size_t size = in_spv.size();
+        remap(in_spv.data(), size, opts);
+        in_spv.resize(size);
+    }
+
+    // remap in place within a caller-owned buffer
+    void spirvbin_t::remap(std::uint32_t* in_spv, size_t& size, std::uint32_t opts)
+    {
+        spv.assign(in_spv, size);
         remap(opts);
-        spv.swap(in_spv);
+        size = spv.size();
+        spv.assign(nullptr, 0); // don't hold on to the caller's memory
     }
 
 } // namespace SPV
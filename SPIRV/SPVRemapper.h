@@ -89,6 +89,12 @@ public:
         printf("Tool not compiled for C++11, which is required for SPIR-V remapping.\n");
         exit(5);
     }
+
+    void remap(std::uint32_t* /*spv*/, size_t& /*size*/, unsigned int /*opts = 0*/)
+    {
+        printf("Tool not compiled for C++11, which is required for SPIR-V remapping.\n");
+        exit(5);
+    }
 };
 
 } // namespace SPV
@@ -105,6 +111,7 @@ public:
 
 #include "spirv.hpp"
 #include "spvIR.h"
+#include "SpvParser.h"
 
 namespace spv {
 
@@ -112,7 +119,8 @@ namespace spv {
 class spirvbin_t : public spirvbin_base_t
 {
 public:
-   spirvbin_t(int verbose = 0) : entryPoint(spv::NoResult), largestNewId(0), verbose(verbose), errorLatch(false)
+   spirvbin_t(int verbose = 0) : entryPoint(spv::NoResult), largestNewId(0), curStats(nullptr), verbose(verbose),
+                                 errorLatch(false)
    { }
 
    virtual ~spirvbin_t() { }
@@ -120,6 +128,11 @@ public:
    // remap on an existing binary in memory
    void remap(std::vector<std::uint32_t>& spv, std::uint32_t opts = DO_EVERYTHING);
 
+   // remap a caller-owned buffer in place.  Remapping never grows a module: on return,
+   // 'size' holds the new word count, and words past it are unspecified.  No copy of the
+   // module is made, so this suits very large (e.g, debug info) modules.
+   void remap(std::uint32_t* spv, size_t& size, std::uint32_t opts = DO_EVERYTHING);
+
    // Type for error/log handler functions
    typedef std::function<void(const std::string&)> errorfn_t;
    typedef std::function<void(const std::string&)> logfn_t;
@@ -128,6 +141,48 @@ public:
    static void registerErrorHandler(errorfn_t handler) { errorHandler = handler; }
    static void registerLogHandler(logfn_t handler)     { logHandler   = handler; }
 
+   // Passes remap() can run, for the statistics below
+   enum Pass {
+      PASS_INDEX,          // validate header, build local maps
+      PASS_STRIP_DEBUG,    // mark debug info
+      PASS_OPT_LOADSTORE,
+      PASS_FWD_LOADSTORE,
+      PASS_DCE_FUNCS,
+      PASS_DCE_VARS,
+      PASS_DCE_TYPES,
+      PASS_STRIP,          // compact out the debug info marked so far
+      PASS_STRIP_DCE,      // compact out what the DCE passes marked
+      PASS_STRIP_DEAD_REFS,
+      PASS_MAP_TYPES,
+      PASS_MAP_NAMES,
+      PASS_MAP_FUNCS,
+      PASS_MAP_REMAINDER,
+      PASS_APPLY_MAP,
+      PASS_COUNT
+   };
+
+   // What one pass did.  Passes that only mark instructions for removal leave the module
+   // size alone; the words they marked show up in wordsMarked, and are removed by the next
+   // PASS_STRIP or PASS_STRIP_DCE (or by a pass that strips internally, such as PASS_DCE_TYPES).
+   struct passstats_t {
+      passstats_t() : runs(0), seconds(0.0), wordsBefore(0), wordsAfter(0), wordsMarked(0),
+                      idsMapped(0), collisions(0) { }
+
+      passstats_t& operator+=(const passstats_t& rhs);
+
+      int    runs;         // times the pass ran (files, when aggregated)
+      double seconds;      // wall clock time spent
+      size_t wordsBefore;  // module size going in
+      size_t wordsAfter;   // module size coming out
+      size_t wordsMarked;  // words marked for stripping
+      size_t idsMapped;    // Ids assigned a new value
+      size_t collisions;   // hashed soft-range Ids that were already taken
+   };
+
+   // Statistics for the most recent remap(); reset by each call.
+   const passstats_t& getPassStats(Pass pass) const { return passStats[pass]; }
+   static const char* getPassName(Pass pass);
+
 protected:
    // This can be overridden to provide other message behavior if needed
    virtual void msg(int minVerbosity, int indent, const std::string& txt) const;
@@ -164,9 +219,6 @@ private:
    typedef std::set<int>                    posmap_t;
    typedef std::unordered_map<spv::Id, int> posmap_rev_t;
 
-   // Maps and ID to the size of its base type, if known.
-   typedef std::unordered_map<spv::Id, unsigned> typesize_map_t;
-
    // handle error
    void error(const std::string& txt) const { errorLatch = true; errorHandler(txt); }
 
@@ -177,8 +229,6 @@ private:
    range_t  literalRange(spv::Op opCode)   const;
    range_t  typeRange(spv::Op opCode)      const;
    range_t  constRange(spv::Op opCode)     const;
-   unsigned typeSizeInWords(spv::Id id)    const;
-   unsigned idTypeSizeInWords(spv::Id id)  const;
 
    spv::Id&        asId(unsigned word)                { return spv[word]; }
    const spv::Id&  asId(unsigned word)          const { return spv[word]; }
@@ -212,9 +262,14 @@ private:
    // which std::vector<bool> doens't have.
    inline spv::Id   nextUnusedId(spv::Id id);
 
+   // As above, starting from a hashed slot in a soft ID range; counts collisions.
+   inline spv::Id   nextUnusedHashedId(spv::Id id);
+
+   // Run one pass, recording its statistics
+   void runPass(Pass pass, const std::function<void()>& fn);
+
    void buildLocalMaps();
    std::string literalString(unsigned word) const; // Return literal as a std::string
-   int literalStringWords(const std::string& str) const { return (int(str.size())+4)/4; }
 
    bool isNewIdMapped(spv::Id newId)   const { return isMapped(newId);            }
    bool isOldIdUnmapped(spv::Id oldId) const { return localId(oldId) == unmapped; }
@@ -227,7 +282,7 @@ private:
    std::uint32_t hashType(unsigned typeStart) const;
 
    spirvbin_t& process(instfn_t, idfn_t, unsigned begin = 0, unsigned end = 0);
-   int         processInstruction(unsigned word, instfn_t, idfn_t);
+   static const char* parseErrorString(spv::Parser::Error);
 
    void        validate() const;
    void        mapTypeConst();
@@ -241,13 +296,36 @@ private:
    void        forwardLoadStores(); // load store forwarding (EXPERIMENTAL)
    void        offsetIds(); // create relative offset IDs
 
+   void        buildDefUse();         // index Id definitions and uses over the module
+   unsigned    blockNumber(unsigned start) const; // flow control blocks preceding 'start'
+
    void        applyMap();            // remap per local name map
    void        mapRemainder();        // map any IDs we haven't touched yet
    void        stripDebug();          // strip all debug info
    void        stripDeadRefs();       // strips debug info for now-dead references after DCE
    void        strip();               // remove debug symbols
 
-   std::vector<spirword_t> spv;      // SPIR words
+   // Non-owning view of the words being remapped, which live in the caller's buffer.
+   // It can only shrink, which is all strip() needs.
+   class spirwords_t {
+   public:
+      spirwords_t() : words(nullptr), count(0) { }
+
+      void assign(spirword_t* w, size_t n) { words = w; count = n; }
+      void resize(size_t n)                { assert(n <= count); count = n; }
+      size_t size() const                  { return count; }
+
+      spirword_t*       data()                        { return words; }
+      const spirword_t* data()                  const { return words; }
+      spirword_t&       operator[](size_t i)          { return words[i]; }
+      const spirword_t& operator[](size_t i)    const { return words[i]; }
+
+   private:
+      spirword_t* words;
+      size_t      count;
+   };
+
+   spirwords_t             spv;      // SPIR words
 
    namemap_t               nameMap;  // ID names from OpName
 
@@ -273,9 +351,23 @@ private:
    // Which functions are called, anywhere in the module, with a call count
    std::unordered_map<spv::Id, int> fnCalls;
 
+   // Def-use index, built on demand by buildDefUse() and invalidated by any strip().
+   // Uses of Id 'i' are useList[useStart[i] .. useStart[i+1]), in module order.  An Id's
+   // own result word is its definition, not a use.
+   struct iduse_t {
+      unsigned pos;   // word position of the Id operand
+      unsigned inst;  // start of the instruction containing it
+   };
+
+   std::vector<unsigned> defPos;      // start of each Id's defining instruction, or 0
+   std::vector<unsigned> useStart;    // per-Id offset into useList; bound()+1 entries
+   std::vector<iduse_t>  useList;     // all Id uses, grouped by Id
+   std::vector<unsigned> flowCtrlPos; // starts of flow control instructions (ordered)
+
    posmap_t       typeConstPos;  // word positions that define types & consts (ordered)
    posmap_rev_t   idPosR;        // reverse map from IDs to positions
-   typesize_map_t idTypeSizeMap; // maps each ID to its type size, if known.
+
+   spv::Parser    parser;        // instruction and ID operand index, rebuilt by buildLocalMaps()
 
    std::vector<spv::Id>  idMapL;   // ID {M}ap from {L}ocal to {G}lobal IDs
 
@@ -285,6 +377,9 @@ private:
    // Sections of the binary to strip, given as [begin,end)
    std::vector<range_t> stripRange;
 
+   passstats_t  passStats[PASS_COUNT]; // statistics from the last remap()
+   passstats_t* curStats;              // the pass running now, if any
+
    // processing options:
    std::uint32_t options;
    int           verbose;     // verbosity level
@@ -2719,37 +2719,62 @@ void Builder::createConditionalBranch(Id condition, Block* thenBlock, Block* els
 // OpSource
 // [OpSourceContinued]
 // ...
+//
+// The source text (sourceText, then the sourceTextRefs) is copied straight
+// into the output words, without first gathering it into one string.
 void Builder::dumpSourceInstructions(std::vector<unsigned int>& out) const
 {
     const int maxWordCount = 0xFFFF;
     const int opSourceWordCount = 4;
-    const int nonNullBytesPerInstruction = 4 * (maxWordCount - opSourceWordCount) - 1;
+    const size_t nonNullBytesPerInstruction = 4 * (maxWordCount - opSourceWordCount) - 1;
 
     if (source != SourceLanguageUnknown) {
         // OpSource Language Version File Source
         Instruction sourceInst(NoResult, NoType, OpSource);
         sourceInst.addImmediateOperand(source);
         sourceInst.addImmediateOperand(sourceVersion);
+
+        size_t textSize = sourceText.size();
+        for (auto ref = sourceTextRefs.begin(); ref != sourceTextRefs.end(); ++ref)
+            textSize += ref->second;
+
         // File operand
         if (sourceFileStringId != NoResult) {
             sourceInst.addIdOperand(sourceFileStringId);
             // Source operand
-            if (sourceText.size() > 0) {
-                int nextByte = 0;
-                std::string subString;
-                while ((int)sourceText.size() - nextByte > 0) {
-                    subString = sourceText.substr(nextByte, nonNullBytesPerInstruction);
+            if (textSize > 0) {
+                // where the next byte comes from: piece 0 is sourceText, piece r + 1 is sourceTextRefs[r]
+                size_t piece = 0;
+                size_t pieceByte = 0;
+                for (size_t nextByte = 0; nextByte < textSize; nextByte += nonNullBytesPerInstruction) {
+                    const size_t bytes = std::min(textSize - nextByte, nonNullBytesPerInstruction);
+                    const unsigned int stringWords = (unsigned int)(bytes / 4 + 1);  // with a null terminator
                     if (nextByte == 0) {
                         // OpSource
-                        sourceInst.addStringOperand(subString.c_str());
-                        sourceInst.dump(out);
+                        out.push_back(((opSourceWordCount + stringWords) << WordCountShift) | OpSource);
+                        out.push_back(source);
+                        out.push_back(sourceVersion);
+                        out.push_back(sourceFileStringId);
                     } else {
-                        // OpSourcContinued
-                        Instruction sourceContinuedInst(OpSourceContinued);
-                        sourceContinuedInst.addStringOperand(subString.c_str());
-                        sourceContinuedInst.dump(out);
+                        // OpSourceContinued
+                        out.push_back(((1 + stringWords) << WordCountShift) | OpSourceContinued);
+                    }
+
+                    // first character in the lowest-order 8 bits, padded with nulls
+                    const size_t firstWord = out.size();
+                    out.resize(out.size() + stringWords, 0);
+                    for (size_t copied = 0; copied < bytes; ) {
+                        const char* text = piece == 0 ? sourceText.data() : sourceTextRefs[piece - 1].first;
+                        const size_t size = piece == 0 ? sourceText.size() : sourceTextRefs[piece - 1].second;
+                        const size_t count = std::min(size - pieceByte, bytes - copied);
+                        for (size_t c = 0; c < count; ++c, ++copied)
+                            out[firstWord + copied / 4] |= (unsigned int)(unsigned char)text[pieceByte + c] << (8 * (copied % 4));
+                        pieceByte += count;
+                        if (pieceByte == size) {
+                            ++piece;
+                            pieceByte = 0;
+                        }
                     }
-                    nextByte += nonNullBytesPerInstruction;
                 }
             } else
                 sourceInst.dump(out);
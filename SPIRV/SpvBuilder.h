@@ -82,6 +82,8 @@ public:
         strings.push_back(std::unique_ptr<Instruction>(fileString));
     }
     void setSourceText(const std::string& text) { sourceText = text; }
+    // Follows any setSourceText() text.  Not copied; must outlive dump().
+    void addSourceText(const char* text, size_t length) { sourceTextRefs.push_back(std::make_pair(text, length)); }
     void addSourceExtension(const char* ext) { sourceExtensions.push_back(ext); }
     void addModuleProcessed(const std::string& p) { moduleProcesses.push_back(p.c_str()); }
     void setEmitOpLines() { emitOpLines = true; }
@@ -601,6 +603,7 @@ public:
     int sourceVersion;
     spv::Id sourceFileStringId;
     std::string sourceText;
+    std::vector<std::pair<const char*, size_t>> sourceTextRefs;
     int currentLine;
     bool emitOpLines;
     std::set<std::string> extensions;
@@ -0,0 +1,272 @@
+//
+// Copyright (C) 2018 LunarG, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+//    Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//    Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//    Neither the name of 3Dlabs Inc. Ltd. nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+//
+// Single pass, table driven indexing of a SPIR-V binary.  See SpvParser.h.
+//
+
+#include "SpvParser.h"
+#include "doc.h"
+
+#include <algorithm>
+
+namespace spv {
+
+namespace {
+
+// How the parser steps over each class of operand
+enum OperandKind {
+    KindWord,       // one word, no <id>
+    KindId,         // one <id>
+    KindString,     // a nul-terminated literal string
+    KindIds,        // <id>s to the end of the instruction
+    KindLiterals,   // literals to the end of the instruction
+    KindIdLiterals, // <id>, literal pairs to the end
+    KindLiteralIds, // literal, <id> pairs to the end; literals are as wide as the selector
+};
+
+const OperandKind OperandKinds[] = {
+    KindWord,       // OperandNone
+    KindId,         // OperandId
+    KindIds,        // OperandVariableIds
+    KindWord,       // OperandOptionalLiteral
+    KindString,     // OperandOptionalLiteralString
+    KindLiterals,   // OperandVariableLiterals
+    KindIdLiterals, // OperandVariableIdLiteral
+    KindLiteralIds, // OperandVariableLiteralId
+    KindWord,       // OperandLiteralNumber
+    KindString,     // OperandLiteralString
+    KindWord,       // OperandSource
+    KindWord,       // OperandExecutionModel
+    KindWord,       // OperandAddressing
+    KindWord,       // OperandMemory
+    KindLiterals,   // OperandExecutionMode: the mode, then its literals
+    KindWord,       // OperandStorage
+    KindWord,       // OperandDimensionality
+    KindWord,       // OperandSamplerAddressingMode
+    KindWord,       // OperandSamplerFilterMode
+    KindWord,       // OperandSamplerImageFormat
+    KindWord,       // OperandImageChannelOrder
+    KindWord,       // OperandImageChannelDataType
+    KindWord,       // OperandImageOperands: the mask; its <id>s follow as OperandVariableIds
+    KindWord,       // OperandFPFastMath
+    KindWord,       // OperandFPRoundingMode
+    KindWord,       // OperandLinkageType
+    KindWord,       // OperandAccessQualifier
+    KindWord,       // OperandFuncParamAttr
+    KindWord,       // OperandDecoration
+    KindWord,       // OperandBuiltIn
+    KindWord,       // OperandSelect
+    KindWord,       // OperandLoop
+    KindWord,       // OperandFunction
+    KindId,         // OperandMemorySemantics
+    KindWord,       // OperandMemoryAccess
+    KindId,         // OperandScope
+    KindWord,       // OperandGroupOperation
+    KindWord,       // OperandKernelEnqueueFlags
+    KindWord,       // OperandKernelProfilingInfo
+    KindWord,       // OperandCapability
+    KindWord,       // OperandOpcode
+};
+
+static_assert(sizeof(OperandKinds) / sizeof(OperandKinds[0]) == OperandCount, "OperandKinds must cover every OperandClass");
+
+// Number of words in the literal string starting at 'word', or 0 if it is not
+// terminated before 'end'.
+unsigned stringWords(const unsigned int* words, unsigned word, unsigned end)
+{
+    for (unsigned w = word; w < end; ++w) {
+        const unsigned int content = words[w];
+        if ((content & 0x000000ff) == 0 || (content & 0x0000ff00) == 0 ||
+            (content & 0x00ff0000) == 0 || (content & 0xff000000) == 0)
+            return w - word + 1;
+    }
+
+    return 0;
+}
+
+} // end anonymous namespace
+
+bool Parser::fail(Error e, unsigned offset)
+{
+    if (error == ErrorNone) {
+        error = e;
+        errorOffset = offset;
+    }
+
+    return false;
+}
+
+bool Parser::parse(const unsigned int* words, size_t size)
+{
+    Parameterize();
+
+    instructions.clear();
+    idPositions.clear();
+    literalWidth.clear();
+    error = ErrorNone;
+    errorOffset = 0;
+
+    if (size < headerSize) {
+        bound = 0;
+        return fail(ErrorHeader, 0);
+    }
+
+    bound = words[3];
+    literalWidth.resize(bound, 0);
+
+    // Most instructions are three to five words, with one or two <id> operands each
+    instructions.reserve(size / 4);
+    idPositions.reserve(size / 2);
+
+    const unsigned moduleEnd = unsigned(size);
+    for (unsigned offset = headerSize; offset < moduleEnd; ) {
+        const unsigned wordCount = words[offset] >> WordCountShift;
+        const Op opCode = (Op)(words[offset] & OpCodeMask);
+
+        if (wordCount == 0)
+            return fail(ErrorWordCount, offset);
+        if (wordCount > moduleEnd - offset)
+            return fail(ErrorTruncated, offset);
+
+        const unsigned end = offset + wordCount;
+        unsigned word = offset + 1;
+
+        Instruction inst;
+        inst.offset = offset;
+        inst.wordCount = wordCount;
+        inst.opCode = opCode;
+        inst.typeId = 0;
+        inst.resultId = 0;
+        inst.idBegin = unsigned(idPositions.size());
+        inst.error = ErrorNone;
+
+        if (InstructionDesc[opCode].hasType() && word < end) {
+            inst.typeId = words[word];
+            idPositions.push_back(word++);
+        }
+        if (InstructionDesc[opCode].hasResult() && word < end) {
+            inst.resultId = words[word];
+            idPositions.push_back(word++);
+        }
+
+        // Remember how wide literals of each scalar type are, for OpSwitch
+        if (inst.resultId != 0 && inst.resultId < bound) {
+            if (opCode == OpTypeInt || opCode == OpTypeFloat) {
+                if (word < end)
+                    literalWidth[inst.resultId] = (unsigned char)((words[word] + 31) / 32);
+            } else if (inst.typeId != 0 && inst.typeId < bound)
+                literalWidth[inst.resultId] = literalWidth[inst.typeId];
+        }
+
+        // OpSpecConstantOp carries the operands of the opcode given in its first operand.
+        // Extended instructions: the set is an <id>, the instruction a literal, and
+        // (currently) everything after it is assumed to be an <id>.
+        Op operandOp = opCode;
+        if (opCode == OpSpecConstantOp && word < end)
+            operandOp = (Op)(words[word++] & OpCodeMask);
+        else if (opCode == OpExtInst && word + 1 < end) {
+            idPositions.push_back(word);
+            word += 2;
+            while (word < end)
+                idPositions.push_back(word++);
+        }
+
+        const OperandParameters& operands = InstructionDesc[operandOp].operands;
+        for (int op = 0; op < operands.getNum() && word < end && inst.error == ErrorNone; ++op) {
+            switch (OperandKinds[operands.getClass(op)]) {
+            case KindWord:
+                ++word;
+                break;
+            case KindId:
+                idPositions.push_back(word++);
+                break;
+            case KindString:
+            {
+                const unsigned count = stringWords(words, word, end);
+                if (count == 0) {
+                    inst.error = ErrorString;
+                    break;
+                }
+                word += count;
+                break;
+            }
+            case KindIds:
+                while (word < end)
+                    idPositions.push_back(word++);
+                break;
+            case KindLiterals:
+                word = end;
+                break;
+            case KindIdLiterals:
+                for (; word < end; word += 2)
+                    idPositions.push_back(word);
+                word = end;
+                break;
+            case KindLiteralIds:
+            {
+                // The selector is the instruction's first <id>; literals match its type
+                const Id selector = inst.idBegin < idPositions.size() ? words[idPositions[inst.idBegin]] : 0;
+                const unsigned width = selector < bound ? literalWidth[selector] : 0;
+                if (width == 0) {
+                    inst.error = ErrorSwitchType;
+                    break;
+                }
+                for (word += width; word < end; word += width + 1)
+                    idPositions.push_back(word);
+                word = end;
+                break;
+            }
+            }
+        }
+
+        inst.idEnd = unsigned(idPositions.size());
+        instructions.push_back(inst);
+        if (inst.error != ErrorNone)
+            fail(inst.error, offset);
+
+        offset = end;
+    }
+
+    return error == ErrorNone;
+}
+
+size_t Parser::findInstruction(unsigned offset) const
+{
+    return std::lower_bound(instructions.begin(), instructions.end(), offset,
+                            [](const Instruction& inst, unsigned o) { return inst.offset < o; }) - instructions.begin();
+}
+
+};  // end namespace spv
@@ -0,0 +1,120 @@
+//
+// Copyright (C) 2018 LunarG, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+//    Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//    Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//    Neither the name of 3Dlabs Inc. Ltd. nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+//
+// Parser is a single pass, table driven walk over a SPIR-V binary that records
+// where each instruction starts, its type and result <id>, and the word position
+// of every <id> operand.  The remapper and the disassembler share it, so operand
+// decoding (literal strings, OpSwitch literal widths, OpSpecConstantOp, ...)
+// lives in exactly one place.
+//
+// The index holds word positions rather than pointers, so it stays valid while
+// a client rewrites <id>s in place.  Anything that moves or resizes instructions
+// requires a new parse().
+//
+
+#pragma once
+#ifndef SpvParser_H
+#define SpvParser_H
+
+#include "spirv.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace spv {
+
+class Parser {
+public:
+    enum Error {
+        ErrorNone,
+        ErrorHeader,         // fewer words than a header
+        ErrorTruncated,      // an instruction runs past the end of the module
+        ErrorWordCount,      // an instruction with a word count of zero
+        ErrorString,         // a literal string runs past the end of its instruction
+        ErrorSwitchType,     // OpSwitch selector with no known integer type
+    };
+
+    // One parsed instruction.  Its <id> operands, in order (type, result, then the
+    // rest), are at word positions getIdPositions()[idBegin, idEnd).
+    struct Instruction {
+        unsigned offset;     // word offset of the instruction in the module
+        unsigned wordCount;
+        Op opCode;
+        Id typeId;           // 0 if the instruction has no type
+        Id resultId;         // 0 if the instruction has no result
+        unsigned idBegin;
+        unsigned idEnd;
+        Error error;         // ErrorString or ErrorSwitchType if its operands couldn't all be read
+    };
+
+    Parser() : bound(0), error(ErrorNone), errorOffset(0) { }
+
+    // Index the module; the 5 word header is skipped.  Returns false on any error.
+    // An instruction whose operands can't all be read is still indexed, with its
+    // error and the <id>s before it, and parsing goes on; a truncated instruction
+    // or a word count of zero stops it, after indexing the instructions before.
+    bool parse(const unsigned int* words, size_t size);
+
+    const std::vector<Instruction>& getInstructions() const { return instructions; }
+    const std::vector<unsigned>& getIdPositions() const { return idPositions; }
+    Id getBound() const { return bound; }
+
+    // First instruction at or after word 'offset'
+    size_t findInstruction(unsigned offset) const;
+
+    // The first error, and the word offset of its instruction
+    Error getError() const { return error; }
+    unsigned getErrorOffset() const { return errorOffset; }
+
+    static const int headerSize = 5;
+
+protected:
+    Parser(const Parser&);
+    Parser& operator=(const Parser&);
+
+    bool fail(Error e, unsigned offset);
+
+    std::vector<Instruction> instructions;
+    std::vector<unsigned> idPositions;
+    std::vector<unsigned char> literalWidth; // words per literal of an <id>'s scalar type, 0 if not int/float
+    Id bound;
+    Error error;
+    unsigned errorOffset;
+};
+
+};  // end namespace spv
+
+#endif // SpvParser_H
@@ -39,13 +39,14 @@
 #include <cstdlib>
 #include <cstring>
 #include <cassert>
-#include <iomanip>
+#include <deque>
 #include <stack>
-#include <sstream>
-#include <cstring>
+#include <string>
+#include <mutex>
 
 #include "disassemble.h"
 #include "doc.h"
+#include "SpvParser.h"
 
 namespace spv {
     extern "C" {
@@ -72,10 +73,58 @@ static const char* GLSLextAMDGetDebugNames(const char*, unsigned);
 static const char* GLSLextNVGetDebugNames(const char*, unsigned);
 #endif
 
-static void Kill(std::ostream& out, const char* message)
+// Growable text buffer the disassembly is written into.  Numbers are formatted by
+// hand, so printing an operand needs no stream state or temporary strings.
+class SpirvText {
+public:
+    explicit SpirvText(std::string& text) : text(text) { }
+
+    SpirvText& operator<<(const char* s) { text.append(s); return *this; }
+    SpirvText& operator<<(char c)        { text.push_back(c); return *this; }
+    SpirvText& operator<<(int n)         { return n < 0 ? *this << '-' << (0u - (unsigned)n) : *this << (unsigned)n; }
+    SpirvText& operator<<(unsigned int n)
+    {
+        char digits[10];
+        int count = 0;
+        do {
+            digits[count++] = (char)('0' + n % 10);
+            n /= 10;
+        } while (n != 0);
+        while (count > 0)
+            text.push_back(digits[--count]);
+        return *this;
+    }
+
+    void hex(unsigned int n)
+    {
+        char digits[8];
+        int count = 0;
+        do {
+            digits[count++] = "0123456789abcdef"[n & 0xf];
+            n >>= 4;
+        } while (n != 0);
+        while (count > 0)
+            text.push_back(digits[--count]);
+    }
+
+    void pad(size_t count) { text.append(count, ' '); }
+
+    std::string& text;
+
+protected:
+    SpirvText(const SpirvText&);
+    SpirvText& operator=(const SpirvText&);
+};
+
+// Number of decimal digits in 'n'
+static size_t DecimalDigits(unsigned int n)
 {
-    out << std::endl << "Disassembly failed: " << message << std::endl;
-    exit(1);
+    size_t count = 1;
+    while (n >= 10) {
+        n /= 10;
+        ++count;
+    }
+    return count;
 }
 
 // used to identify the extended instruction library imported when printing
@@ -96,7 +145,9 @@ enum ExtInstSet {
 // Container class for a single instance of a SPIR-V stream, with methods for disassembly.
 class SpirvStream {
 public:
-    SpirvStream(std::ostream& out, const std::vector<unsigned int>& stream) : out(out), stream(stream), word(0), nextNestedControl(0) { }
+    // 'sink', if any, receives what was disassembled so far when disassembly fails
+    SpirvStream(std::string& text, std::ostream* sink, const std::vector<unsigned int>& stream) :
+        out(text), sink(sink), stream(stream), word(0), nextNestedControl(0) { }
     virtual ~SpirvStream() { }
 
     void validate();
@@ -107,9 +158,11 @@ protected:
     SpirvStream& operator=(const SpirvStream&);
     Op getOpCode(int id) const { return idInstruction[id] ? (Op)(stream[idInstruction[id]] & OpCodeMask) : OpNop; }
 
+    void Kill(const char* message);
+
     // Output methods
     void outputIndent();
-    void formatId(Id id, std::stringstream&);
+    void outputAlignedId(Id id, size_t width);
     void outputResultId(Id id);
     void outputTypeId(Id id);
     void outputId(Id id);
@@ -120,7 +173,8 @@ protected:
     void disassembleInstruction(Id resultId, Id typeId, Op opCode, int numOperands);
 
     // Data
-    std::ostream& out;                       // where to write the disassembly
+    SpirvText out;                           // where to write the disassembly
+    std::ostream* sink;                      // where a failed disassembly goes
     const std::vector<unsigned int>& stream; // the actual word stream
     int size;                                // the size of the word stream
     int word;                                // the next word of the stream to read
@@ -129,7 +183,13 @@ protected:
     Id bound;
     std::vector<unsigned int> idInstruction;  // the word offset into the stream where the instruction for result [id] starts; 0 if not yet seen (forward reference or function parameter)
 
-    std::vector<std::string> idDescriptor;    // the best text string known for explaining the <id>
+    // the best text string known for explaining the <id>: a name in the stream, a
+    // literal, or one of the composed descriptors; nullptr if none
+    std::vector<const char*> idDescriptor;
+    std::deque<std::string> composedDescriptors;
+
+    bool hasDescriptor(Id id) const { return idDescriptor[id] != nullptr && *idDescriptor[id] != 0; }
+    const char* descriptor(Id id) const { return idDescriptor[id] != nullptr ? idDescriptor[id] : ""; }
 
     // schema
     unsigned int schema;
@@ -137,13 +197,29 @@ protected:
     // stack of structured-merge points
     std::stack<Id> nestedControl;
     Id nextNestedControl;         // need a slight delay for when we are nested
+
+    // instruction boundaries, types and results, shared with the remapper
+    Parser parser;
 };
 
+void SpirvStream::Kill(const char* message)
+{
+    out << '\n' << "Disassembly failed: " << message << '\n';
+    if (sink != nullptr)
+        sink->write(out.text.data(), out.text.size());
+    else
+        std::cerr << "Disassembly failed: " << message << std::endl;
+    exit(1);
+}
+
 void SpirvStream::validate()
 {
     size = (int)stream.size();
     if (size < 4)
-        Kill(out, "stream is too short");
+        Kill("stream is too short");
+
+    // Most lines are under 64 characters, and there is roughly one line per 4 words
+    out.text.reserve(out.text.size() + stream.size() * 16);
 
     // Magic number
     if (stream[word++] != MagicNumber) {
@@ -152,57 +228,55 @@ void SpirvStream::validate()
     }
 
     // Version
-    out << "// Module Version " << std::hex << stream[word++] << std::endl;
+    out << "// Module Version ";
+    out.hex(stream[word++]);
+    out << '\n';
 
     // Generator's magic number
-    out << "// Generated by (magic number): " << std::hex << stream[word++] << std::dec << std::endl;
+    out << "// Generated by (magic number): ";
+    out.hex(stream[word++]);
+    out << '\n';
 
     // Result <id> bound
     bound = stream[word++];
     idInstruction.resize(bound);
-    idDescriptor.resize(bound);
-    out << "// Id's are bound by " << bound << std::endl;
-    out << std::endl;
+    idDescriptor.resize(bound, nullptr);
+    out << "// Id's are bound by " << bound << '\n';
+    out << '\n';
 
     // Reserved schema, must be 0 for now
     schema = stream[word++];
     if (schema != 0)
-        Kill(out, "bad schema, must be 0");
+        Kill("bad schema, must be 0");
 }
 
 // Loop over all the instructions, in order, processing each.
 // Boiler plate for each is handled here directly, the rest is dispatched.
 void SpirvStream::processInstructions()
 {
-    // Instructions
-    while (word < size) {
-        int instructionStart = word;
-
-        // Instruction wordCount and opcode
-        unsigned int firstWord = stream[word];
-        unsigned wordCount = firstWord >> WordCountShift;
-        Op opCode = (Op)(firstWord & OpCodeMask);
-        int nextInst = word + wordCount;
-        ++word;
+    parser.parse(stream.data(), stream.size());
 
-        // Presence of full instruction
-        if (nextInst > size)
-            Kill(out, "stream instruction terminated too early");
+    // Instructions
+    for (const Parser::Instruction& instruction : parser.getInstructions()) {
+        int instructionStart = instruction.offset;
+        Op opCode = instruction.opCode;
+        int nextInst = instructionStart + instruction.wordCount;
+        word = instructionStart + 1;
 
         // Base for computing number of operands; will be updated as more is learned
-        unsigned numOperands = wordCount - 1;
+        unsigned numOperands = instruction.wordCount - 1;
 
         // Type <id>
-        Id typeId = 0;
+        Id typeId = instruction.typeId;
         if (InstructionDesc[opCode].hasType()) {
-            typeId = stream[word++];
+            ++word;
             --numOperands;
         }
 
         // Result <id>
-        Id resultId = 0;
+        Id resultId = instruction.resultId;
         if (InstructionDesc[opCode].hasResult()) {
-            resultId = stream[word++];
+            ++word;
             --numOperands;
 
             // save instruction for future reference
@@ -213,13 +287,34 @@ void SpirvStream::processInstructions()
         outputTypeId(typeId);
         outputIndent();
 
+        // Operands the parser couldn't read aren't decoded
+        if (instruction.error != Parser::ErrorNone) {
+            out << (OpcodeString(opCode) + 2) << " ERROR, "
+                << (instruction.error == Parser::ErrorString ? "literal string runs past the end of the instruction"
+                                                              : "type size for the selector not found");
+            out << '\n';
+            continue;
+        }
+
         // Hand off the Op and all its operands
         disassembleInstruction(resultId, typeId, opCode, numOperands);
         if (word != nextInst) {
             out << " ERROR, incorrect number of operands consumed.  At " << word << " instead of " << nextInst << " instruction start was " << instructionStart;
             word = nextInst;
         }
-        out << std::endl;
+        out << '\n';
+    }
+
+    // Parsing only stops early at a word count of zero, after which no more
+    // instructions can be found, or at an instruction running past the end
+    const auto& instructions = parser.getInstructions();
+    const unsigned stop = instructions.empty() ? Parser::headerSize
+                                               : instructions.back().offset + instructions.back().wordCount;
+    if (stop < stream.size()) {
+        if ((stream[stop] >> WordCountShift) == 0)
+            out << "ERROR, word count of zero at word " << stop << '\n';
+        else
+            Kill("stream instruction terminated too early");
     }
 }
 
@@ -229,26 +324,31 @@ void SpirvStream::outputIndent()
         out << "  ";
 }
 
-void SpirvStream::formatId(Id id, std::stringstream& idStream)
+// Output an <id> and its descriptor right aligned in 'width' characters
+void SpirvStream::outputAlignedId(Id id, size_t width)
 {
-    if (id != 0) {
-        // On instructions with no IDs, this is called with "0", which does not
-        // have to be within ID bounds on null shaders.
-        if (id >= bound)
-            Kill(out, "Bad <id>");
-
-        idStream << id;
-        if (idDescriptor[id].size() > 0)
-            idStream << "(" << idDescriptor[id] << ")";
+    // On instructions with no IDs, this is called with "0", which does not
+    // have to be within ID bounds on null shaders.
+    if (id == 0) {
+        out.pad(width);
+        return;
     }
+
+    if (id >= bound)
+        Kill("Bad <id>");
+
+    size_t length = DecimalDigits(id);
+    if (hasDescriptor(id))
+        length += strlen(idDescriptor[id]) + 2;
+    if (length < width)
+        out.pad(width - length);
+
+    outputId(id);
 }
 
 void SpirvStream::outputResultId(Id id)
 {
-    const int width = 16;
-    std::stringstream idStream;
-    formatId(id, idStream);
-    out << std::setw(width) << std::right << idStream.str();
+    outputAlignedId(id, 16);
     if (id != 0)
         out << ":";
     else
@@ -260,19 +360,17 @@ void SpirvStream::outputResultId(Id id)
 
 void SpirvStream::outputTypeId(Id id)
 {
-    const int width = 12;
-    std::stringstream idStream;
-    formatId(id, idStream);
-    out << std::setw(width) << std::right << idStream.str() << " ";
+    outputAlignedId(id, 12);
+    out << " ";
 }
 
 void SpirvStream::outputId(Id id)
 {
     if (id >= bound)
-        Kill(out, "Bad <id>");
+        Kill("Bad <id>");
 
     out << id;
-    if (idDescriptor[id].size() > 0)
+    if (hasDescriptor(id))
         out << "(" << idDescriptor[id] << ")";
 }
 
@@ -350,7 +448,7 @@ void SpirvStream::disassembleInstruction(Id resultId, Id /*typeId*/, Op opCode,
         idDescriptor[resultId] = (const char*)(&stream[word]);
     }
     else {
-        if (resultId != 0 && idDescriptor[resultId].size() == 0) {
+        if (resultId != 0 && !hasDescriptor(resultId)) {
             switch (opCode) {
             case OpTypeInt:
                 switch (stream[word]) {
@@ -379,29 +477,35 @@ void SpirvStream::disassembleInstruction(Id resultId, Id /*typeId*/, Op opCode,
                 idDescriptor[resultId] = "ptr";
                 break;
             case OpTypeVector:
-                if (idDescriptor[stream[word]].size() > 0) {
-                    idDescriptor[resultId].append(idDescriptor[stream[word]].begin(), idDescriptor[stream[word]].begin() + 1);
-                    if (strstr(idDescriptor[stream[word]].c_str(), "8")) {
-                        idDescriptor[resultId].append("8");
+            {
+                std::string vectorDescriptor;
+                if (hasDescriptor(stream[word])) {
+                    const char* componentDescriptor = idDescriptor[stream[word]];
+                    vectorDescriptor.push_back(componentDescriptor[0]);
+                    if (strstr(componentDescriptor, "8")) {
+                        vectorDescriptor.append("8");
                     }
-                    if (strstr(idDescriptor[stream[word]].c_str(), "16")) {
-                        idDescriptor[resultId].append("16");
+                    if (strstr(componentDescriptor, "16")) {
+                        vectorDescriptor.append("16");
                     }
-                    if (strstr(idDescriptor[stream[word]].c_str(), "64")) {
-                        idDescriptor[resultId].append("64");
+                    if (strstr(componentDescriptor, "64")) {
+                        vectorDescriptor.append("64");
                     }
                 }
-                idDescriptor[resultId].append("vec");
+                vectorDescriptor.append("vec");
                 switch (stream[word + 1]) {
-                case 2:   idDescriptor[resultId].append("2");   break;
-                case 3:   idDescriptor[resultId].append("3");   break;
-                case 4:   idDescriptor[resultId].append("4");   break;
-                case 8:   idDescriptor[resultId].append("8");   break;
-                case 16:  idDescriptor[resultId].append("16");  break;
-                case 32:  idDescriptor[resultId].append("32");  break;
+                case 2:   vectorDescriptor.append("2");   break;
+                case 3:   vectorDescriptor.append("3");   break;
+                case 4:   vectorDescriptor.append("4");   break;
+                case 8:   vectorDescriptor.append("8");   break;
+                case 16:  vectorDescriptor.append("16");  break;
+                case 32:  vectorDescriptor.append("32");  break;
                 default: break;
                 }
+                composedDescriptors.push_back(vectorDescriptor);
+                idDescriptor[resultId] = composedDescriptors.back().c_str();
                 break;
+            }
             default:
                 break;
             }
@@ -466,7 +570,7 @@ void SpirvStream::disassembleInstruction(Id resultId, Id /*typeId*/, Op opCode,
             return;
         case OperandVariableIdLiteral:
             while (numOperands > 0) {
-                out << std::endl;
+                out << '\n';
                 outputResultId(0);
                 outputTypeId(0);
                 outputIndent();
@@ -479,7 +583,7 @@ void SpirvStream::disassembleInstruction(Id resultId, Id /*typeId*/, Op opCode,
             return;
         case OperandVariableLiteralId:
             while (numOperands > 0) {
-                out << std::endl;
+                out << '\n';
                 outputResultId(0);
                 outputTypeId(0);
                 outputIndent();
@@ -495,7 +599,7 @@ void SpirvStream::disassembleInstruction(Id resultId, Id /*typeId*/, Op opCode,
             --numOperands;
             if (opCode == OpExtInst) {
                 ExtInstSet extInstSet = GLSL450Inst;
-                const char* name = idDescriptor[stream[word - 2]].c_str();
+                const char* name = descriptor(stream[word - 2]);
                 if (0 == memcmp("OpenCL", name, 6)) {
                     extInstSet = OpenCLExtInst;
 #ifdef AMD_EXTENSIONS
@@ -707,15 +811,30 @@ static const char* GLSLextNVGetDebugNames(const char* name, unsigned entrypoint)
 }
 #endif
 
-void Disassemble(std::ostream& out, const std::vector<unsigned int>& stream)
+static void DisassembleText(std::string& text, const std::vector<unsigned int>& stream, std::ostream* sink)
 {
-    SpirvStream SpirvStream(out, stream);
+    SpirvStream SpirvStream(text, sink, stream);
     spv::Parameterize();
-    GLSLstd450GetDebugNames(GlslStd450DebugNames);
+
+    static std::once_flag debugNamesInitialized;
+    std::call_once(debugNamesInitialized, GLSLstd450GetDebugNames, GlslStd450DebugNames);
+
     SpirvStream.validate();
     SpirvStream.processInstructions();
 }
 
+void Disassemble(std::string& text, const std::vector<unsigned int>& stream)
+{
+    DisassembleText(text, stream, nullptr);
+}
+
+void Disassemble(std::ostream& out, const std::vector<unsigned int>& stream)
+{
+    std::string text;
+    DisassembleText(text, stream, &out);
+    out.write(text.data(), text.size());
+}
+
 #if ENABLE_OPT
 
 #include "spirv-tools/libspirv.h"
@@ -41,6 +41,7 @@
 #define disassembler_H
 
 #include <iostream>
+#include <string>
 #include <vector>
 
 namespace spv {
@@ -48,6 +49,9 @@ namespace spv {
     // disassemble with glslang custom disassembler
     void Disassemble(std::ostream& out, const std::vector<unsigned int>&);
 
+    // as above, appending the text to 'text'; this is the fast path the above uses
+    void Disassemble(std::string& text, const std::vector<unsigned int>&);
+
     // disassemble with SPIRV-Tools disassembler
     void SpirvToolsDisassemble(std::ostream& out, const std::vector<unsigned int>& stream);
 
@@ -44,6 +44,7 @@
 #include <cstdio>
 #include <cstring>
 #include <algorithm>
+#include <mutex>
 
 namespace spv {
     extern "C" {
@@ -1247,14 +1248,8 @@ EnumParameters SelectionControlParams[SelectControlCeiling];
 EnumParameters FunctionControlParams[FunctionControlCeiling];
 
 // Set up all the parameterizing descriptions of the opcodes, operands, etc.
-void Parameterize()
+static void ParameterizeTables()
 {
-    // only do this once.
-    static bool initialized = false;
-    if (initialized)
-        return;
-    initialized = true;
-
     // Exceptions to having a result <id> and a resulting type <id>.
     // (Everything is initialized to have both).
 
@@ -2569,4 +2564,12 @@ void Parameterize()
 #endif
 }
 
+// Fill in the tables exactly once.  Safe to call from any number of threads:
+// callers racing the first one wait until the tables are complete.
+void Parameterize()
+{
+    static std::once_flag initialized;
+    std::call_once(initialized, ParameterizeTables);
+}
+
 }; // end spv namespace
@@ -44,7 +44,7 @@
 
 namespace spv {
 
-// Fill in all the parameters
+// Fill in all the parameters.  Thread safe; after the first call this returns immediately.
 void Parameterize();
 
 // Return the English names of all the enums.
@@ -90,31 +90,27 @@ public:
     virtual ~Instruction() {}
     void addIdOperand(Id id) { operands.push_back(id); }
     void addImmediateOperand(unsigned int immediate) { operands.push_back(immediate); }
+    // The first character goes in the lowest-order 8 bits of the first word,
+    // whatever the host's byte order.
     void addStringOperand(const char* str)
     {
-        unsigned int word;
-        char* wordString = (char*)&word;
-        char* wordPtr = wordString;
+        unsigned int word = 0;
         int charCount = 0;
         char c;
         do {
             c = *(str++);
-            *(wordPtr++) = c;
+            word |= (unsigned int)(unsigned char)c << (8 * charCount);
             ++charCount;
             if (charCount == 4) {
                 addImmediateOperand(word);
-                wordPtr = wordString;
+                word = 0;
                 charCount = 0;
             }
         } while (c != 0);
 
-        // deal with partial last word
-        if (charCount > 0) {
-            // pad with 0s
-            for (; charCount < 4; ++charCount)
-                *(wordPtr++) = 0;
+        // deal with partial last word, already padded with 0s
+        if (charCount > 0)
             addImmediateOperand(word);
-        }
     }
     void setBlock(Block* b) { block = b; }
     Block* getBlock() const { return block; }
@@ -40,6 +40,9 @@
 #include <string>
 #include <fstream>
 #include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
 
 #include "./../glslang/Public/ShaderLang.h"
 
@@ -105,16 +108,26 @@ protected:
         for (auto it = directoryStack.rbegin(); it != directoryStack.rend(); ++it) {
             std::string path = *it + '/' + headerName;
             std::replace(path.begin(), path.end(), '\\', '/');
-            std::ifstream file(path, std::ios_base::binary | std::ios_base::ate);
-            if (file) {
+            IncludeResult* result = readFile(path);
+            if (result != nullptr) {
                 directoryStack.push_back(getDirectory(path));
-                return newIncludeResult(path, file, (int)file.tellg());
+                return result;
             }
         }
 
         return nullptr;
     }
 
+    // Read the file at 'path', or return nullptr if it can't be opened.
+    virtual IncludeResult* readFile(const std::string& path)
+    {
+        std::ifstream file(path, std::ios_base::binary | std::ios_base::ate);
+        if (! file)
+            return nullptr;
+
+        return newIncludeResult(path, file, (int)file.tellg());
+    }
+
     // Search for a valid <system> path.
     // Not implemented yet; returning nullptr signals failure to find.
     virtual IncludeResult* readSystemPath(const char* /*headerName*/) const
@@ -139,3 +152,67 @@ protected:
         return last == std::string::npos ? "." : path.substr(0, last);
     }
 };
+
+// Thread-safe cache of file contents, to share between includers so a header
+// included by many compiles in one process is read only once.  Files that
+// can't be opened are remembered too, since most include-path probes miss.
+class FileIncludeCache {
+public:
+    typedef std::shared_ptr<const std::string> Contents;
+
+    // The contents of 'path', or nullptr if it can't be opened.
+    Contents get(const std::string& path)
+    {
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            auto it = files.find(path);
+            if (it != files.end())
+                return it->second;
+        }
+
+        // Read outside the lock; if two threads race, both read the same text.
+        Contents contents;
+        std::ifstream file(path, std::ios_base::binary | std::ios_base::ate);
+        if (file) {
+            std::string text((size_t)file.tellg(), '\0');
+            file.seekg(0, file.beg);
+            file.read(&text[0], text.size());
+            contents = std::make_shared<const std::string>(std::move(text));
+        }
+
+        std::lock_guard<std::mutex> guard(mutex);
+        return files.insert(std::make_pair(path, contents)).first->second;
+    }
+
+protected:
+    std::mutex mutex;
+    std::map<std::string, Contents> files;
+};
+
+// DirStackFileIncluder that reads through a FileIncludeCache.
+class CachingFileIncluder : public DirStackFileIncluder {
+public:
+    explicit CachingFileIncluder(FileIncludeCache& cache) : cache(cache) { }
+
+    virtual void releaseInclude(IncludeResult* result) override
+    {
+        if (result != nullptr) {
+            delete static_cast<FileIncludeCache::Contents*>(result->userData);
+            delete result;
+        }
+    }
+
+protected:
+    // The result holds a reference to the cached text, rather than a copy.
+    virtual IncludeResult* readFile(const std::string& path) override
+    {
+        FileIncludeCache::Contents contents = cache.get(path);
+        if (! contents)
+            return nullptr;
+
+        return new IncludeResult(path, contents->data(), contents->size(),
+                                 new FileIncludeCache::Contents(contents));
+    }
+
+    FileIncludeCache& cache;
+};
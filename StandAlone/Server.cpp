@@ -0,0 +1,396 @@
+//
+// Copyright (C) 2018 LunarG, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+//    Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//    Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//    Neither the name of 3Dlabs Inc. Ltd. nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "Server.h"
+
+#ifndef _WIN32
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+// Limits on what a client may send, so a bad request can't make the server
+// allocate without bound: the number of strings (the directory and the
+// arguments), and the bytes of all of them together.
+const uint32_t MaxRequestStrings = 64 * 1024;
+const uint32_t MaxRequestBytes = 16 * 1024 * 1024;
+
+// The largest output frame a server sends.
+const uint32_t MaxFrameSize = 16 * 1024;
+
+// Write all of 'size' bytes, retrying on interruption.
+bool WriteAll(int fd, const void* data, size_t size)
+{
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        bytes += written;
+        size -= written;
+    }
+
+    return true;
+}
+
+// Read exactly 'size' bytes; false on error or early end of stream.
+bool ReadAll(int fd, void* data, size_t size)
+{
+    char* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t got = read(fd, bytes, size);
+        if (got < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        if (got == 0)
+            return false;
+        bytes += got;
+        size -= got;
+    }
+
+    return true;
+}
+
+bool WriteString(int fd, const std::string& str)
+{
+    const uint32_t length = (uint32_t)str.size();
+    return WriteAll(fd, &length, sizeof(length)) && WriteAll(fd, str.data(), str.size());
+}
+
+// Read a string of at most 'maxLength' bytes; false if it's longer.
+bool ReadString(int fd, std::string& str, uint32_t maxLength)
+{
+    uint32_t length;
+    if (! ReadAll(fd, &length, sizeof(length)) || length > maxLength)
+        return false;
+    str.resize(length);
+    return length == 0 || ReadAll(fd, &str[0], length);
+}
+
+bool WriteFrame(int fd, glslang::TServerFrame kind, const void* data, uint32_t size)
+{
+    const uint8_t frameKind = (uint8_t)kind;
+    return WriteAll(fd, &frameKind, sizeof(frameKind)) &&
+           WriteAll(fd, &size, sizeof(size)) &&
+           WriteAll(fd, data, size);
+}
+
+// Fill in a Unix domain socket address; false if the path doesn't fit.
+bool MakeAddress(const char* socketPath, sockaddr_un& address)
+{
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(socketPath) >= sizeof(address.sun_path))
+        return false;
+    strcpy(address.sun_path, socketPath);
+
+    return true;
+}
+
+// In the process that runs the command: point stdout and stderr at the given
+// pipes, move to the client's directory, and run it.  Never returns.
+void RunCommand(const std::vector<std::string>& request, int outFd, int errFd,
+                glslang::TServerCommand command)
+{
+    dup2(outFd, STDOUT_FILENO);
+    dup2(errFd, STDERR_FILENO);
+    close(outFd);
+    close(errFd);
+
+    if (chdir(request[0].c_str()) != 0) {
+        fprintf(stderr, "glslang server: can't change to directory %s\n", request[0].c_str());
+        _exit(EXIT_FAILURE);
+    }
+
+    std::vector<char*> argv;
+    for (size_t a = 1; a < request.size(); ++a)
+        argv.push_back(const_cast<char*>(request[a].c_str()));
+    argv.push_back(nullptr);
+
+    // exit(), rather than _exit(), so stdio is flushed just as it would be
+    // if the command had called exit() itself.
+    exit(command((int)argv.size() - 1, argv.data()));
+}
+
+// Serve one connection: read the request, run it in a child process, and
+// relay that process's output and exit code.  Runs in its own process.
+void ServeConnection(int connection, glslang::TServerCommand command)
+{
+    uint32_t count;
+    std::vector<std::string> request;
+    if (! ReadAll(connection, &count, sizeof(count)) || count < 2 || count > MaxRequestStrings)
+        return;
+    request.resize(count);
+    uint32_t remaining = MaxRequestBytes;
+    for (uint32_t s = 0; s < count; ++s) {
+        if (! ReadString(connection, request[s], remaining))
+            return;
+        remaining -= (uint32_t)request[s].size();
+    }
+
+    int outPipe[2];
+    int errPipe[2];
+    if (pipe(outPipe) != 0)
+        return;
+    if (pipe(errPipe) != 0)
+        return;
+
+    const pid_t child = fork();
+    if (child < 0)
+        return;
+    if (child == 0) {
+        close(connection);
+        close(outPipe[0]);
+        close(errPipe[0]);
+        RunCommand(request, outPipe[1], errPipe[1], command);
+    }
+
+    close(outPipe[1]);
+    close(errPipe[1]);
+
+    // Relay both streams until the command closes them.
+    pollfd fds[2] = { { outPipe[0], POLLIN, 0 }, { errPipe[0], POLLIN, 0 } };
+    const glslang::TServerFrame kinds[2] = { glslang::EFrameStdout, glslang::EFrameStderr };
+    int openStreams = 2;
+    char buffer[MaxFrameSize];
+    while (openStreams > 0) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        for (int f = 0; f < 2; ++f) {
+            if (fds[f].fd < 0 || fds[f].revents == 0)
+                continue;
+            ssize_t got = read(fds[f].fd, buffer, sizeof(buffer));
+            if (got < 0 && errno == EINTR)
+                continue;
+            if (got <= 0) {
+                close(fds[f].fd);
+                fds[f].fd = -1;
+                --openStreams;
+            } else
+                WriteFrame(connection, kinds[f], buffer, (uint32_t)got);
+        }
+    }
+
+    int status = 0;
+    while (waitpid(child, &status, 0) < 0 && errno == EINTR)
+        ;
+    int exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE;
+    WriteFrame(connection, glslang::EFrameExit, &exitCode, sizeof(exitCode));
+}
+
+} // end anonymous namespace
+
+namespace glslang {
+
+bool CompilerServerSupported()
+{
+    return true;
+}
+
+int RunCompilerServer(const char* socketPath, TServerCommand command)
+{
+    sockaddr_un address;
+    if (! MakeAddress(socketPath, address)) {
+        fprintf(stderr, "glslang server: socket path too long: %s\n", socketPath);
+        return EXIT_FAILURE;
+    }
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        perror("glslang server: socket");
+        return EXIT_FAILURE;
+    }
+
+    // A socket left over from an earlier server would make bind() fail, but
+    // anything else at that path isn't ours to remove.
+    struct stat info;
+    if (lstat(socketPath, &info) == 0) {
+        if (! S_ISSOCK(info.st_mode)) {
+            fprintf(stderr, "glslang server: %s exists and is not a socket\n", socketPath);
+            close(listener);
+            return EXIT_FAILURE;
+        }
+        unlink(socketPath);
+    }
+
+    // Requests run as this user, so only this user may connect: the socket
+    // is made read-write for this user only (0600).
+    const mode_t mask = umask(S_IXUSR | S_IRWXG | S_IRWXO);
+    const bool bound = bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    umask(mask);
+    if (! bound || listen(listener, SOMAXCONN) != 0) {
+        perror("glslang server: bind");
+        close(listener);
+        return EXIT_FAILURE;
+    }
+
+    // Connection processes are never waited for; let the system reap them.
+    signal(SIGCHLD, SIG_IGN);
+    signal(SIGPIPE, SIG_IGN);
+
+    for (;;) {
+        int connection = accept(listener, nullptr, nullptr);
+        if (connection < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            perror("glslang server: accept");
+            close(listener);
+            return EXIT_FAILURE;
+        }
+
+        const pid_t handler = fork();
+        if (handler == 0) {
+            close(listener);
+            // This process waits for its command's process.
+            signal(SIGCHLD, SIG_DFL);
+            ServeConnection(connection, command);
+            close(connection);
+            _exit(EXIT_SUCCESS);
+        }
+        close(connection);
+    }
+}
+
+int RunCompilerClient(const char* socketPath, int argc, char* argv[])
+{
+    sockaddr_un address;
+    if (! MakeAddress(socketPath, address)) {
+        fprintf(stderr, "glslang client: socket path too long: %s\n", socketPath);
+        return EClientNoServer;
+    }
+
+    int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (connection < 0 ||
+        connect(connection, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        fprintf(stderr, "glslang client: can't connect to server at %s\n", socketPath);
+        if (connection >= 0)
+            close(connection);
+        return EClientNoServer;
+    }
+
+    std::vector<char> cwd(4096);
+    while (getcwd(cwd.data(), cwd.size()) == nullptr) {
+        if (errno != ERANGE) {
+            fprintf(stderr, "glslang client: can't get the working directory\n");
+            close(connection);
+            return EClientNoServer;
+        }
+        cwd.resize(cwd.size() * 2);
+    }
+
+    const uint32_t count = (uint32_t)argc + 1;
+    bool sent = WriteAll(connection, &count, sizeof(count)) && WriteString(connection, cwd.data());
+    for (int a = 0; sent && a < argc; ++a)
+        sent = WriteString(connection, argv[a]);
+    // From here on the server may be running the command, so whatever goes
+    // wrong, the command must not be run again locally.
+    if (! sent) {
+        fprintf(stderr, "glslang client: lost connection to server\n");
+        close(connection);
+        return EClientLostServer;
+    }
+
+    // Relay frames until the exit code arrives.
+    int exitCode = EClientLostServer;
+    std::string payload;
+    for (;;) {
+        uint8_t kind;
+        if (! ReadAll(connection, &kind, sizeof(kind)) || ! ReadString(connection, payload, MaxFrameSize))
+            break;
+        if (kind == EFrameStdout)
+            fwrite(payload.data(), 1, payload.size(), stdout);
+        else if (kind == EFrameStderr)
+            fwrite(payload.data(), 1, payload.size(), stderr);
+        else if (kind == EFrameExit && payload.size() == sizeof(exitCode)) {
+            memcpy(&exitCode, payload.data(), sizeof(exitCode));
+            if (exitCode < 0)
+                exitCode = EXIT_FAILURE;
+            break;
+        }
+    }
+
+    close(connection);
+    if (exitCode == EClientLostServer)
+        fprintf(stderr, "glslang client: lost connection to server\n");
+
+    return exitCode;
+}
+
+} // end namespace glslang
+
+#else // _WIN32
+
+namespace glslang {
+
+bool CompilerServerSupported()
+{
+    return false;
+}
+
+int RunCompilerServer(const char*, TServerCommand)
+{
+    return 1;
+}
+
+int RunCompilerClient(const char*, int, char*[])
+{
+    return EClientNoServer;
+}
+
+} // end namespace glslang
+
+#endif // _WIN32
@@ -0,0 +1,95 @@
+//
+// Copyright (C) 2018 LunarG, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+//    Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//    Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//    Neither the name of 3Dlabs Inc. Ltd. nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+//
+// Compiler server for glslangValidator.
+//
+// A server process warms up the built-in symbol tables once, then listens on
+// a Unix domain socket.  Each request carries a working directory and a full
+// command line; the server forks a process per request, which inherits the warm
+// tables, runs the command line as glslangValidator would, and streams its
+// stdout, stderr and exit code back to the client.  Requests are served
+// concurrently, one process each, so per-invocation global state never leaks
+// between them.
+//
+// The client forwards its own command line and working directory, writes what
+// comes back to its own stdout and stderr, and exits with the same code.
+//
+// The socket is only accessible to the user running the server, as requests
+// run with the server's privileges.
+//
+// Wire format, in host byte order (both ends are on the same machine):
+//   request:  uint32 count, then 'count' strings (working directory first,
+//             then argv[0], argv[1], ...), each as uint32 length + bytes
+//   response: a sequence of frames, each uint8 kind + uint32 length + bytes;
+//             kind is one of TServerFrame, and EFrameExit (4-byte int payload)
+//             is always last
+//
+
+#ifndef GLSLANG_SERVER_H_INCLUDED
+#define GLSLANG_SERVER_H_INCLUDED
+
+namespace glslang {
+
+    enum TServerFrame {
+        EFrameStdout = 1,
+        EFrameStderr = 2,
+        EFrameExit   = 3,
+    };
+
+    // Runs one command line, in the request's process; returns the exit code.
+    typedef int (*TServerCommand)(int argc, char* argv[]);
+
+    // Listens on 'socketPath' forever, running 'command' for each request.
+    // Only returns on failure to set up the socket, with a non-zero code.
+    int RunCompilerServer(const char* socketPath, TServerCommand command);
+
+    // What RunCompilerClient() returns when it has no exit code from the server.
+    enum TClientFailure {
+        EClientNoServer   = -1,   // couldn't connect; nothing was sent, so it's safe to run locally
+        EClientLostServer = -2,   // connected, but the connection failed before the exit code
+                                  // came, possibly after relaying some of the command's output
+    };
+
+    // Sends argc/argv to the server on 'socketPath' and relays its output.
+    // Returns the server's exit code for the command, or a TClientFailure.
+    int RunCompilerClient(const char* socketPath, int argc, char* argv[]);
+
+    // False on platforms without Unix domain sockets and fork().
+    bool CompilerServerSupported();
+
+} // end namespace glslang
+
+#endif // GLSLANG_SERVER_H_INCLUDED
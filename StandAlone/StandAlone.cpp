@@ -41,6 +41,7 @@
 
 #include "ResourceLimits.h"
 #include "Worklist.h"
+#include "Server.h"
 #include "DirStackFileIncluder.h"
 #include "./../glslang/Include/ShHandle.h"
 #include "./../glslang/Include/revision.h"
@@ -55,8 +56,15 @@
 #include <cctype>
 #include <cmath>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
 #include <thread>
 
 #include "../glslang/OSDependent/osinclude.h"
@@ -114,7 +122,8 @@ enum TFailCode {
     EFailLink,
     EFailCompilerCreate,
     EFailThreadCreate,
-    EFailLinkerCreate
+    EFailLinkerCreate,
+    EFailServer
 };
 
 //
@@ -124,12 +133,23 @@ EShLanguage FindLanguage(const std::string& name, bool parseSuffix=true);
 void CompileFile(const char* fileName, ShHandle);
 void usage();
 char* ReadFileData(const char* fileName);
+size_t GetFileSize(const char* fileName);
 void FreeFileData(char* data);
+
+// A shader file's text, mapped into memory where possible so it is never copied.
+// Not necessarily null-terminated.
+struct TFileData {
+    const char* text;
+    size_t size;
+    bool mapped;    // otherwise, from ReadFileData() or strdup()
+};
+TFileData MapFileData(const char* fileName);
+void FreeFileData(const TFileData& data);
 void InfoLogMsg(const char* msg, const char* name, const int num);
 
 // Globally track if any compile or link failure.
-bool CompileFailed = false;
-bool LinkFailed = false;
+std::atomic<bool> CompileFailed(false);
+std::atomic<bool> LinkFailed(false);
 
 // array of unique places to leave the shader names and infologs for the asynchronous compiles
 std::vector<std::unique_ptr<glslang::TWorkItem>> WorkItems;
@@ -168,6 +188,9 @@ glslang::EShTargetClientVersion OpenGLClientVersion =
 glslang::EShTargetLanguageVersion TargetVersion =
                           glslang::EShTargetSpv_1_0;    // maps to, say, SPIR-V 1.0
 std::vector<std::string> Processes;                     // what should be recorded by OpModuleProcessed, or equivalent
+int NumThreads = 0;                                     // for -t; 0 means one per hardware thread
+bool SpvPerFile = false;                                // --spv-per-file
+bool TimePhases = false;                                // --time-phases
 
 // Per descriptor-set binding base data
 typedef std::map<unsigned int, unsigned int> TPerSetBaseBinding;
@@ -179,7 +202,8 @@ std::array<std::vector<std::string>, EShLangCount> baseResourceSetBinding;
 // Add things like "#define ..." to a preamble to use in the beginning of the shader.
 class TPreamble {
 public:
-    TPreamble() { }
+    // -D and -U are also recorded in 'processes', for OpModuleProcessed
+    explicit TPreamble(std::vector<std::string>& processes) : processes(processes) { }
 
     bool isSet() const { return text.size() > 0; }
     const char* get() const { return text.c_str(); }
@@ -190,8 +214,8 @@ public:
         text.append("#define ");
         fixLine(def);
 
-        Processes.push_back("D");
-        Processes.back().append(def);
+        processes.push_back("D");
+        processes.back().append(def);
 
         // The first "=" needs to turn into a space
         const size_t equal = def.find_first_of("=");
@@ -208,8 +232,8 @@ public:
         text.append("#undef ");
         fixLine(undef);
 
-        Processes.push_back("U");
-        Processes.back().append(undef);
+        processes.push_back("U");
+        processes.back().append(undef);
 
         text.append(undef);
         text.append("\n");
@@ -225,9 +249,53 @@ protected:
     }
 
     std::string text;  // contents of preamble
+    std::vector<std::string>& processes;
 };
 
-TPreamble UserPreamble;
+TPreamble UserPreamble(Processes);
+
+//
+// One entry of a --manifest file: a source file, and the settings to compile
+// it with on top of those from the command line.
+//
+// Each non-blank line not starting with '#' is an entry, made of
+// whitespace-separated words:
+//
+//     <source> [-S <stage>] [-e <name>] [-D<macro>[=<value>]]... [-U<macro>]... [-o <file>]
+//
+// The same source can appear on any number of lines, e.g., once per variant.
+// A relative -o is taken from --manifest-output-dir, if given, so a manifest
+// needn't know where its outputs go.
+//
+struct TManifestEntry {
+    TManifestEntry() : preamble(processes) { }
+
+    std::string stage;                   // if empty, from the file name (or -S)
+    std::string entryPoint;              // if empty, from -e
+    std::string output;                  // if empty, <source>.spv; see ManifestOutputPath()
+    std::vector<std::string> processes;
+    TPreamble preamble;                  // added after the command line's -D/-U
+
+private:
+    TManifestEntry(const TManifestEntry&);
+    TManifestEntry& operator=(const TManifestEntry&);
+};
+
+// manifest entries, by the work item they describe
+std::map<const glslang::TWorkItem*, std::unique_ptr<TManifestEntry>> ManifestEntries;
+const char* ManifestOutputDirectory = nullptr;  // --manifest-output-dir
+
+// Where an entry's -o names, within --manifest-output-dir unless absolute.
+std::string ManifestOutputPath(const TManifestEntry& entry)
+{
+    const std::string& output = entry.output;
+    const bool absolute = output[0] == '/' || output[0] == '\\' || (output.size() > 1 && output[1] == ':');
+    if (ManifestOutputDirectory == nullptr || absolute)
+        return output;
+
+    return std::string(ManifestOutputDirectory) + "/" + output;
+}
+FileIncludeCache IncludeCache;
 
 //
 // Create the default name for saving a binary if -o is not provided.
@@ -251,6 +319,219 @@ const char* GetBinaryName(EShLanguage stage)
     return name;
 }
 
+//
+// Content-addressed output, for --dedup-dir: each distinct module is written
+// once, as <dir>/<hash>.spv, and <dir>/index.txt maps each requested output
+// name to the hash of its module, one "<hash> <name>" per line.  Several runs
+// can share a directory: files are written under names unique to this process
+// and renamed into place, and the index is merged under <dir>/index.txt.lock.
+//
+const char* DedupDirectory = nullptr;
+std::mutex DedupMutex;   // guards the two maps below, not the files
+std::map<std::string, std::string> DedupIndex;  // output name -> hash
+// Held while checking or writing <hash>.spv, so threads with different modules
+// don't wait on each other.
+std::map<std::string, std::unique_ptr<std::mutex>> DedupHashMutexes;
+
+// A suffix for temporary files, unique to this process.
+const std::string& DedupTempSuffix()
+{
+    static const std::string suffix = [] {
+        std::random_device random;
+        char text[40];
+        snprintf(text, sizeof(text), ".%08x%08x.tmp", (unsigned int)random(),
+                 (unsigned int)std::chrono::steady_clock::now().time_since_epoch().count());
+        return std::string(text);
+    }();
+
+    return suffix;
+}
+
+// 64-bit FNV-1a of the module's bytes, in hex.
+std::string HashSpirv(const std::vector<unsigned int>& spirv)
+{
+    unsigned long long hash = 0xcbf29ce484222325ULL;
+    for (size_t w = 0; w < spirv.size(); ++w) {
+        for (int b = 0; b < 4; ++b) {
+            hash ^= (spirv[w] >> (8 * b)) & 0xff;
+            hash *= 0x100000001b3ULL;
+        }
+    }
+
+    char text[17];
+    snprintf(text, sizeof(text), "%016llx", hash);
+
+    return text;
+}
+
+// Write 'spirv' to 'path', giving false on failure.
+bool WriteSpirvFile(const std::string& path, const std::vector<unsigned int>& spirv)
+{
+    std::ofstream out(path, std::ios_base::binary);
+    out.write((const char*)spirv.data(), spirv.size() * sizeof(unsigned int));
+    out.close();
+
+    return ! out.fail();
+}
+
+// True if the file at 'path' holds exactly 'spirv'.
+bool FileHoldsSpirv(const std::string& path, const std::vector<unsigned int>& spirv)
+{
+    std::ifstream file(path, std::ios_base::binary | std::ios_base::ate);
+    if (! file || (size_t)file.tellg() != spirv.size() * sizeof(unsigned int))
+        return false;
+
+    std::vector<unsigned int> existing(spirv.size());
+    file.seekg(0, file.beg);
+    file.read((char*)existing.data(), existing.size() * sizeof(unsigned int));
+
+    return file && existing == spirv;
+}
+
+//
+// Save a generated module under the name it was requested as, or with
+// --dedup-dir, under its hash, recording the name in the index.  Errors
+// from the latter are appended to 'results'.
+//
+void OutputSpirv(const std::vector<unsigned int>& spirv, const std::string& name, std::string& results)
+{
+    if (DedupDirectory == nullptr) {
+        if (Options & EOptionOutputHexadecimal)
+            glslang::OutputSpvHex(spirv, name.c_str(), variableName);
+        else
+            glslang::OutputSpvBin(spirv, name.c_str());
+        return;
+    }
+
+    const std::string hash = HashSpirv(spirv);
+    const std::string path = std::string(DedupDirectory) + "/" + hash + ".spv";
+
+    std::mutex* hashMutex;
+    {
+        std::lock_guard<std::mutex> guard(DedupMutex);
+        std::unique_ptr<std::mutex>& entry = DedupHashMutexes[hash];
+        if (entry == nullptr)
+            entry.reset(new std::mutex);
+        hashMutex = entry.get();
+    }
+
+    // The module may be there already, from this run or another; only a
+    // module with the same words can stand for this one.
+    {
+        std::lock_guard<std::mutex> guard(*hashMutex);
+        if (! FileHoldsSpirv(path, spirv)) {
+            if (std::ifstream(path)) {
+                results.append("ERROR: " + path + " holds a different module with the same hash; not replacing it for " +
+                               name + "\n");
+                CompileFailed = true;
+                return;
+            }
+            const std::string tempName = path + DedupTempSuffix();
+            if (! WriteSpirvFile(tempName, spirv) ||
+                (rename(tempName.c_str(), path.c_str()) != 0 && ! FileHoldsSpirv(path, spirv))) {
+                remove(tempName.c_str());
+                results.append("ERROR: Failed to write file: " + path + "\n");
+                CompileFailed = true;
+                return;
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(DedupMutex);
+    DedupIndex[name] = hash;
+}
+
+//
+// Merge this run's names into the --dedup-dir index, which other runs may share.
+//
+void OutputDedupIndex()
+{
+    const std::string indexName = std::string(DedupDirectory) + "/index.txt";
+
+    // Other runs merge theirs the same way, so take turns.  If the lock
+    // stays taken, it's likely left over from a run that was killed.
+    const std::string lockName = indexName + ".lock";
+    FILE* lock = nullptr;
+    for (int attempt = 0; attempt < 1000; ++attempt) {
+        lock = fopen(lockName.c_str(), "wx");
+        if (lock != nullptr)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (lock == nullptr) {
+        printf("ERROR: Can't lock %s; remove %s if no other run is using it\n",
+               indexName.c_str(), lockName.c_str());
+        CompileFailed = true;
+        return;
+    }
+    fclose(lock);
+
+    std::map<std::string, std::string> index;
+    std::ifstream existing(indexName);
+    std::string line;
+    while (std::getline(existing, line)) {
+        const size_t space = line.find(' ');
+        if (space != std::string::npos)
+            index[line.substr(space + 1)] = line.substr(0, space);
+    }
+    existing.close();
+
+    for (auto it = DedupIndex.begin(); it != DedupIndex.end(); ++it)
+        index[it->first] = it->second;
+
+    // Replace it in one step, so a reader never sees a partial index.
+    const std::string tempName = indexName + DedupTempSuffix();
+    std::ofstream out(tempName, std::ios_base::binary);
+    for (auto it = index.begin(); it != index.end(); ++it)
+        out << it->second << ' ' << it->first << '\n';
+    out.close();
+    if (! out || rename(tempName.c_str(), indexName.c_str()) != 0) {
+        remove(tempName.c_str());
+        printf("ERROR: Failed to write file: %s\n", indexName.c_str());
+        CompileFailed = true;
+    }
+
+    remove(lockName.c_str());
+}
+
+//
+// --time-phases: phase times summed over every shader and program compiled,
+// and over all threads.
+//
+std::mutex PhaseTimesMutex;
+glslang::TPhaseTimes PhaseTimes;
+int TimedShaders = 0;
+
+void AddPhaseTimes(const glslang::TPhaseTimes& times, int numShaders)
+{
+    std::lock_guard<std::mutex> guard(PhaseTimesMutex);
+    PhaseTimes.add(times);
+    TimedShaders += numShaders;
+}
+
+void OutputPhaseTimes()
+{
+    const struct {
+        const char* name;
+        double seconds;
+    } phases[] = {
+        { "built-ins",   PhaseTimes.builtIns },
+        { "preprocess",  PhaseTimes.preprocess },
+        { "parse",       PhaseTimes.parse },
+        { "link",        PhaseTimes.link },
+        { "io mapping",  PhaseTimes.ioMap },
+        { "reflection",  PhaseTimes.reflection },
+        { "spirv",       PhaseTimes.spirv },
+        { "optimize",    PhaseTimes.optimize },
+        { "output",      PhaseTimes.output },
+        { "total",       PhaseTimes.total() },
+    };
+
+    printf("Phase times (ms) for %d shader%s:\n", TimedShaders, TimedShaders == 1 ? "" : "s");
+    for (const auto& phase : phases)
+        printf("  %-12s %10.3f\n", phase.name, phase.seconds * 1000.0);
+}
+
 //
 // *.conf => this is a config file that can set limits/resources
 //
@@ -365,6 +646,49 @@ void ProcessResourceSetBindingBase(int& argc, char**& argv, std::array<std::vect
     }
 }
 
+//
+// Add a work item for each entry in a --manifest file.
+//
+void ReadManifest(std::vector<std::unique_ptr<glslang::TWorkItem>>& workItems, const char* fileName)
+{
+    std::ifstream manifest(fileName);
+    if (! manifest)
+        Error("unable to open manifest file");
+
+    std::string line;
+    for (int lineNumber = 1; std::getline(manifest, line); ++lineNumber) {
+        std::istringstream words(line);
+        std::string source;
+        if (! (words >> source) || source[0] == '#')
+            continue;
+
+        const std::string where = std::string(fileName) + ":" + std::to_string(lineNumber) + ": ";
+        std::unique_ptr<TManifestEntry> entry(new TManifestEntry);
+        std::string word;
+        while (words >> word) {
+            if (word == "-S" || word == "-e" || word == "-o") {
+                std::string operand;
+                if (! (words >> operand))
+                    Error((where + word + " needs an operand").c_str());
+                if (word == "-S")
+                    entry->stage = operand;
+                else if (word == "-e")
+                    entry->entryPoint = operand;
+                else
+                    entry->output = operand;
+            } else if (word.compare(0, 2, "-D") == 0 && word.size() > 2)
+                entry->preamble.addDef(word.substr(2));
+            else if (word.compare(0, 2, "-U") == 0 && word.size() > 2)
+                entry->preamble.addUndef(word.substr(2));
+            else
+                Error((where + "unknown manifest option " + word).c_str());
+        }
+
+        workItems.push_back(std::unique_ptr<glslang::TWorkItem>(new glslang::TWorkItem(source)));
+        ManifestEntries[workItems.back().get()] = std::move(entry);
+    }
+}
+
 //
 // Do all command-line argument parsing.  This includes building up the work-items
 // to be processed later, and saving all the command-line options.
@@ -446,6 +770,11 @@ void ProcessArguments(std::vector<std::unique_ptr<glslang::TWorkItem>>& workItem
                                 Error("--client expects vulkan100 or opengl100");
                         }
                         bumpArg();
+                    } else if (lowerword == "dedup-dir") {
+                        if (argc <= 1)
+                            Error("no <dir> provided for --dedup-dir");
+                        DedupDirectory = argv[1];
+                        bumpArg();
                     } else if (lowerword == "flatten-uniform-arrays" || // synonyms
                                lowerword == "flatten-uniform-array"  ||
                                lowerword == "fua") {
@@ -464,6 +793,17 @@ void ProcessArguments(std::vector<std::unique_ptr<glslang::TWorkItem>>& workItem
                     } else if (lowerword == "keep-uncalled" || // synonyms
                                lowerword == "ku") {
                         Options |= EOptionKeepUncalled;
+                    } else if (lowerword == "manifest") {
+                        if (argc <= 1)
+                            Error("no <file> provided for --manifest");
+                        ReadManifest(workItems, argv[1]);
+                        SpvPerFile = true;
+                        bumpArg();
+                    } else if (lowerword == "manifest-output-dir") {
+                        if (argc <= 1)
+                            Error("no <dir> provided for --manifest-output-dir");
+                        ManifestOutputDirectory = argv[1];
+                        bumpArg();
                     } else if (lowerword == "no-storage-format" || // synonyms
                                lowerword == "nsf") {
                         Options |= EOptionNoStorageFormat;
@@ -509,11 +849,23 @@ void ProcessArguments(std::vector<std::unique_ptr<glslang::TWorkItem>>& workItem
                         break;
                     } else if (lowerword == "spirv-dis") {
                         SpvToolsDisassembler = true;
+                    } else if (lowerword == "spv-per-file") {
+                        SpvPerFile = true;
                     } else if (lowerword == "stdin") {
                         Options |= EOptionStdin;
                         shaderStageName = argv[1];
                     } else if (lowerword == "suppress-warnings") {
                         Options |= EOptionSuppressWarnings;
+                    } else if (lowerword == "time-phases") {
+                        TimePhases = true;
+                    } else if (lowerword == "threads") {
+                        if (argc <= 1)
+                            Error("no <num> provided for --threads");
+                        NumThreads = atoi(argv[1]);
+                        if (NumThreads <= 0)
+                            Error("--threads expects a positive number of threads");
+                        Options |= EOptionMultiThreaded;
+                        bumpArg();
                     } else if (lowerword == "target-env") {
                         if (argc > 1) {
                             if (strcmp(argv[1], "vulkan1.0") == 0) {
@@ -689,6 +1041,31 @@ void ProcessArguments(std::vector<std::unique_ptr<glslang::TWorkItem>>& workItem
     if (binaryFileName && (Options & EOptionSpv) == 0)
         Error("no binary generation requested (e.g., -V)");
 
+    if (DedupDirectory && (Options & EOptionSpv) == 0)
+        Error("--dedup-dir requires a SPIR-V generation option (e.g., -V)");
+    if (DedupDirectory && (Options & EOptionOutputHexadecimal))
+        Error("--dedup-dir saves binary modules; it can't be used with -x");
+
+    // The old handle interface (no -l, -V, -G, or -E) doesn't report times
+    if (TimePhases && (Options & (EOptionLinkProgram | EOptionOutputPreprocessed)) == 0)
+        Error("--time-phases requires linking (e.g., -l or -V) or -E");
+
+    if (! ManifestEntries.empty() && (Options & EOptionSpv) == 0)
+        Error("--manifest requires a SPIR-V generation option (e.g., -V)");
+    if (ManifestOutputDirectory && ManifestEntries.empty())
+        Error("--manifest-output-dir requires --manifest");
+
+    if (SpvPerFile) {
+        if ((Options & EOptionSpv) == 0)
+            Error("--spv-per-file requires a SPIR-V generation option (e.g., -V)");
+        if (Options & (EOptionOutputPreprocessed | EOptionStdin))
+            Error("--spv-per-file can't be used with -E or --stdin");
+    }
+
+    // Per-file SPIR-V generation writes one module per input file
+    if (binaryFileName && SpvPerFile && workItems.size() > 1)
+        Error("-o needs a single input file with --spv-per-file; otherwise each module is written to <file>.spv");
+
     if ((Options & EOptionFlattenUniformArrays) != 0 &&
         (Options & EOptionReadHlsl) == 0)
         Error("uniform array flattening only valid when compiling HLSL source.");
@@ -728,7 +1105,27 @@ void SetMessageOptions(EShMessages& messages)
 }
 
 //
-// Thread entry point, for non-linking asynchronous mode.
+// Compile one work item through the old handle interface.
+// Returns false if no compiler could be made for it.
+//
+bool CompileWorkItem(glslang::TWorkItem& workItem)
+{
+    ShHandle compiler = ShConstructCompiler(FindLanguage(workItem.name), Options);
+    if (compiler == 0)
+        return false;
+
+    CompileFile(workItem.name.c_str(), compiler);
+
+    if (! (Options & EOptionSuppressInfolog))
+        workItem.results = ShGetInfoLog(compiler);
+
+    ShDestruct(compiler);
+
+    return true;
+}
+
+//
+// Single-threaded driver for non-linking mode.
 //
 void CompileShaders(glslang::TWorklist& worklist)
 {
@@ -736,31 +1133,25 @@ void CompileShaders(glslang::TWorklist& worklist)
         Error("cannot generate debug information unless linking to generate code");
 
     glslang::TWorkItem* workItem;
-    if (Options & EOptionStdin) {
-        worklist.remove(workItem);
-        ShHandle compiler = ShConstructCompiler(FindLanguage("stdin"), Options);
-        if (compiler == 0)
+    while (worklist.remove(workItem)) {
+        if (! CompileWorkItem(*workItem))
             return;
+    }
+}
 
-        CompileFile("stdin", compiler);
-
-            if (! (Options & EOptionSuppressInfolog))
-                workItem->results = ShGetInfoLog(compiler);
-
-        ShDestruct(compiler);
-    } else {
-        while (worklist.remove(workItem)) {
-            ShHandle compiler = ShConstructCompiler(FindLanguage(workItem->name), Options);
-            if (compiler == 0)
-                return;
-
-            CompileFile(workItem->name.c_str(), compiler);
-
-            if (! (Options & EOptionSuppressInfolog))
-                workItem->results = ShGetInfoLog(compiler);
+//
+// Thread entry point, for non-linking asynchronous mode.
+//
+void CompileShadersThread(glslang::TWorkQueue& queue, int index)
+{
+    if (Options & EOptionDebug)
+        Error("cannot generate debug information unless linking to generate code");
 
-            ShDestruct(compiler);
-        }
+    // Keep draining even if a compiler can't be made, so no one waits forever.
+    glslang::TWorkItem* workItem;
+    while (queue.remove(index, workItem)) {
+        CompileWorkItem(*workItem);
+        queue.finished(workItem);
     }
 }
 
@@ -788,6 +1179,7 @@ struct ShaderCompUnit {
     static const int maxCount = 1;
     int count;                          // live number of strings/names
     const char* text[maxCount];         // memory owned/managed externally
+    int length[maxCount];               // -1 for null-terminated text
     std::string fileName[maxCount];     // hold's the memory, but...
     const char* fileNameList[maxCount]; // downstream interface wants pointers
 
@@ -800,20 +1192,104 @@ struct ShaderCompUnit {
         for (int i = 0; i < count; ++i) {
             fileName[i] = rhs.fileName[i];
             text[i] = rhs.text[i];
+            length[i] = rhs.length[i];
             fileNameList[i] = rhs.fileName[i].c_str();
         }
     }
 
-    void addString(std::string& ifileName, const char* itext)
+    void addString(std::string& ifileName, const char* itext, int ilength = -1)
     {
         assert(count < maxCount);
         fileName[count] = ifileName;
         text[count] = itext;
+        length[count] = ilength;
         fileNameList[count] = fileName[count].c_str();
         ++count;
     }
 };
 
+//
+// Apply the command line's settings to a shader about to be parsed.
+//
+void SetupShader(glslang::TShader& shader, const ShaderCompUnit& compUnit)
+{
+    shader.setStringsWithLengthsAndNames(compUnit.text, compUnit.length, compUnit.fileNameList, compUnit.count);
+    if (entryPointName) // HLSL todo: this needs to be tracked per compUnits
+        shader.setEntryPoint(entryPointName);
+    if (sourceEntryPointName) {
+        if (entryPointName == nullptr)
+            printf("Warning: Changing source entry point name without setting an entry-point name.\n"
+                   "Use '-e <name>'.\n");
+        shader.setSourceEntryPoint(sourceEntryPointName);
+    }
+    if (UserPreamble.isSet())
+        shader.setPreamble(UserPreamble.get());
+    shader.addProcesses(Processes);
+
+    // Set IO mapper binding shift values
+    for (int r = 0; r < glslang::EResCount; ++r) {
+        const glslang::TResourceType res = glslang::TResourceType(r);
+
+        // Set base bindings
+        shader.setShiftBinding(res, baseBinding[res][compUnit.stage]);
+        
+        // Set bindings for particular resource sets
+        // TODO: use a range based for loop here, when available in all environments.
+        for (auto i = baseBindingForSet[res][compUnit.stage].begin();
+             i != baseBindingForSet[res][compUnit.stage].end(); ++i)
+            shader.setShiftBindingForSet(res, i->second, i->first);
+    }
+
+    shader.setFlattenUniformArrays((Options & EOptionFlattenUniformArrays) != 0);
+    shader.setNoStorageFormat((Options & EOptionNoStorageFormat) != 0);
+    shader.setResourceSetBinding(baseResourceSetBinding[compUnit.stage]);
+
+    if (Options & EOptionHlslIoMapping)
+        shader.setHlslIoMapping(true);
+
+    if (Options & EOptionAutoMapBindings)
+        shader.setAutoMapBindings(true);
+
+    if (Options & EOptionAutoMapLocations)
+        shader.setAutoMapLocations(true);
+
+    if (Options & EOptionInvertY)
+        shader.setInvertY(true);
+
+    // Set up the environment, some subsettings take precedence over earlier
+    // ways of setting things.
+    if (Options & EOptionSpv) {
+        if (Options & EOptionVulkanRules) {
+            shader.setEnvInput((Options & EOptionReadHlsl) ? glslang::EShSourceHlsl
+                                                           : glslang::EShSourceGlsl,
+                                   compUnit.stage, glslang::EShClientVulkan, ClientInputSemanticsVersion);
+            shader.setEnvClient(glslang::EShClientVulkan, VulkanClientVersion);
+        } else {
+            shader.setEnvInput((Options & EOptionReadHlsl) ? glslang::EShSourceHlsl
+                                                           : glslang::EShSourceGlsl,
+                                   compUnit.stage, glslang::EShClientOpenGL, ClientInputSemanticsVersion);
+            shader.setEnvClient(glslang::EShClientOpenGL, OpenGLClientVersion);
+        }
+        shader.setEnvTarget(glslang::EShTargetSpv, TargetVersion);
+        if (targetHlslFunctionality1)
+            shader.setEnvTargetHlslFunctionality1();
+    }
+}
+
+//
+// Apply the command line's settings for SPIR-V generation.
+//
+glslang::SpvOptions GetSpvOptions()
+{
+    glslang::SpvOptions spvOptions;
+    if (Options & EOptionDebug)
+        spvOptions.generateDebugInfo = true;
+    spvOptions.disableOptimizer = (Options & EOptionOptimizeDisable) != 0;
+    spvOptions.optimizeSize = (Options & EOptionOptimizeSize) != 0;
+
+    return spvOptions;
+}
+
 //
 // For linking mode: Will independently parse each compilation unit, but then put them
 // in the same program and link them together, making at most one linked module per
@@ -838,67 +1314,7 @@ void CompileAndLinkShaderUnits(std::vector<ShaderCompUnit> compUnits)
     for (auto it = compUnits.cbegin(); it != compUnits.cend(); ++it) {
         const auto &compUnit = *it;
         glslang::TShader* shader = new glslang::TShader(compUnit.stage);
-        shader->setStringsWithLengthsAndNames(compUnit.text, NULL, compUnit.fileNameList, compUnit.count);
-        if (entryPointName) // HLSL todo: this needs to be tracked per compUnits
-            shader->setEntryPoint(entryPointName);
-        if (sourceEntryPointName) {
-            if (entryPointName == nullptr)
-                printf("Warning: Changing source entry point name without setting an entry-point name.\n"
-                       "Use '-e <name>'.\n");
-            shader->setSourceEntryPoint(sourceEntryPointName);
-        }
-        if (UserPreamble.isSet())
-            shader->setPreamble(UserPreamble.get());
-        shader->addProcesses(Processes);
-
-        // Set IO mapper binding shift values
-        for (int r = 0; r < glslang::EResCount; ++r) {
-            const glslang::TResourceType res = glslang::TResourceType(r);
-
-            // Set base bindings
-            shader->setShiftBinding(res, baseBinding[res][compUnit.stage]);
-            
-            // Set bindings for particular resource sets
-            // TODO: use a range based for loop here, when available in all environments.
-            for (auto i = baseBindingForSet[res][compUnit.stage].begin();
-                 i != baseBindingForSet[res][compUnit.stage].end(); ++i)
-                shader->setShiftBindingForSet(res, i->second, i->first);
-        }
-
-        shader->setFlattenUniformArrays((Options & EOptionFlattenUniformArrays) != 0);
-        shader->setNoStorageFormat((Options & EOptionNoStorageFormat) != 0);
-        shader->setResourceSetBinding(baseResourceSetBinding[compUnit.stage]);
-
-        if (Options & EOptionHlslIoMapping)
-            shader->setHlslIoMapping(true);
-
-        if (Options & EOptionAutoMapBindings)
-            shader->setAutoMapBindings(true);
-
-        if (Options & EOptionAutoMapLocations)
-            shader->setAutoMapLocations(true);
-
-        if (Options & EOptionInvertY)
-            shader->setInvertY(true);
-
-        // Set up the environment, some subsettings take precedence over earlier
-        // ways of setting things.
-        if (Options & EOptionSpv) {
-            if (Options & EOptionVulkanRules) {
-                shader->setEnvInput((Options & EOptionReadHlsl) ? glslang::EShSourceHlsl
-                                                                : glslang::EShSourceGlsl,
-                                        compUnit.stage, glslang::EShClientVulkan, ClientInputSemanticsVersion);
-                shader->setEnvClient(glslang::EShClientVulkan, VulkanClientVersion);
-            } else {
-                shader->setEnvInput((Options & EOptionReadHlsl) ? glslang::EShSourceHlsl
-                                                                : glslang::EShSourceGlsl,
-                                        compUnit.stage, glslang::EShClientOpenGL, ClientInputSemanticsVersion);
-                shader->setEnvClient(glslang::EShClientOpenGL, OpenGLClientVersion);
-            }
-            shader->setEnvTarget(glslang::EShTargetSpv, TargetVersion);
-            if (targetHlslFunctionality1)
-                shader->setEnvTargetHlslFunctionality1();
-        }
+        SetupShader(*shader, compUnit);
 
         shaders.push_back(shader);
 
@@ -960,6 +1376,7 @@ void CompileAndLinkShaderUnits(std::vector<ShaderCompUnit> compUnits)
     }
 
     // Dump SPIR-V
+    glslang::TPhaseTimes phaseTimes;
     if (Options & EOptionSpv) {
         if (CompileFailed || LinkFailed)
             printf("SPIR-V is not generated for failed compile or link\n");
@@ -969,22 +1386,18 @@ void CompileAndLinkShaderUnits(std::vector<ShaderCompUnit> compUnits)
                     std::vector<unsigned int> spirv;
                     std::string warningsErrors;
                     spv::SpvBuildLogger logger;
-                    glslang::SpvOptions spvOptions;
-                    if (Options & EOptionDebug)
-                        spvOptions.generateDebugInfo = true;
-                    spvOptions.disableOptimizer = (Options & EOptionOptimizeDisable) != 0;
-                    spvOptions.optimizeSize = (Options & EOptionOptimizeSize) != 0;
+                    glslang::SpvOptions spvOptions = GetSpvOptions();
+                    spvOptions.phaseTimes = &phaseTimes;
                     glslang::GlslangToSpv(*program.getIntermediate((EShLanguage)stage), spirv, &logger, &spvOptions);
 
                     // Dump the spv to a file or stdout, etc., but only if not doing
                     // memory/perf testing, as it's not internal to programmatic use.
                     if (! (Options & EOptionMemoryLeakMode)) {
+                        glslang::TPhaseTimer outputTimer(&phaseTimes.output);
+                        std::string outputErrors;
                         printf("%s", logger.getAllMessages().c_str());
-                        if (Options & EOptionOutputHexadecimal) {
-                            glslang::OutputSpvHex(spirv, GetBinaryName((EShLanguage)stage), variableName);
-                        } else {
-                            glslang::OutputSpvBin(spirv, GetBinaryName((EShLanguage)stage));
-                        }
+                        OutputSpirv(spirv, GetBinaryName((EShLanguage)stage), outputErrors);
+                        printf("%s", outputErrors.c_str());
 #if ENABLE_OPT
                         if (SpvToolsDisassembler)
                             spv::SpirvToolsDisassemble(std::cout, spirv);
@@ -1000,6 +1413,13 @@ void CompileAndLinkShaderUnits(std::vector<ShaderCompUnit> compUnits)
         }
     }
 
+    if (TimePhases) {
+        phaseTimes.add(program.getPhaseTimes());
+        for (auto it = shaders.cbegin(); it != shaders.cend(); ++it)
+            phaseTimes.add((*it)->getPhaseTimes());
+        AddPhaseTimes(phaseTimes, (int)shaders.size());
+    }
+
     // Free everything up, program has to go before the shaders
     // because it might have merged stuff from the shaders, and
     // the stuff from the shaders has to have its destructors called
@@ -1027,6 +1447,7 @@ void CompileAndLinkShaderUnits(std::vector<ShaderCompUnit> compUnits)
 void CompileAndLinkShaderFiles(glslang::TWorklist& Worklist)
 {
     std::vector<ShaderCompUnit> compUnits;
+    std::vector<TFileData> fileData;
 
     // If this is using stdin, we can't really detect multiple different file
     // units by input type. We need to assume that we're just being given one
@@ -1035,10 +1456,11 @@ void CompileAndLinkShaderFiles(glslang::TWorklist& Worklist)
         ShaderCompUnit compUnit(FindLanguage("stdin"));
         std::istreambuf_iterator<char> begin(std::cin), end;
         std::string tempString(begin, end);
-        char* fileText = strdup(tempString.c_str());
+        TFileData stdinData = { strdup(tempString.c_str()), tempString.size(), false };
         std::string fileName = "stdin";
-        compUnit.addString(fileName, fileText);
+        compUnit.addString(fileName, stdinData.text, (int)stdinData.size);
         compUnits.push_back(compUnit);
+        fileData.push_back(stdinData);
     } else {
         // Transfer all the work items from to a simple list of
         // of compilation units.  (We don't care about the thread
@@ -1048,11 +1470,10 @@ void CompileAndLinkShaderFiles(glslang::TWorklist& Worklist)
         glslang::TWorkItem* workItem;
         while (Worklist.remove(workItem)) {
             ShaderCompUnit compUnit(FindLanguage(workItem->name));
-            char* fileText = ReadFileData(workItem->name.c_str());
-            if (fileText == nullptr)
-                usage();
-            compUnit.addString(workItem->name, fileText);
+            TFileData data = MapFileData(workItem->name.c_str());
+            compUnit.addString(workItem->name, data.text, (int)data.size);
             compUnits.push_back(compUnit);
+            fileData.push_back(data);
         }
     }
 
@@ -1067,10 +1488,211 @@ void CompileAndLinkShaderFiles(glslang::TWorklist& Worklist)
             glslang::OS_DumpMemoryCounters();
     }
 
-    // free memory from ReadFileData, which got stored in a const char*
-    // as the first string above
-    for (auto it = compUnits.begin(); it != compUnits.end(); ++it)
-        FreeFileData(const_cast<char*>(it->text[0]));
+    // release the file text the compilation units pointed to
+    for (auto it = fileData.begin(); it != fileData.end(); ++it)
+        FreeFileData(*it);
+}
+
+//
+// Appends the given string and a newline, but only if it is non-null and non-empty;
+// the buffered counterpart of PutsIfNonEmpty().
+//
+void AppendIfNonEmpty(std::string& out, const char* str)
+{
+    if (str && str[0]) {
+        out.append(str);
+        out.append("\n");
+    }
+}
+
+//
+// For --spv-per-file: compile, link, and generate SPIR-V for a single file as a
+// program of its own, so independent files can be processed in parallel.
+// The module is written to <file>.spv (or the -o name), and everything that would
+// otherwise be printed is left in the work item's results, to be output in order.
+// A --manifest entry for the item overrides the stage, entry point, and output
+// name, and adds to the preamble.
+//
+// Uses the new C++ interface, like CompileAndLinkShaderUnits().
+//
+void CompileAndLinkShaderFile(glslang::TWorkItem& workItem)
+{
+    EShMessages messages = EShMsgDefault;
+    SetMessageOptions(messages);
+
+    const auto found = ManifestEntries.find(&workItem);
+    const TManifestEntry* entry = found != ManifestEntries.end() ? found->second.get() : nullptr;
+
+    ShaderCompUnit compUnit(entry && ! entry->stage.empty() ? FindLanguage(entry->stage, false)
+                                                            : FindLanguage(workItem.name));
+    TFileData fileData = MapFileData(workItem.name.c_str());
+    compUnit.addString(workItem.name, fileData.text, (int)fileData.size);
+
+    std::string& results = workItem.results;
+    const bool printLogs = (Options & EOptionSuppressInfolog) == 0;
+
+    // The program has to go before the shader; see CompileAndLinkShaderUnits().
+    glslang::TShader shader(compUnit.stage);
+    SetupShader(shader, compUnit);
+    glslang::TProgram program;
+
+    std::string preamble;
+    if (entry) {
+        if (! entry->entryPoint.empty())
+            shader.setEntryPoint(entry->entryPoint.c_str());
+        if (entry->preamble.isSet()) {
+            preamble = std::string(UserPreamble.get()) + entry->preamble.get();
+            shader.setPreamble(preamble.c_str());
+        }
+        shader.addProcesses(entry->processes);
+    }
+
+    const int defaultVersion = Options & EOptionDefaultDesktop ? 110 : 100;
+
+    // Includes are read through the process-wide cache, as many files share them
+    CachingFileIncluder includer(IncludeCache);
+    std::for_each(IncludeDirectoryList.rbegin(), IncludeDirectoryList.rend(), [&includer](const std::string& dir) {
+        includer.pushExternalLocalDirectory(dir); });
+
+    bool failed = false;
+    if (! shader.parse(&Resources, defaultVersion, false, messages, includer)) {
+        CompileFailed = true;
+        failed = true;
+    }
+
+    // The source isn't needed after parsing, so don't hold it through the rest,
+    // unless it is going into the SPIR-V as debug information
+    const bool keepSource = (messages & EShMsgDebugInfo) != 0;
+    if (! keepSource)
+        FreeFileData(fileData);
+
+    program.addShader(&shader);
+
+    if (printLogs) {
+        AppendIfNonEmpty(results, workItem.name.c_str());
+        AppendIfNonEmpty(results, shader.getInfoLog());
+        AppendIfNonEmpty(results, shader.getInfoDebugLog());
+    }
+
+    if (! program.link(messages) || ! program.mapIO()) {
+        LinkFailed = true;
+        failed = true;
+    }
+
+    if (printLogs) {
+        AppendIfNonEmpty(results, program.getInfoLog());
+        AppendIfNonEmpty(results, program.getInfoDebugLog());
+    }
+
+    if (Options & EOptionDumpReflection) {
+        program.buildReflection();
+        program.dumpReflection(results);
+    }
+
+    glslang::TPhaseTimes phaseTimes;
+    if (failed)
+        results.append("SPIR-V is not generated for failed compile or link\n");
+    else if (program.getIntermediate(compUnit.stage)) {
+        std::vector<unsigned int> spirv;
+        spv::SpvBuildLogger logger;
+        glslang::SpvOptions spvOptions = GetSpvOptions();
+        spvOptions.phaseTimes = &phaseTimes;
+        glslang::GlslangToSpv(*program.getIntermediate(compUnit.stage), spirv, &logger, &spvOptions);
+
+        // Only the SPIR-V is wanted from here on, so don't hold the AST through output
+        program.releaseIntermediates();
+
+        glslang::TPhaseTimer outputTimer(&phaseTimes.output);
+        results.append(logger.getAllMessages());
+        std::string binaryName = workItem.name + ".spv";
+        if (entry && ! entry->output.empty())
+            binaryName = ManifestOutputPath(*entry);
+        else if (binaryFileName != nullptr)
+            binaryName = binaryFileName;
+        OutputSpirv(spirv, binaryName, results);
+
+#if ENABLE_OPT
+        if (SpvToolsDisassembler) {
+            std::ostringstream disassembly;
+            spv::SpirvToolsDisassemble(disassembly, spirv);
+            results.append(disassembly.str());
+        }
+#else
+        if (SpvToolsDisassembler)
+            results.append("SPIRV-Tools is not enabled; use -H for human readable SPIR-V\n");
+#endif
+        if (!SpvToolsDisassembler && (Options & EOptionHumanReadableSpv))
+            spv::Disassemble(results, spirv);
+    }
+
+    if (keepSource)
+        FreeFileData(fileData);
+
+    if (TimePhases) {
+        phaseTimes.add(shader.getPhaseTimes());
+        phaseTimes.add(program.getPhaseTimes());
+        AddPhaseTimes(phaseTimes, 1);
+    }
+}
+
+//
+// Thread entry point, for --spv-per-file.
+//
+void CompileShadersToSpirv(glslang::TWorkQueue& queue, int index)
+{
+    glslang::TWorkItem* workItem;
+    while (queue.remove(index, workItem)) {
+        CompileAndLinkShaderFile(*workItem);
+        queue.finished(workItem);
+    }
+}
+
+//
+// Run 'worker' on a pool of threads until all the work items are done,
+// handing each item to 'output' in command-line order as soon as it
+// and everything before it is complete.
+//
+// Returns false if the threads could not be created.
+//
+bool RunThreads(void (*worker)(glslang::TWorkQueue&, int),
+                const std::function<void(const glslang::TWorkItem&)>& output)
+{
+    std::vector<glslang::TWorkItem*> items;
+    for (size_t w = 0; w < WorkItems.size(); ++w) {
+        WorkItems[w]->size = GetFileSize(WorkItems[w]->name.c_str());
+        items.push_back(WorkItems[w].get());
+    }
+
+    int numThreads = NumThreads > 0 ? NumThreads : (int)std::thread::hardware_concurrency();
+    if (numThreads <= 0)
+        numThreads = 16;
+    numThreads = std::max(1, std::min(numThreads, (int)items.size()));
+
+    glslang::TWorkQueue queue(items, numThreads);
+
+    // If some threads can't be made, the ones that were still steal all the work.
+    std::vector<std::thread> threads;
+    bool created = true;
+    for (int t = 0; t < numThreads; ++t) {
+        threads.push_back(std::thread(worker, std::ref(queue), t));
+        if (threads.back().get_id() == std::thread::id()) {
+            fprintf(stderr, "Failed to create thread\n");
+            threads.pop_back();
+            created = false;
+            break;
+        }
+    }
+
+    if (created) {
+        for (size_t i = 0; i < items.size(); ++i) {
+            queue.waitFor(items[i]);
+            output(*items[i]);
+        }
+    }
+
+    std::for_each(threads.begin(), threads.end(), [](std::thread& t) { t.join(); });
+
+    return created;
 }
 
 int singleMain()
@@ -1121,11 +1743,24 @@ int singleMain()
     ProcessConfigFile();
 
     //
-    // Two modes:
+    // Three modes:
     // 1) linking all arguments together, single-threaded, new C++ interface
-    // 2) independent arguments, can be tackled by multiple asynchronous threads, for testing thread safety, using the old handle interface
+    // 2) independent arguments to SPIR-V, each its own program (--spv-per-file, --manifest), tackled by multiple threads, new C++ interface
+    // 3) independent arguments, can be tackled by multiple asynchronous threads, for testing thread safety, using the old handle interface
     //
-    if (Options & EOptionLinkProgram ||
+    if (SpvPerFile) {
+        glslang::InitializeProcess();
+
+        // Print out everything each file produced, in command-line order
+        const auto print = [](const glslang::TWorkItem& workItem) {
+            fputs(workItem.results.c_str(), stdout);
+            fflush(stdout);
+        };
+        if (! RunThreads(CompileShadersToSpirv, print))
+            return EFailThreadCreate;
+
+        glslang::FinalizeProcess();
+    } else if (Options & EOptionLinkProgram ||
         Options & EOptionOutputPreprocessed) {
         glslang::InitializeProcess();
         glslang::InitializeProcess();  // also test reference counting of users
@@ -1141,32 +1776,31 @@ int singleMain()
 
         bool printShaderNames = workList.size() > 1;
 
-        if (Options & EOptionMultiThreaded) {
-            std::array<std::thread, 16> threads;
-            for (unsigned int t = 0; t < threads.size(); ++t) {
-                threads[t] = std::thread(CompileShaders, std::ref(workList));
-                if (threads[t].get_id() == std::thread::id()) {
-                    fprintf(stderr, "Failed to create thread\n");
-                    return EFailThreadCreate;
-                }
-            }
+        // Print out the resulting infologs
+        const auto print = [printShaderNames](const glslang::TWorkItem& workItem) {
+            if (printShaderNames || workItem.results.size() > 0)
+                PutsIfNonEmpty(workItem.name.c_str());
+            PutsIfNonEmpty(workItem.results.c_str());
+        };
 
-            std::for_each(threads.begin(), threads.end(), [](std::thread& t) { t.join(); });
-        } else
+        if ((Options & EOptionMultiThreaded) && ! (Options & EOptionStdin)) {
+            if (! RunThreads(CompileShadersThread, print))
+                return EFailThreadCreate;
+        } else {
             CompileShaders(workList);
-
-        // Print out all the resulting infologs
-        for (size_t w = 0; w < WorkItems.size(); ++w) {
-            if (WorkItems[w]) {
-                if (printShaderNames || WorkItems[w]->results.size() > 0)
-                    PutsIfNonEmpty(WorkItems[w]->name.c_str());
-                PutsIfNonEmpty(WorkItems[w]->results.c_str());
-            }
+            for (size_t w = 0; w < WorkItems.size(); ++w)
+                print(*WorkItems[w]);
         }
 
         ShFinalize();
     }
 
+    if (DedupDirectory != nullptr && ! DedupIndex.empty())
+        OutputDedupIndex();
+
+    if (TimePhases)
+        OutputPhaseTimes();
+
     if (CompileFailed)
         return EFailCompile;
     if (LinkFailed)
@@ -1175,7 +1809,10 @@ int singleMain()
     return 0;
 }
 
-int C_DECL main(int argc, char* argv[])
+//
+// Run one glslangValidator command line, returning the exit code.
+//
+int RunCommandLine(int argc, char* argv[])
 {
     ProcessArguments(WorkItems, argc, argv);
 
@@ -1194,6 +1831,70 @@ int C_DECL main(int argc, char* argv[])
     return ret;
 }
 
+//
+// Build the built-in symbol tables for the common configurations, so that every
+// request a server handles starts with them already made.  The process is left
+// initialized, which keeps the tables alive for the server's lifetime.
+//
+void WarmUpServer()
+{
+    glslang::InitializeProcess();
+
+    const char* text = "#version 450\nvoid main() { }\n";
+    const EShMessages spvMessages = (EShMessages)(EShMsgSpvRules | EShMsgVulkanRules);
+    for (int stage = EShLangVertex; stage <= EShLangCompute; ++stage) {
+        for (int vulkan = 0; vulkan < 2; ++vulkan) {
+            glslang::TShader shader((EShLanguage)stage);
+            shader.setStrings(&text, 1);
+            if (vulkan) {
+                shader.setEnvInput(glslang::EShSourceGlsl, (EShLanguage)stage, glslang::EShClientVulkan, 100);
+                shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_0);
+                shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_0);
+            }
+            shader.parse(&glslang::DefaultTBuiltInResource, 100, false, vulkan ? spvMessages : EShMsgDefault);
+        }
+    }
+}
+
+int C_DECL main(int argc, char* argv[])
+{
+    // Server and client modes wrap an otherwise normal command line
+    if (argc > 1 && strcmp(argv[1], "--server") == 0) {
+        if (argc != 3) {
+            printf("--server expects just a <socket>\n");
+            return EFailUsage;
+        }
+        if (! glslang::CompilerServerSupported()) {
+            printf("--server is not supported on this platform\n");
+            return EFailUsage;
+        }
+        WarmUpServer();
+        return glslang::RunCompilerServer(argv[2], RunCommandLine);
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--use-server") == 0) {
+        if (argc < 3) {
+            printf("--use-server expects a <socket>\n");
+            return EFailUsage;
+        }
+        const char* socketPath = argv[2];
+        argv[2] = argv[0];
+        argc -= 2;
+        argv += 2;
+        // Only compile locally if the server never saw the command; once it
+        // has, it may have printed or written some of the output already.
+        if (glslang::CompilerServerSupported()) {
+            int ret = glslang::RunCompilerClient(socketPath, argc, argv);
+            if (ret == glslang::EClientLostServer)
+                return EFailServer;
+            if (ret != glslang::EClientNoServer)
+                return ret;
+        }
+    }
+
+    return RunCommandLine(argc, argv);
+}
+
 //
 //   Deduce the language from the filename.  Files must end in one of the
 //   following extensions:
@@ -1260,18 +1961,20 @@ EShLanguage FindLanguage(const std::string& name, bool parseStageName)
 void CompileFile(const char* fileName, ShHandle compiler)
 {
     int ret = 0;
-    char* shaderString;
+    TFileData fileData;
     if ((Options & EOptionStdin) != 0) {
         std::istreambuf_iterator<char> begin(std::cin), end;
         std::string tempString(begin, end);
-        shaderString = strdup(tempString.c_str());
+        fileData.text = strdup(tempString.c_str());
+        fileData.size = tempString.size();
+        fileData.mapped = false;
     } else {
-        shaderString = ReadFileData(fileName);
+        fileData = MapFileData(fileName);
     }
 
-    // move to length-based strings, rather than null-terminated strings
-    int* lengths = new int[1];
-    lengths[0] = (int)strlen(shaderString);
+    // length-based strings, as mapped text isn't null-terminated
+    const char* shaderString = fileData.text;
+    int length = (int)fileData.size;
 
     EShMessages messages = EShMsgDefault;
     SetMessageOptions(messages);
@@ -1282,7 +1985,7 @@ void CompileFile(const char* fileName, ShHandle compiler)
     for (int i = 0; i < ((Options & EOptionMemoryLeakMode) ? 100 : 1); ++i) {
         for (int j = 0; j < ((Options & EOptionMemoryLeakMode) ? 100 : 1); ++j) {
             // ret = ShCompile(compiler, shaderStrings, NumShaderStrings, lengths, EShOptNone, &Resources, Options, (Options & EOptionDefaultDesktop) ? 110 : 100, false, messages);
-            ret = ShCompile(compiler, &shaderString, 1, nullptr, EShOptNone, &Resources, Options, (Options & EOptionDefaultDesktop) ? 110 : 100, false, messages);
+            ret = ShCompile(compiler, &shaderString, 1, &length, EShOptNone, &Resources, Options, (Options & EOptionDefaultDesktop) ? 110 : 100, false, messages);
             // const char* multi[12] = { "# ve", "rsion", " 300 e", "s", "\n#err",
             //                         "or should be l", "ine 1", "string 5\n", "float glo", "bal",
             //                         ";\n#error should be line 2\n void main() {", "global = 2.3;}" };
@@ -1294,8 +1997,7 @@ void CompileFile(const char* fileName, ShHandle compiler)
             glslang::OS_DumpMemoryCounters();
     }
 
-    delete [] lengths;
-    FreeFileData(shaderString);
+    FreeFileData(fileData);
 
     if (ret == 0)
         CompileFailed = true;
@@ -1375,6 +2077,9 @@ void usage()
            "                                       'location' (fragile, not cross stage)\n"
            "  --aml                                synonym for --auto-map-locations\n"
            "  --client {vulkan<ver>|opengl<ver>}   see -V and -G\n"
+           "  --dedup-dir <dir>                    save each distinct SPIR-V module once, as\n"
+           "                                       <dir>/<hash>.spv, and map the output names\n"
+           "                                       to hashes in <dir>/index.txt; <dir> must exist\n"
            "  -dumpfullversion                     print bare major.minor.patchlevel\n"
            "  -dumpversion                         same as -dumpfullversion\n"
            "  --flatten-uniform-arrays             flatten uniform texture/sampler arrays to\n"
@@ -1387,6 +2092,12 @@ void usage()
            "  --invert-y | --iy                    invert position.Y output in vertex shader\n"
            "  --keep-uncalled                      don't eliminate uncalled functions\n"
            "  --ku                                 synonym for --keep-uncalled\n"
+           "  --manifest <file>                    compile each line of <file>, in parallel, as\n"
+           "                                       '<source> [-S <stage>] [-e <name>]\n"
+           "                                       [-D<macro>[=<value>]]... [-U<macro>]...\n"
+           "                                       [-o <file>]', on top of the command line's\n"
+           "                                       options; requires SPIR-V generation\n"
+           "  --manifest-output-dir <dir>          take relative --manifest -o files from <dir>\n"
            "  --no-storage-format                  use Unknown image format\n"
            "  --nsf                                synonym for --no-storage-format\n"
            "  --relaxed-errors                     relaxed GLSL semantic error-checking mode\n"
@@ -1395,6 +2106,8 @@ void usage()
            "  --resource-set-binding [stage] set\n"
            "              Set descriptor set for all resources\n"
            "  --rsb [stage] type set binding       synonym for --resource-set-binding\n"
+           "  --server <socket>                    run as a compiler server on Unix domain\n"
+           "                                       socket <socket>; must be the first option\n"
            "  --shift-image-binding [stage] num    base binding number for images (uav)\n"
            "  --shift-image-binding [stage] [num set]... per-descriptor-set shift values\n"
            "  --sib [stage] num                    synonym for --shift-image-binding\n"
@@ -1416,6 +2129,10 @@ void usage()
            "  --shift-cbuffer-binding [stage] [num set]... per-descriptor-set shift values\n"
            "  --spirv-dis                          output standard form disassembly; works only\n"
            "                                       when a SPIR-V generation option is also used\n"
+           "  --spv-per-file                       with SPIR-V generation, compile, link, and\n"
+           "                                       translate each file on its own, to\n"
+           "                                       <file>.spv, on one thread per hardware\n"
+           "                                       thread (see --threads)\n"
            "  --sub [stage] num                    synonym for --shift-UBO-binding\n"
            "  --source-entrypoint <name>           the given shader source function is\n"
            "                                       renamed to be the <name> given in -e\n"
@@ -1431,6 +2148,12 @@ void usage()
            "                                       semantics selected by --client) defaults:\n"
            "                                          'vulkan1.0' under '--client vulkan<ver>'\n"
            "                                          'opengl' under '--client opengl<ver>'\n"
+           "  --threads <num>                      -t, or --spv-per-file, using <num> threads\n"
+           "  --time-phases                        print the time spent in each phase of\n"
+           "                                       compilation, summed over all inputs\n"
+           "  --use-server <socket>                send the rest of the command line to the\n"
+           "                                       --server on <socket>, compiling locally if\n"
+           "                                       it can't be reached; must be the first option\n"
            "  --variable-name <name>               Creates a C header file that contains a\n"
            "                                       uint32_t array named <name>\n"
            "                                       initialized with the shader binary code.\n"
@@ -1480,22 +2203,38 @@ char* ReadFileData(const char* fileName)
     if (errorCode || in == nullptr)
         Error("unable to open input file");
 
-    int count = 0;
-    while (fgetc(in) != EOF)
-        count++;
+    // Read in chunks rather than measuring first, as a pipe can't be rewound
+    std::string contents;
+    char buffer[4096];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), in)) > 0)
+        contents.append(buffer, count);
+    if (ferror(in))
+        Error("can't read input file");
+    fclose(in);
 
-    fseek(in, 0, SEEK_SET);
+    char* return_data = (char*)malloc(contents.size() + 1);  // freed in FreeFileData()
+    memcpy(return_data, contents.c_str(), contents.size() + 1);
 
-    char* return_data = (char*)malloc(count + 1);  // freed in FreeFileData()
-    if ((int)fread(return_data, 1, count, in) != count) {
-        free(return_data);
-        Error("can't read input file");
-    }
+    return return_data;
+}
 
-    return_data[count] = '\0';
+//
+// Size of a file in bytes, or 0 if it can't be opened (that is reported
+// when it is read).
+//
+size_t GetFileSize(const char* fileName)
+{
+    FILE* in = nullptr;
+    if (fopen_s(&in, fileName, "rb") != 0 || in == nullptr)
+        return 0;
+
+    long size = 0;
+    if (fseek(in, 0, SEEK_END) == 0)
+        size = ftell(in);
     fclose(in);
 
-    return return_data;
+    return size > 0 ? (size_t)size : 0;
 }
 
 void FreeFileData(char* data)
@@ -1503,6 +2242,31 @@ void FreeFileData(char* data)
     free(data);
 }
 
+//
+// Map a shader file into memory, falling back to reading it into a buffer
+// for what can't be mapped, like pipes or empty files.
+//
+TFileData MapFileData(const char* fileName)
+{
+    TFileData data;
+    data.text = glslang::OS_MapFile(fileName, data.size);
+    data.mapped = data.text != nullptr;
+    if (! data.mapped) {
+        data.text = ReadFileData(fileName);
+        data.size = strlen(data.text);
+    }
+
+    return data;
+}
+
+void FreeFileData(const TFileData& data)
+{
+    if (data.mapped)
+        glslang::OS_UnmapFile(data.text, data.size);
+    else
+        free(const_cast<char*>(data.text));
+}
+
 void InfoLogMsg(const char* msg, const char* name, const int num)
 {
     if (num >= 0 )
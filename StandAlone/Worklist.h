@@ -36,20 +36,26 @@
 #define WORKLIST_H_INCLUDED
 
 #include "../glslang/OSDependent/osinclude.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <list>
 #include <mutex>
 #include <string>
+#include <vector>
 
 namespace glslang {
 
     class TWorkItem {
     public:
-        TWorkItem() { }
+        TWorkItem() : size(0), done(false) { }
         explicit TWorkItem(const std::string& s) :
-            name(s) { }
+            name(s), size(0), done(false) { }
         std::string name;
         std::string results;
         std::string resultsIndex;
+        size_t size;    // input size, used to start the biggest work first
+        bool done;      // set by TWorkQueue::finished(), under the queue's lock
     };
 
     class TWorklist {
@@ -90,6 +96,92 @@ namespace glslang {
         std::list<TWorkItem*> worklist;
     };
 
+    //
+    // Work-stealing queues, for handing work items to a pool of threads.
+    //
+    // Items are sorted by size, biggest first, and dealt round-robin onto one
+    // deque per thread, so the longest compiles start first and each thread
+    // mostly touches only its own deque.  A thread takes from the front of its
+    // own deque, and once that runs dry, steals from the back of the others'.
+    //
+    // Completion is tracked per item, so that a consumer can wait for results
+    // in input order while the threads are still working on later items.
+    //
+    class TWorkQueue {
+    public:
+        TWorkQueue(const std::vector<TWorkItem*>& items, int numQueues) :
+            queues(std::max(numQueues, 1))
+        {
+            std::vector<TWorkItem*> sorted(items);
+            std::stable_sort(sorted.begin(), sorted.end(), [](const TWorkItem* a, const TWorkItem* b) {
+                return a->size > b->size; });
+
+            for (size_t i = 0; i < sorted.size(); ++i) {
+                sorted[i]->done = false;
+                queues[i % queues.size()].items.push_back(sorted[i]);
+            }
+        }
+
+        int numQueues() const { return (int)queues.size(); }
+
+        // Get the next item for the thread owning 'queue', stealing if needed.
+        // Returns false when there is no work left anywhere.
+        bool remove(int queue, TWorkItem*& item)
+        {
+            {
+                TQueue& own = queues[queue];
+                std::lock_guard<std::mutex> guard(own.mutex);
+                if (! own.items.empty()) {
+                    item = own.items.front();
+                    own.items.pop_front();
+                    return true;
+                }
+            }
+
+            for (size_t i = 1; i < queues.size(); ++i) {
+                TQueue& victim = queues[(queue + i) % queues.size()];
+                std::lock_guard<std::mutex> guard(victim.mutex);
+                if (! victim.items.empty()) {
+                    item = victim.items.back();
+                    victim.items.pop_back();
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        // Mark an item's results as complete.
+        void finished(TWorkItem* item)
+        {
+            {
+                std::lock_guard<std::mutex> guard(doneMutex);
+                item->done = true;
+            }
+            doneCondition.notify_all();
+        }
+
+        // Block until the given item's results are complete.
+        void waitFor(const TWorkItem* item)
+        {
+            std::unique_lock<std::mutex> lock(doneMutex);
+            doneCondition.wait(lock, [item]() { return item->done; });
+        }
+
+    protected:
+        struct TQueue {
+            std::mutex mutex;
+            std::deque<TWorkItem*> items;
+        };
+
+        TWorkQueue(const TWorkQueue&);
+        TWorkQueue& operator=(const TWorkQueue&);
+
+        std::vector<TQueue> queues;
+        std::mutex doneMutex;
+        std::condition_variable doneCondition;
+    };
+
 } // end namespace glslang
 
 #endif // WORKLIST_H_INCLUDED
@@ -34,11 +34,13 @@
 //
 
 #include <iostream>
+#include <iomanip>
 #include <fstream>
 #include <cstring>
 #include <stdexcept>
 
 #include "../SPIRV/SPVRemapper.h"
+#include "../SPIRV/SPVCompress.h"
 
 namespace {
 
@@ -74,7 +76,8 @@ namespace {
         std::cout << str << std::endl;
     }
 
-    // Read word stream from disk
+    // Read word stream from disk.  Compressed input (see SPVCompress.h) is detected by its
+    // magic number and decoded transparently.
     void read(std::vector<SpvWord>& spv, const std::string& inFilename, int verbosity)
     {
         std::ifstream fp;
@@ -88,24 +91,32 @@ namespace {
         if (fp.fail())
             errHandler("error opening file for read: ");
 
-        // Reserve space (for efficiency, not for correctness)
         fp.seekg(0, fp.end);
-        spv.reserve(size_t(fp.tellg()) / sizeof(SpvWord));
+        const size_t byteCount = size_t(fp.tellg());
         fp.seekg(0, fp.beg);
 
-        while (!fp.eof()) {
-            SpvWord inWord;
-            fp.read((char *)&inWord, sizeof(inWord));
+        // Read straight into the word buffer, which remap() then works on in place.
+        // Trailing partial words are ignored.
+        spv.resize(byteCount / sizeof(SpvWord));
+        fp.read((char *)spv.data(), spv.size() * sizeof(SpvWord));
+        if (fp.fail())
+            errHandler(std::string("error reading file: ") + inFilename);
 
-            if (!fp.eof()) {
-                spv.push_back(inWord);
-                if (fp.fail())
-                    errHandler(std::string("error reading file: ") + inFilename);
-            }
+        const std::uint8_t* bytes = (const std::uint8_t*)spv.data();
+        const size_t        wordBytes = spv.size() * sizeof(SpvWord);
+
+        if (spv::spirvcompress_t::isCompressed(bytes, wordBytes)) {
+            // Compressed streams aren't word aligned: pick up the tail bytes too
+            std::vector<std::uint8_t> compressed(bytes, bytes + wordBytes);
+            compressed.resize(byteCount);
+            fp.read((char *)compressed.data() + wordBytes, byteCount - wordBytes);
+
+            if (fp.fail() || !spv::spirvcompress_t::decompress(compressed.data(), compressed.size(), spv))
+                errHandler(std::string("error decompressing file: ") + inFilename);
         }
     }
 
-    void write(std::vector<SpvWord>& spv, const std::string& outFile, int verbosity)
+    void write(std::vector<SpvWord>& spv, const std::string& outFile, bool compress, int verbosity)
     {
         if (outFile.empty())
             errHandler("missing output filename.");
@@ -120,9 +131,16 @@ namespace {
         if (fp.fail())
             errHandler(std::string("error opening file for write: ") + outFile);
 
-        for (auto it = spv.cbegin(); it != spv.cend(); ++it) {
-            SpvWord word = *it;
-            fp.write((char *)&word, sizeof(word));
+        if (compress) {
+            std::vector<std::uint8_t> bytes;
+            if (!spv::spirvcompress_t::compress(spv, bytes))
+                errHandler(std::string("error compressing file: ") + outFile);
+
+            fp.write((const char *)bytes.data(), bytes.size());
+            if (fp.fail())
+                errHandler(std::string("error writing file: ") + outFile);
+        } else {
+            fp.write((const char *)spv.data(), spv.size() * sizeof(SpvWord));
             if (fp.fail())
                 errHandler(std::string("error writing file: ") + outFile);
         }
@@ -145,38 +163,99 @@ namespace {
             << " [--opt (all|loadstore)]"
             << " [--strip-all | --strip all | -s]"
             << " [--do-everything]"
+            << " [--compress | -z]"
+            << " [--stats]"
             << " --input | -i file1 [file2...] --output|-o DESTDIR"
             << std::endl;
 
+        std::cout << "  --compress writes the compact encoding from SPVCompress.h;"
+                  << " compressed inputs are detected and decoded automatically." << std::endl;
+
         std::cout << "  " << basename(name) << " [--version | -V]" << std::endl;
         std::cout << "  " << basename(name) << " [--help | -?]" << std::endl;
 
         exit(5);
     }
 
+    typedef spv::spirvbin_t::passstats_t PassStats;
+
+    // Print per-pass statistics, aggregated over all files
+    void printStats(const PassStats (&stats)[spv::spirvbin_t::PASS_COUNT])
+    {
+        std::cout << std::left  << std::setw(16) << "pass"
+                  << std::right << std::setw(6)  << "runs"
+                                << std::setw(11) << "ms"
+                                << std::setw(12) << "words in"
+                                << std::setw(12) << "words out"
+                                << std::setw(10) << "marked"
+                                << std::setw(10) << "ids"
+                                << std::setw(11) << "collisions" << std::endl;
+
+        PassStats total;
+        for (int p = 0; p < spv::spirvbin_t::PASS_COUNT; ++p) {
+            const PassStats& s = stats[p];
+            if (s.runs == 0)
+                continue;
+
+            std::cout << std::left  << std::setw(16) << spv::spirvbin_t::getPassName(spv::spirvbin_t::Pass(p))
+                      << std::right << std::setw(6)  << s.runs
+                                    << std::setw(11) << std::fixed << std::setprecision(3) << s.seconds * 1000.0
+                                    << std::setw(12) << s.wordsBefore
+                                    << std::setw(12) << s.wordsAfter
+                                    << std::setw(10) << s.wordsMarked
+                                    << std::setw(10) << s.idsMapped
+                                    << std::setw(11) << s.collisions << std::endl;
+
+            total.seconds    += s.seconds;
+            total.idsMapped  += s.idsMapped;
+            total.collisions += s.collisions;
+        }
+
+        std::cout << std::left  << std::setw(16) << "total"
+                  << std::right << std::setw(6)  << ""
+                                << std::setw(11) << std::fixed << std::setprecision(3) << total.seconds * 1000.0
+                                << std::setw(12) << stats[spv::spirvbin_t::PASS_INDEX].wordsBefore
+                                << std::setw(12) << stats[spv::spirvbin_t::PASS_STRIP_DEAD_REFS].wordsAfter
+                                << std::setw(10) << ""
+                                << std::setw(10) << total.idsMapped
+                                << std::setw(11) << total.collisions << std::endl;
+    }
+
     // grind through each SPIR in turn
     void execute(const std::vector<std::string>& inputFile, const std::string& outputDir,
-        int opts, int verbosity)
+        int opts, bool compress, bool stats, int verbosity)
     {
+        PassStats totals[spv::spirvbin_t::PASS_COUNT];
+
         for (auto it = inputFile.cbegin(); it != inputFile.cend(); ++it) {
             const std::string &filename = *it;
             std::vector<SpvWord> spv;
             read(spv, filename, verbosity);
-            spv::spirvbin_t(verbosity).remap(spv, opts);
+
+            spv::spirvbin_t remapper(verbosity);
+            remapper.remap(spv, opts);
+
+            for (int p = 0; p < spv::spirvbin_t::PASS_COUNT; ++p)
+                totals[p] += remapper.getPassStats(spv::spirvbin_t::Pass(p));
 
             const std::string outfile = outputDir + path_sep_char() + basename(filename);
 
-            write(spv, outfile, verbosity);
+            write(spv, outfile, compress, verbosity);
         }
 
         if (verbosity > 0)
             std::cout << "Done: " << inputFile.size() << " file(s) processed" << std::endl;
+
+        if (stats)
+            printStats(totals);
     }
 
     // Parse command line options
     void parseCmdLine(int argc, char** argv, std::vector<std::string>& inputFile,
         std::string& outputDir,
         int& options,
+        bool& compress,
+        bool& stats,
         int& verbosity)
     {
         if (argc < 2)
@@ -184,6 +263,8 @@ namespace {
 
         verbosity  = 0;
         options    = spv::spirvbin_t::NONE;
+        compress   = false;
+        stats      = false;
 
         // Parse command line.
         // boost::program_options would be quite a bit nicer, but we don't want to
@@ -236,6 +317,12 @@ namespace {
             } else if (arg == "--do-everything") {
                 ++a;
                 options = options | spv::spirvbin_t::DO_EVERYTHING;
+            } else if (arg == "--compress" || arg == "-z") {
+                ++a;
+                compress = true;
+            } else if (arg == "--stats") {
+                ++a;
+                stats = true;
             } else if (arg == "--strip-all" || arg == "-s") {
                 ++a;
                 options = options | spv::spirvbin_t::STRIP;
@@ -316,6 +403,8 @@ int main(int argc, char** argv)
     std::vector<std::string> inputFile;
     std::string              outputDir;
     int                      opts;
+    bool                     compress;
+    bool                     stats;
     int                      verbosity;
 
 #ifdef use_cpp11
@@ -329,7 +418,7 @@ int main(int argc, char** argv)
     if (argc < 2)
         usage(argv[0]);
 
-    parseCmdLine(argc, argv, inputFile, outputDir, opts, verbosity);
+    parseCmdLine(argc, argv, inputFile, outputDir, opts, compress, stats, verbosity);
 
     if (outputDir.empty())
         usage(argv[0], "Output directory required");
@@ -337,7 +426,7 @@ int main(int argc, char** argv)
     std::string errmsg;
 
     // Main operations: read, remap, and write.
-    execute(inputFile, outputDir, opts, verbosity);
+    execute(inputFile, outputDir, opts, compress, stats, verbosity);
 
     // If we get here, everything went OK!  Nothing more to be done.
 }
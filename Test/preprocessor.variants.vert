@@ -0,0 +1,13 @@
+#version 450
+
+#if defined(USE_COLOR)
+layout(location = 0) out vec4 color;
+#endif
+
+void main()
+{
+#if defined(USE_COLOR)
+    color = vec4(SCALE);
+#endif
+    gl_Position = vec4(OFFSET);
+}
@@ -0,0 +1,14 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(binding = 0) buffer Sized { float a; } sized[2];
+layout(binding = 1) buffer Runtime { float b; } runtime[];
+layout(binding = 2) uniform Fixed { vec4 c; } constant;
+
+layout(location = 0) flat in int index;
+layout(location = 0) out vec4 color;
+
+void main()
+{
+    color = vec4(sized[index].a + runtime[nonuniformEXT(index)].b) + constant.c;
+}
@@ -0,0 +1,19 @@
+#version 450
+
+#extension GL_GOOGLE_include_directive : enable
+
+#define float4 vec4
+
+#include "bar.h"
+#include "./inc1/bar.h"
+
+layout(location = 0) out vec4 color;
+
+void main()
+{
+#ifdef SCALE
+    color = (i1 + i2) * SCALE;
+#else
+    color = i1 + i2;
+#endif
+}
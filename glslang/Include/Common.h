@@ -119,6 +119,16 @@ std::string to_string(const T& val) {
     void operator delete[](void*) { }                                 \
     void operator delete[](void *, void *) { }
 
+//
+// Adds 'n' to 'counter' of the TCompileStats* 'stats', if not null, when built
+// with GLSLANG_COMPILE_STATS; otherwise, compiles to nothing.
+//
+#ifdef GLSLANG_COMPILE_STATS
+#define GLSLANG_COUNT(stats, counter, n) do { if ((stats) != nullptr) (stats)->counter += (n); } while (false)
+#else
+#define GLSLANG_COUNT(stats, counter, n) do { } while (false)
+#endif
+
 namespace glslang {
 
     //
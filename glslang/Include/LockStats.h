@@ -0,0 +1,103 @@
+//
+// Copyright (C) 2018 LunarG, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+//    Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//    Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//    Neither the name of 3Dlabs Inc. Ltd. nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef _LOCK_STATS_INCLUDED_
+#define _LOCK_STATS_INCLUDED_
+
+#include <mutex>
+#include <type_traits>
+
+#ifdef GLSLANG_LOCK_STATS
+    #include <chrono>
+#endif
+
+namespace glslang {
+
+//
+// The internal locks counted for GetLockStats().
+//
+enum TLockKind {
+    ELockBuiltIns,         // TBuiltInTables, setting up built-in symbol tables
+    ELockCompilerContext,  // TCompilerContext, its includes and attached shaders
+    ELockPageCache,        // TPoolPageCache
+    ELockVirtualFiles,     // TVirtualFileIncluder
+    ELockProcess,          // the OS global lock, taken by InitProcess()
+    ELockCount
+};
+
+#ifdef GLSLANG_LOCK_STATS
+
+void CountLock(TLockKind, bool contended, std::chrono::steady_clock::duration wait);
+
+//
+// A std::lock_guard that first tries the lock, to count whether, and for
+// how long, it had to wait.  TMutex is a std::mutex, or anything else with
+// lock(), try_lock() and unlock().
+//
+template<class TMutex>
+class TCountedLockGuard {
+public:
+    TCountedLockGuard(TMutex& mutex, TLockKind kind) : mutex(mutex)
+    {
+        if (mutex.try_lock()) {
+            CountLock(kind, false, std::chrono::steady_clock::duration::zero());
+            return;
+        }
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        mutex.lock();
+        CountLock(kind, true, std::chrono::steady_clock::now() - start);
+    }
+    ~TCountedLockGuard() { mutex.unlock(); }
+
+private:
+    TCountedLockGuard(const TCountedLockGuard&);
+    TCountedLockGuard& operator=(const TCountedLockGuard&);
+
+    TMutex& mutex;
+};
+
+#define GLSLANG_LOCK_GUARD(guard, mutex, kind) \
+    glslang::TCountedLockGuard<typename std::decay<decltype(mutex)>::type> guard(mutex, kind)
+
+#else
+
+#define GLSLANG_LOCK_GUARD(guard, mutex, kind) \
+    std::lock_guard<typename std::decay<decltype(mutex)>::type> guard(mutex)
+
+#endif
+
+} // end namespace glslang
+
+#endif // _LOCK_STATS_INCLUDED_
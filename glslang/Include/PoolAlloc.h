@@ -63,6 +63,7 @@
 
 #include <cstddef>
 #include <cstring>
+#include <mutex>
 #include <vector>
 
 namespace glslang {
@@ -130,6 +131,38 @@ private:
 #   endif
 };
 
+//
+// Single pages left by destroyed pool allocators, for other pools to reuse
+// instead of going back to the OS; see TPoolAllocator::setPageCache().  Holds
+// at most 'maxBytes' of pages, and is safe to share between threads.
+//
+class TPoolPageCache {
+public:
+    TPoolPageCache(size_t pageSize, size_t maxBytes) : pageSize(pageSize), maxBytes(maxBytes), hits(0), misses(0) { }
+    ~TPoolPageCache() { setMaxBytes(0); }
+
+    // A page of getPageSize() bytes, or nullptr if there are none.
+    void* take();
+    // Returns false, leaving the page with the caller, if the cache is full.
+    bool give(void* page);
+
+    size_t getPageSize() const { return pageSize; }
+    void setMaxBytes(size_t);
+    size_t getBytes();
+    void getStats(unsigned int& hits, unsigned int& misses);
+
+private:
+    TPoolPageCache(const TPoolPageCache&);
+    TPoolPageCache& operator=(const TPoolPageCache&);
+
+    std::mutex mutex;
+    std::vector<char*> pages;
+    size_t pageSize;
+    size_t maxBytes;
+    unsigned int hits;
+    unsigned int misses;
+};
+
 //
 // There are several stacks.  One is to track the pushing and popping
 // of the user, and not yet implemented.  The others are simply a
@@ -146,7 +179,9 @@ private:
 //
 class TPoolAllocator {
 public:
-    TPoolAllocator(int growthIncrement = 8*1024, int allocationAlignment = 16);
+    enum { DefaultPageSize = 8*1024 };
+
+    TPoolAllocator(int growthIncrement = DefaultPageSize, int allocationAlignment = 16);
 
     //
     // Don't call the destructor just to free up the memory, call pop()
@@ -176,6 +211,15 @@ public:
     //
     void* allocate(size_t numBytes);
 
+    //
+    // Get single pages from, and give them back to, 'cache', when it has
+    // this pool's page size.  The cache has to outlive the pool.
+    //
+    void setPageCache(TPoolPageCache* cache) { pageCache = cache; }
+
+    // Memory held for allocations in use, in whole pages.
+    size_t getAllocatedBytes() const;
+
     //
     // There is no deallocate.  The point of this class is that
     // deallocation can be skipped by the user of it, as the model
@@ -237,6 +281,7 @@ protected:
     tHeader* freeList;      // list of popped memory
     tHeader* inUseList;     // list of all memory currently being used
     tAllocStack stack;      // stack of where to allocate from, to partition pool
+    TPoolPageCache* pageCache;  // where to get and return single pages, if anywhere
 
     int numCalls;           // just an interesting statistic
     size_t totalBytes;      // just an interesting statistic
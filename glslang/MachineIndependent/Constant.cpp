@@ -1027,6 +1027,7 @@ TIntermTyped* TIntermediate::fold(TIntermAggregate* aggrNode)
     TIntermConstantUnion *newNode = new TIntermConstantUnion(newConstArray, aggrNode->getType());
     newNode->getWritableType().getQualifier().storage = EvqConst;
     newNode->setLoc(aggrNode->getLoc());
+    GLSLANG_COUNT(compileStats, constantFolds, 1);
 
     return newNode;
 }
@@ -1062,6 +1063,7 @@ TIntermTyped* TIntermediate::foldConstructor(TIntermAggregate* aggrNode)
     if (error)
         return aggrNode;
 
+    GLSLANG_COUNT(compileStats, constantFolds, 1);
     return addConstantUnion(unionArray, aggrNode->getType(), aggrNode->getLoc());
 }
 
@@ -1094,8 +1096,10 @@ TIntermTyped* TIntermediate::foldDereference(TIntermTyped* node, int index, cons
 
     if (result == 0)
         result = node;
-    else
+    else {
         result->setType(dereferencedType);
+        GLSLANG_COUNT(compileStats, constantFolds, 1);
+    }
 
     return result;
 }
@@ -1116,8 +1120,10 @@ TIntermTyped* TIntermediate::foldSwizzle(TIntermTyped* node, TSwizzleSelectors<T
 
     if (result == 0)
         result = node;
-    else
+    else {
         result->setType(TType(node->getBasicType(), EvqConst, selectors.size()));
+        GLSLANG_COUNT(compileStats, constantFolds, 1);
+    }
 
     return result;
 }
@@ -150,8 +150,10 @@ TIntermTyped* TIntermediate::addBinaryMath(TOperator op, TIntermTyped* left, TIn
     TIntermConstantUnion *rightTempConstant = node->getRight()->getAsConstantUnion();
     if (leftTempConstant && rightTempConstant) {
         TIntermTyped* folded = leftTempConstant->fold(node->getOp(), rightTempConstant);
-        if (folded)
+        if (folded) {
+            GLSLANG_COUNT(compileStats, constantFolds, 1);
             return folded;
+        }
     }
 
     // If can propagate spec-constantness and if the operation is an allowed
@@ -364,8 +366,10 @@ TIntermTyped* TIntermediate::addUnaryMath(TOperator op, TIntermTyped* child, TSo
     node->updatePrecision();
 
     // If it's a (non-specialization) constant, it must be folded.
-    if (node->getOperand()->getAsConstantUnion())
+    if (node->getOperand()->getAsConstantUnion()) {
+        GLSLANG_COUNT(compileStats, constantFolds, 1);
         return node->getOperand()->getAsConstantUnion()->fold(op, node->getType());
+    }
 
     // If it's a specialization constant, the result is too,
     // if the operation is allowed for specialization constants.
@@ -394,8 +398,10 @@ TIntermTyped* TIntermediate::addBuiltInFunctionCall(const TSourceLoc& loc, TOper
 
         if (child->getAsConstantUnion()) {
             TIntermTyped* folded = child->getAsConstantUnion()->fold(op, returnType);
-            if (folded)
+            if (folded) {
+                GLSLANG_COUNT(compileStats, constantFolds, 1);
                 return folded;
+            }
         }
 
         return addUnaryNode(op, child, child->getLoc(), returnType);
@@ -5271,6 +5271,9 @@ const TFunction* TParseContext::findFunction(const TSourceLoc& loc, const TFunct
     else
         function = findFunction400(loc, call, builtIn);
 
+    if (function != nullptr)
+        GLSLANG_COUNT(intermediate.getCompileStats(), overloadResolutions, 1);
+
     return function;
 }
 
@@ -36,10 +36,34 @@
 #include "../Include/PoolAlloc.h"
 
 #include "../Include/InitializeGlobals.h"
+#include "../Include/LockStats.h"
 #include "../OSDependent/osinclude.h"
 
 namespace glslang {
 
+#ifdef GLSLANG_THREAD_LOCAL
+
+// The thread-specific current pool, starting out null in each thread.
+thread_local TPoolAllocator* ThreadPoolAllocator = nullptr;
+
+TPoolAllocator& GetThreadPoolAllocator()
+{
+    return *ThreadPoolAllocator;
+}
+
+void SetThreadPoolAllocator(TPoolAllocator* poolAllocator)
+{
+    ThreadPoolAllocator = poolAllocator;
+}
+
+// Nothing to set up for the process.
+bool InitializePoolIndex()
+{
+    return true;
+}
+
+#else
+
 // Process-wide TLS index
 OS_TLSIndex PoolIndex;
 
@@ -65,6 +89,8 @@ bool InitializePoolIndex()
     return true;
 }
 
+#endif
+
 //
 // Implement the functionality of the TPoolAllocator class, which
 // is documented in PoolAlloc.h.
@@ -74,6 +100,7 @@ TPoolAllocator::TPoolAllocator(int growthIncrement, int allocationAlignment) :
     alignment(allocationAlignment),
     freeList(nullptr),
     inUseList(nullptr),
+    pageCache(nullptr),
     numCalls(0)
 {
     //
@@ -116,10 +143,15 @@ TPoolAllocator::TPoolAllocator(int growthIncrement, int allocationAlignment) :
 
 TPoolAllocator::~TPoolAllocator()
 {
+    if (pageCache != nullptr && pageCache->getPageSize() != pageSize)
+        pageCache = nullptr;
+
     while (inUseList) {
         tHeader* next = inUseList->nextPage;
+        size_t pageCount = inUseList->pageCount;
         inUseList->~tHeader();
-        delete [] reinterpret_cast<char*>(inUseList);
+        if (pageCount > 1 || pageCache == nullptr || ! pageCache->give(inUseList))
+            delete [] reinterpret_cast<char*>(inUseList);
         inUseList = next;
     }
 
@@ -132,11 +164,68 @@ TPoolAllocator::~TPoolAllocator()
     //
     while (freeList) {
         tHeader* next = freeList->nextPage;
-        delete [] reinterpret_cast<char*>(freeList);
+        if (pageCache == nullptr || ! pageCache->give(freeList))
+            delete [] reinterpret_cast<char*>(freeList);
         freeList = next;
     }
 }
 
+size_t TPoolAllocator::getAllocatedBytes() const
+{
+    size_t bytes = 0;
+    for (const tHeader* page = inUseList; page != nullptr; page = page->nextPage)
+        bytes += page->pageCount * pageSize;
+
+    return bytes;
+}
+
+void* TPoolPageCache::take()
+{
+    GLSLANG_LOCK_GUARD(guard, mutex, ELockPageCache);
+    if (pages.empty()) {
+        ++misses;
+        return nullptr;
+    }
+    ++hits;
+    char* page = pages.back();
+    pages.pop_back();
+
+    return page;
+}
+
+bool TPoolPageCache::give(void* page)
+{
+    GLSLANG_LOCK_GUARD(guard, mutex, ELockPageCache);
+    if ((pages.size() + 1) * pageSize > maxBytes)
+        return false;
+    pages.push_back(static_cast<char*>(page));
+
+    return true;
+}
+
+void TPoolPageCache::setMaxBytes(size_t bytes)
+{
+    GLSLANG_LOCK_GUARD(guard, mutex, ELockPageCache);
+    maxBytes = bytes;
+    while (pages.size() * pageSize > maxBytes) {
+        delete [] pages.back();
+        pages.pop_back();
+    }
+}
+
+size_t TPoolPageCache::getBytes()
+{
+    GLSLANG_LOCK_GUARD(guard, mutex, ELockPageCache);
+    return pages.size() * pageSize;
+}
+
+void TPoolPageCache::getStats(unsigned int& numHits, unsigned int& numMisses)
+{
+    GLSLANG_LOCK_GUARD(guard, mutex, ELockPageCache);
+    numHits = hits;
+    numMisses = misses;
+}
+
 const unsigned char TAllocation::guardBlockBeginVal = 0xfb;
 const unsigned char TAllocation::guardBlockEndVal   = 0xfe;
 const unsigned char TAllocation::userDataFill       = 0xcd;
@@ -287,6 +376,9 @@ void* TPoolAllocator::allocate(size_t numBytes)
     if (freeList) {
         memory = freeList;
         freeList = freeList->nextPage;
+    } else if (pageCache != nullptr && pageCache->getPageSize() == pageSize &&
+               (memory = static_cast<tHeader*>(pageCache->take())) != nullptr) {
+        // reusing a page another pool gave back
     } else {
         memory = reinterpret_cast<tHeader*>(::new char[pageSize]);
         if (memory == 0)
@@ -66,12 +66,12 @@
 #include "reflection.h"
 #include "iomapper.h"
 #include "Initialize.h"
+#include "../Include/LockStats.h"
 
 namespace { // anonymous namespace for file-local functions and symbols
 
 // Total number of successful initializers of glslang: a refcount
-// Shared global; access should be protected by a global mutex/critical section.
-int NumberOfClients = 0;
+std::atomic<int> NumberOfClients(0);
 
 using namespace glslang;
 
@@ -210,18 +210,92 @@ enum EPrecisionClass {
     EPcCount
 };
 
-// A process-global symbol table per version per profile for built-ins common
-// to multiple stages (languages), and a process-global symbol table per version
-// per profile per stage for built-ins unique to each stage.  They will be sparsely
-// populated, so they will only be generated as needed.
+} // end anonymous namespace
+
+namespace glslang {
+
+// Symbol tables per version per profile for built-ins common to multiple
+// stages (languages), and per version per profile per stage for built-ins
+// unique to each stage.  They will be sparsely populated, so they will only
+// be generated as needed.
 //
 // Each has a different set of built-ins, and we want to preserve that from
-// compile to compile.
+// compile to compile.  There is one set of these for the process, and one per
+// TCompilerContext.  Each version/profile/... set has its own pool, so sets can
+// be dropped one at a time.
 //
-TSymbolTable* CommonSymbolTable[VersionCount][SpvVersionCount][ProfileCount][SourceCount][EPcCount] = {};
-TSymbolTable* SharedSymbolTables[VersionCount][SpvVersionCount][ProfileCount][SourceCount][EShLangCount] = {};
+class TBuiltInTables {
+public:
+    TBuiltInTables() : pageCache(nullptr), bytes(0), useClock(0), tableSets(0), trims(0)
+    {
+        memset(commonTables, 0, sizeof(commonTables));
+        memset(sharedTables, 0, sizeof(sharedTables));
+        memset(pools, 0, sizeof(pools));
+        std::atomic<unsigned long long>* use = &lastUse[0][0][0][0];
+        for (size_t u = 0; u < sizeof(lastUse) / sizeof(lastUse[0][0][0][0]); ++u)
+            use[u].store(0, std::memory_order_relaxed);
+        setNotReady();
+    }
+    ~TBuiltInTables() { clear(); }
+
+    void setPageCache(TPoolPageCache* cache) { pageCache = cache; }
+
+    void setup(int version, EProfile, const SpvVersion&, EShSource);
+    TSymbolTable* getShared(int version, EProfile profile, const SpvVersion& spvVersion, EShSource source,
+                            EShLanguage stage) const
+    {
+        return sharedTables[MapVersionToIndex(version)]
+                           [MapSpvVersionToIndex(spvVersion)]
+                           [MapProfileToIndex(profile)]
+                           [MapSourceToIndex(source)]
+                           [stage];
+    }
+
+    // Only while nothing made from the tables is still in use.
+    void clear();
+    // Drop least recently used sets until within 'maxBytes', but keep the most
+    // recently used one, which is the one likely to be needed next.
+    void trim(size_t maxBytes);
+
+    size_t getBytes();
+    unsigned int getTableSets() const { return tableSets; }
+    unsigned int getTrims() const { return trims; }
 
-TPoolAllocator* PerProcessGPA = nullptr;
+protected:
+    void setNotReady()
+    {
+        std::atomic<bool>* flag = &ready[0][0][0][0];
+        for (size_t f = 0; f < sizeof(ready) / sizeof(ready[0][0][0][0]); ++f)
+            flag[f].store(false, std::memory_order_relaxed);
+    }
+    // Called with 'mutex' held.
+    void clearSet(int version, int spvVersion, int profile, int source);
+
+    std::mutex mutex;   // held while setting up or clearing
+    // Set once the tables of a version/profile/... are complete, so compiles
+    // needing tables already set up don't have to take the lock.
+    std::atomic<bool> ready[VersionCount][SpvVersionCount][ProfileCount][SourceCount];
+    TSymbolTable* commonTables[VersionCount][SpvVersionCount][ProfileCount][SourceCount][EPcCount];
+    TSymbolTable* sharedTables[VersionCount][SpvVersionCount][ProfileCount][SourceCount][EShLangCount];
+    TPoolAllocator* pools[VersionCount][SpvVersionCount][ProfileCount][SourceCount];  // holding each set's tables
+    // 'useClock' when each set was last set up or asked for
+    std::atomic<unsigned long long> lastUse[VersionCount][SpvVersionCount][ProfileCount][SourceCount];
+    TPoolPageCache* pageCache;
+    size_t bytes;                   // in 'pools'; guarded by 'mutex'
+    std::atomic<unsigned long long> useClock;
+    std::atomic<unsigned int> tableSets;  // now held
+    std::atomic<unsigned int> trims;      // sets dropped
+
+private:
+    TBuiltInTables(const TBuiltInTables&);
+    TBuiltInTables& operator=(const TBuiltInTables&);
+};
+
+} // end namespace glslang
+
+namespace { // anonymous namespace for file-local functions and symbols
+
+TBuiltInTables* ProcessBuiltInTables = nullptr;
 
 //
 // Parse and add to the given symbol table the content of the given shader string.
@@ -360,85 +434,6 @@ bool AddContextSpecificSymbols(const TBuiltInResource* resources, TInfoSink& inf
     return true;
 }
 
-//
-// To do this on the fly, we want to leave the current state of our thread's
-// pool allocator intact, so:
-//  - Switch to a new pool for parsing the built-ins
-//  - Do the parsing, which builds the symbol table, using the new pool
-//  - Switch to the process-global pool to save a copy of the resulting symbol table
-//  - Free up the new pool used to parse the built-ins
-//  - Switch back to the original thread's pool
-//
-// This only gets done the first time any thread needs a particular symbol table
-// (lazy evaluation).
-//
-void SetupBuiltinSymbolTable(int version, EProfile profile, const SpvVersion& spvVersion, EShSource source)
-{
-    TInfoSink infoSink;
-
-    // Make sure only one thread tries to do this at a time
-    glslang::GetGlobalLock();
-
-    // See if it's already been done for this version/profile combination
-    int versionIndex = MapVersionToIndex(version);
-    int spvVersionIndex = MapSpvVersionToIndex(spvVersion);
-    int profileIndex = MapProfileToIndex(profile);
-    int sourceIndex = MapSourceToIndex(source);
-    if (CommonSymbolTable[versionIndex][spvVersionIndex][profileIndex][sourceIndex][EPcGeneral]) {
-        glslang::ReleaseGlobalLock();
-
-        return;
-    }
-
-    // Switch to a new pool
-    TPoolAllocator& previousAllocator = GetThreadPoolAllocator();
-    TPoolAllocator* builtInPoolAllocator = new TPoolAllocator;
-    SetThreadPoolAllocator(builtInPoolAllocator);
-
-    // Dynamically allocate the local symbol tables so we can control when they are deallocated WRT when the pool is popped.
-    TSymbolTable* commonTable[EPcCount];
-    TSymbolTable* stageTables[EShLangCount];
-    for (int precClass = 0; precClass < EPcCount; ++precClass)
-        commonTable[precClass] = new TSymbolTable;
-    for (int stage = 0; stage < EShLangCount; ++stage)
-        stageTables[stage] = new TSymbolTable;
-
-    // Generate the local symbol tables using the new pool
-    InitializeSymbolTables(infoSink, commonTable, stageTables, version, profile, spvVersion, source);
-
-    // Switch to the process-global pool
-    SetThreadPoolAllocator(PerProcessGPA);
-
-    // Copy the local symbol tables from the new pool to the global tables using the process-global pool
-    for (int precClass = 0; precClass < EPcCount; ++precClass) {
-        if (! commonTable[precClass]->isEmpty()) {
-            CommonSymbolTable[versionIndex][spvVersionIndex][profileIndex][sourceIndex][precClass] = new TSymbolTable;
-            CommonSymbolTable[versionIndex][spvVersionIndex][profileIndex][sourceIndex][precClass]->copyTable(*commonTable[precClass]);
-            CommonSymbolTable[versionIndex][spvVersionIndex][profileIndex][sourceIndex][precClass]->readOnly();
-        }
-    }
-    for (int stage = 0; stage < EShLangCount; ++stage) {
-        if (! stageTables[stage]->isEmpty()) {
-            SharedSymbolTables[versionIndex][spvVersionIndex][profileIndex][sourceIndex][stage] = new TSymbolTable;
-            SharedSymbolTables[versionIndex][spvVersionIndex][profileIndex][sourceIndex][stage]->adoptLevels(*CommonSymbolTable
-                              [versionIndex][spvVersionIndex][profileIndex][sourceIndex][CommonIndex(profile, (EShLanguage)stage)]);
-            SharedSymbolTables[versionIndex][spvVersionIndex][profileIndex][sourceIndex][stage]->copyTable(*stageTables[stage]);
-            SharedSymbolTables[versionIndex][spvVersionIndex][profileIndex][sourceIndex][stage]->readOnly();
-        }
-    }
-
-    // Clean up the local tables before deleting the pool they used.
-    for (int precClass = 0; precClass < EPcCount; ++precClass)
-        delete commonTable[precClass];
-    for (int stage = 0; stage < EShLangCount; ++stage)
-        delete stageTables[stage];
-
-    delete builtInPoolAllocator;
-    SetThreadPoolAllocator(&previousAllocator);
-
-    glslang::ReleaseGlobalLock();
-}
-
 // Return true if the shader was correctly specified for version/profile/stage.
 bool DeduceVersionProfile(TInfoSink& infoSink, EShLanguage stage, bool versionNotFirst, int defaultVersion,
                           EShSource source, int& version, EProfile& profile, const SpvVersion& spvVersion)
@@ -823,15 +818,13 @@ bool ProcessDeferred(
     if (messages & EShMsgDebugInfo) {
         intermediate.setSourceFile(names[numPre]);
         for (int s = 0; s < numStrings; ++s)
-            intermediate.addSourceText(strings[numPre + s]);
+            intermediate.addSourceText(strings[numPre + s], lengths[numPre + s]);
     }
-    SetupBuiltinSymbolTable(version, profile, spvVersion, source);
-
-    TSymbolTable* cachedTable = SharedSymbolTables[MapVersionToIndex(version)]
-                                                  [MapSpvVersionToIndex(spvVersion)]
-                                                  [MapProfileToIndex(profile)]
-                                                  [MapSourceToIndex(source)]
-                                                  [stage];
+    TPhaseTimer builtInTimer(intermediate.getPhaseTimes() ? &intermediate.getPhaseTimes()->builtIns : nullptr);
+    TBuiltInTables& builtInTables = intermediate.getBuiltInTables() != nullptr ? *intermediate.getBuiltInTables()
+                                                                               : *ProcessBuiltInTables;
+    builtInTables.setup(version, profile, spvVersion, source);
+    TSymbolTable* cachedTable = builtInTables.getShared(version, profile, spvVersion, source, stage);
 
     // Dynamically allocate the symbol table so we can control when it is deallocated WRT the pool.
     std::unique_ptr<TSymbolTable> symbolTable(new TSymbolTable);
@@ -844,6 +837,8 @@ bool ProcessDeferred(
                                     stage, source)) {
         return false;
     }
+    builtInTimer.stop();
+    symbolTable->setCompileStats(intermediate.getCompileStats());
 
     //
     // Now we can process the full shader under proper symbols and rules.
@@ -853,6 +848,9 @@ bool ProcessDeferred(
                                                     stage, compiler->infoSink,
                                                     spvVersion, forwardCompatible, messages, false, sourceEntryPointName));
     TPpContext ppContext(*parseContext, names[numPre] ? names[numPre] : "", includer);
+    ppContext.setMacroQueries(intermediate.getMacroQueries());
+    ppContext.setCancellation(intermediate.getCancellation());
+    ppContext.setCompileStats(intermediate.getCompileStats());
 
     // only GLSL (bison triggered, really) needs an externally set scan context
     glslang::TScanContext scanContext(*parseContext);
@@ -1186,6 +1184,29 @@ bool CompileDeferred(
                            true, includer, sourceEntryPointName, environment);
 }
 
+#ifdef GLSLANG_COMPILE_STATS
+// Counts the nodes of an AST, by class, into a TCompileStats.
+class TNodeCounter : public TIntermTraverser {
+public:
+    explicit TNodeCounter(TCompileStats& stats) : stats(stats) { }
+
+    virtual void visitSymbol(TIntermSymbol*)               { ++stats.symbolNodes; }
+    virtual void visitConstantUnion(TIntermConstantUnion*) { ++stats.constantNodes; }
+    virtual bool visitBinary(TVisit, TIntermBinary*)       { ++stats.binaryNodes; return true; }
+    virtual bool visitUnary(TVisit, TIntermUnary*)         { ++stats.unaryNodes; return true; }
+    virtual bool visitSelection(TVisit, TIntermSelection*) { ++stats.selectionNodes; return true; }
+    virtual bool visitAggregate(TVisit, TIntermAggregate*) { ++stats.aggregateNodes; return true; }
+    virtual bool visitLoop(TVisit, TIntermLoop*)           { ++stats.loopNodes; return true; }
+    virtual bool visitBranch(TVisit, TIntermBranch*)       { ++stats.branchNodes; return true; }
+    virtual bool visitSwitch(TVisit, TIntermSwitch*)       { ++stats.switchNodes; return true; }
+
+protected:
+    TNodeCounter& operator=(const TNodeCounter&);
+
+    TCompileStats& stats;
+};
+#endif
+
 } // end anonymous namespace for local functions
 
 //
@@ -1198,12 +1219,10 @@ int ShInitialize()
     if (! InitProcess())
         return 0;
 
-    glslang::GetGlobalLock();
     ++NumberOfClients;
-    glslang::ReleaseGlobalLock();
 
-    if (PerProcessGPA == nullptr)
-        PerProcessGPA = new TPoolAllocator();
+    if (ProcessBuiltInTables == nullptr)
+        ProcessBuiltInTables = new TBuiltInTables;
 
     glslang::TScanContext::fillInKeywordMap();
 #ifdef ENABLE_HLSL
@@ -1268,44 +1287,13 @@ void ShDestruct(ShHandle handle)
 //
 int __fastcall ShFinalize()
 {
-    glslang::GetGlobalLock();
-    --NumberOfClients;
-    assert(NumberOfClients >= 0);
-    bool finalize = NumberOfClients == 0;
-    glslang::ReleaseGlobalLock();
-    if (! finalize)
+    const int clients = --NumberOfClients;
+    assert(clients >= 0);
+    if (clients > 0)
         return 1;
 
-    for (int version = 0; version < VersionCount; ++version) {
-        for (int spvVersion = 0; spvVersion < SpvVersionCount; ++spvVersion) {
-            for (int p = 0; p < ProfileCount; ++p) {
-                for (int source = 0; source < SourceCount; ++source) {
-                    for (int stage = 0; stage < EShLangCount; ++stage) {
-                        delete SharedSymbolTables[version][spvVersion][p][source][stage];
-                        SharedSymbolTables[version][spvVersion][p][source][stage] = 0;
-                    }
-                }
-            }
-        }
-    }
-
-    for (int version = 0; version < VersionCount; ++version) {
-        for (int spvVersion = 0; spvVersion < SpvVersionCount; ++spvVersion) {
-            for (int p = 0; p < ProfileCount; ++p) {
-                for (int source = 0; source < SourceCount; ++source) {
-                    for (int pc = 0; pc < EPcCount; ++pc) {
-                        delete CommonSymbolTable[version][spvVersion][p][source][pc];
-                        CommonSymbolTable[version][spvVersion][p][source][pc] = 0;
-                    }
-                }
-            }
-        }
-    }
-
-    if (PerProcessGPA != nullptr) {
-        delete PerProcessGPA;
-        PerProcessGPA = nullptr;
-    }
+    delete ProcessBuiltInTables;
+    ProcessBuiltInTables = nullptr;
 
     glslang::TScanContext::deleteKeywordMap();
 #ifdef ENABLE_HLSL
@@ -1604,12 +1592,14 @@ public:
 };
 
 TShader::TShader(EShLanguage s)
-    : stage(s), lengths(nullptr), stringNames(nullptr), preamble("")
+    : stage(s), lengths(nullptr), stringNames(nullptr), preamble(""), compilerContext(nullptr), cancelled(false)
 {
     pool = new TPoolAllocator;
     infoSink = new TInfoSink;
     compiler = new TDeferredCompiler(stage, *infoSink);
     intermediate = new TIntermediate(s);
+    intermediate->setPhaseTimes(&phaseTimes);
+    intermediate->setCompileStats(&compileStats);
 
     // clear environment (avoid constructors in them for use in a C interface)
     environment.input.languageFamily = EShSourceNone;
@@ -1625,6 +1615,8 @@ TShader::~TShader()
     delete compiler;
     delete intermediate;
     delete pool;
+    if (compilerContext != nullptr)
+        compilerContext->detach();
 }
 
 void TShader::setStrings(const char* const* s, int n)
@@ -1700,6 +1692,75 @@ void TShader::setHlslIoMapping(bool hlslIoMap)          { intermediate->setHlslI
 void TShader::setFlattenUniformArrays(bool flatten)     { intermediate->setFlattenUniformArrays(flatten); }
 void TShader::setNoStorageFormat(bool useUnknownFormat) { intermediate->setNoStorageFormat(useUnknownFormat); }
 void TShader::setResourceSetBinding(const std::vector<std::string>& base)   { intermediate->setResourceSetBinding(base); }
+void TShader::setCancellation(TCancellation* c)          { intermediate->setCancellation(c); }
+
+bool TCompileStats::isGathered()
+{
+#ifdef GLSLANG_COMPILE_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef GLSLANG_LOCK_STATS
+namespace {
+const char* const LockNames[ELockCount] = { "built-ins", "compiler context", "page cache", "virtual files",
+                                              "process" };
+std::atomic<unsigned long long> LockAcquisitions[ELockCount];
+std::atomic<unsigned long long> LockContentions[ELockCount];
+std::atomic<long long> LockWaitTicks[ELockCount];   // steady_clock ticks
+}
+
+void CountLock(TLockKind kind, bool contended, std::chrono::steady_clock::duration wait)
+{
+    ++LockAcquisitions[kind];
+    if (contended) {
+        ++LockContentions[kind];
+        LockWaitTicks[kind] += (long long)wait.count();
+    }
+}
+#endif
+
+std::vector<TLockStats> GetLockStats()
+{
+    std::vector<TLockStats> stats;
+#ifdef GLSLANG_LOCK_STATS
+    for (int kind = 0; kind < ELockCount; ++kind) {
+        TLockStats lock;
+        lock.name = LockNames[kind];
+        lock.acquisitions = LockAcquisitions[kind];
+        lock.contentions = LockContentions[kind];
+        lock.waitSeconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::duration((std::chrono::steady_clock::rep)LockWaitTicks[kind])).count();
+        stats.push_back(lock);
+    }
+#endif
+
+    return stats;
+}
+
+void ResetLockStats()
+{
+#ifdef GLSLANG_LOCK_STATS
+    for (int kind = 0; kind < ELockCount; ++kind) {
+        LockAcquisitions[kind] = 0;
+        LockContentions[kind] = 0;
+        LockWaitTicks[kind] = 0;
+    }
+#endif
+}
+
+void TShader::setCompilerContext(TCompilerContext* context)
+{
+    assert(compilerContext == nullptr);
+    if (context == nullptr)
+        return;
+    compilerContext = context;
+    compilerContext->attach();
+    intermediate->setBuiltInTables(context->builtIns);
+    pool->setPageCache(context->pageCache);
+}
 void TShader::setTextureSamplerTransformMode(EShTextureSamplerTransformMode mode) { intermediate->setTextureSamplerTransformMode(mode); }
 
 //
@@ -1717,11 +1778,26 @@ bool TShader::parse(const TBuiltInResource* builtInResources, int defaultVersion
     if (! preamble)
         preamble = "";
 
-    return CompileDeferred(compiler, strings, numStrings, lengths, stringNames,
-                           preamble, EShOptNone, builtInResources, defaultVersion,
-                           defaultProfile, forceDefaultVersionAndProfile,
-                           forwardCompatible, messages, *intermediate, includer, sourceEntryPointName,
-                           &environment);
+    const double builtIns = phaseTimes.builtIns;
+    TPhaseTimer timer(&phaseTimes.parse);
+    bool success = CompileDeferred(compiler, strings, numStrings, lengths, stringNames,
+                                   preamble, EShOptNone, builtInResources, defaultVersion,
+                                   defaultProfile, forceDefaultVersionAndProfile,
+                                   forwardCompatible, messages, *intermediate, includer, sourceEntryPointName,
+                                   &environment);
+    timer.stop();
+    phaseTimes.parse -= phaseTimes.builtIns - builtIns;
+    cancelled = intermediate->wasCancelled();
+
+#ifdef GLSLANG_COMPILE_STATS
+    if (intermediate->getTreeRoot() != nullptr) {
+        TNodeCounter counter(compileStats);
+        intermediate->getTreeRoot()->traverse(&counter);
+    }
+    compileStats.poolBytes = pool->getAllocatedBytes();
+#endif
+
+    return success;
 }
 
 // Fill in a string with the result of preprocessing ShaderStrings
@@ -1740,10 +1816,17 @@ bool TShader::preprocess(const TBuiltInResource* builtInResources,
     if (! preamble)
         preamble = "";
 
-    return PreprocessDeferred(compiler, strings, numStrings, lengths, stringNames, preamble,
-                              EShOptNone, builtInResources, defaultVersion,
-                              defaultProfile, forceDefaultVersionAndProfile,
-                              forwardCompatible, message, includer, *intermediate, output_string);
+    const double builtIns = phaseTimes.builtIns;
+    TPhaseTimer timer(&phaseTimes.preprocess);
+    bool success = PreprocessDeferred(compiler, strings, numStrings, lengths, stringNames, preamble,
+                                      EShOptNone, builtInResources, defaultVersion,
+                                      defaultProfile, forceDefaultVersionAndProfile,
+                                      forwardCompatible, message, includer, *intermediate, output_string);
+    timer.stop();
+    phaseTimes.preprocess -= phaseTimes.builtIns - builtIns;
+    cancelled = intermediate->wasCancelled();
+
+    return success;
 }
 
 const char* TShader::getInfoLog()
@@ -1756,6 +1839,169 @@ const char* TShader::getInfoDebugLog()
     return infoSink->debug.c_str();
 }
 
+void TShader::releaseIntermediate()
+{
+    delete intermediate;
+    intermediate = nullptr;
+
+    // Swap in an empty pool, rather than none, so the thread's current pool
+    // stays valid when it was this shader's.
+    TPoolAllocator* released = pool;
+    pool = new TPoolAllocator;
+    if (compilerContext != nullptr)
+        pool->setPageCache(compilerContext->pageCache);
+    if (&GetThreadPoolAllocator() == released)
+        SetThreadPoolAllocator(pool);
+    delete released;
+}
+
+//
+// TMacroDedupVariants: one shader under several sets of macro definitions,
+// parsed once per distinct set of the macros it uses.
+//
+
+TMacroDedupVariants::TMacroDedupVariants(EShLanguage s, const TSetup& setupShader)
+    : stage(s), setup(setupShader), numParses(0)
+{
+}
+
+TMacroDedupVariants::~TMacroDedupVariants()
+{
+}
+
+int TMacroDedupVariants::addVariant(const std::vector<std::string>& defines)
+{
+    variants.push_back(TVariant());
+    TVariant& variant = variants.back();
+
+    // Same form as the command line's -D: the first "=" becomes a space.
+    for (size_t d = 0; d < defines.size(); ++d) {
+        std::string define = defines[d].substr(0, defines[d].find_first_of("\n"));
+        const size_t equal = define.find_first_of("=");
+        if (equal == std::string::npos)
+            variant.defines.push_back(std::make_pair(define, std::string()));
+        else
+            variant.defines.push_back(std::make_pair(define.substr(0, equal), define.substr(equal + 1)));
+
+        variant.preamble.append("#define ");
+        variant.preamble.append(variant.defines.back().first);
+        if (equal != std::string::npos) {
+            variant.preamble.append(" ");
+            variant.preamble.append(variant.defines.back().second);
+        }
+        variant.preamble.append("\n");
+    }
+
+    return (int)variants.size() - 1;
+}
+
+//
+// Would 'variant' preprocess just like 'parsed' did?  It does if the two define
+// every macro 'parsed' looked up the same way (including not at all), since
+// preprocessing then gets the same answers to all the same questions.
+//
+bool TMacroDedupVariants::sameAsParsed(const TVariant& variant, const TVariant& parsed) const
+{
+    for (auto name = parsed.macroQueries.begin(); name != parsed.macroQueries.end(); ++name) {
+        auto define = variant.defines.begin();
+        auto parsedDefine = parsed.defines.begin();
+        for (;;) {
+            while (define != variant.defines.end() && define->first != *name)
+                ++define;
+            while (parsedDefine != parsed.defines.end() && parsedDefine->first != *name)
+                ++parsedDefine;
+            if (define == variant.defines.end() || parsedDefine == parsed.defines.end()) {
+                if (define != variant.defines.end() || parsedDefine != parsed.defines.end())
+                    return false;
+                break;
+            }
+            if (define->second != parsedDefine->second)
+                return false;
+            ++define;
+            ++parsedDefine;
+        }
+    }
+
+    return true;
+}
+
+//
+// Would 'variant''s own #defines compile without any message?  A bad or reserved
+// macro name ("1BAD", "GL_FOO", ...) fails a separate compile of the variant
+// even where the shader never looks at it, so such a variant can't share a parse.
+// Checked by preprocessing just the preamble, under the version and profile
+// 'parsed' found.
+//
+bool TMacroDedupVariants::macrosAreClean(const TVariant& variant, const TVariant& parsed,
+                                     const TBuiltInResource* builtInResources, bool forwardCompatible,
+                                     EShMessages messages) const
+{
+    TShader shader(stage);
+    setup(shader);
+    std::string preamble = shader.preamble != nullptr ? shader.preamble : "";
+    if (! preamble.empty() && preamble.back() != '\n')
+        preamble.append("\n");
+    preamble.append(variant.preamble);
+    shader.setPreamble(preamble.c_str());
+    const char* empty = "";
+    shader.setStrings(&empty, 1);
+
+    const TIntermediate& intermediate = *parsed.shader->intermediate;
+    TShader::ForbidIncluder includer;
+    std::string output;
+    if (! shader.preprocess(builtInResources, intermediate.getVersion(), intermediate.getProfile(), true,
+                            forwardCompatible, messages, &output, includer))
+        return false;
+
+    return *shader.getInfoLog() == '\0';
+}
+
+bool TMacroDedupVariants::parse(const TBuiltInResource* builtInResources, int defaultVersion, bool forwardCompatible,
+                            EShMessages messages, TShader::Includer& includer)
+{
+    bool success = true;
+    for (size_t v = 0; v < variants.size(); ++v) {
+        TVariant& variant = variants[v];
+        if (variant.parsed >= 0)
+            continue;
+
+        for (size_t p = 0; p < v; ++p) {
+            if (variants[p].parsed == (int)p && sameAsParsed(variant, variants[p])) {
+                if (macrosAreClean(variant, variants[p], builtInResources, forwardCompatible, messages))
+                    variant.parsed = (int)p;
+                break;
+            }
+        }
+        if (variant.parsed >= 0) {
+            success = success && variants[variant.parsed].parsedOk;
+            continue;
+        }
+
+        variant.shader.reset(new TShader(stage));
+        setup(*variant.shader);
+        std::string common = variant.shader->preamble != nullptr ? variant.shader->preamble : "";
+        if (! common.empty() && common.back() != '\n')
+            common.append("\n");
+        variant.preamble.insert(0, common);
+        variant.shader->setPreamble(variant.preamble.c_str());
+        variant.shader->intermediate->setMacroQueries(&variant.macroQueries);
+
+        variant.parsedOk = variant.shader->parse(builtInResources, defaultVersion, forwardCompatible, messages, includer);
+        variant.shader->intermediate->setMacroQueries(nullptr);
+        variant.parsed = (int)v;
+        ++numParses;
+        success = success && variant.parsedOk;
+    }
+
+    return success;
+}
+
+TShader* TMacroDedupVariants::getShader(int variant) const
+{
+    const int parsed = variants[variant].parsed;
+    return parsed >= 0 ? variants[parsed].shader.get() : nullptr;
+}
+
 TProgram::TProgram() : reflection(0), ioMapper(nullptr), linked(false)
 {
     pool = new TPoolAllocator;
@@ -1779,6 +2025,41 @@ TProgram::~TProgram()
     delete pool;
 }
 
+void TProgram::setCompilerContext(TCompilerContext* context)
+{
+    pool->setPageCache(context != nullptr ? context->pageCache : nullptr);
+}
+
+//
+// The program's own pool is kept, as the reflection's types are in it.
+// A merged intermediate only has its containers freed; the nodes it
+// made are in that pool too.
+//
+void TProgram::releaseIntermediates()
+{
+    for (int s = 0; s < EShLangCount; ++s) {
+        if (newedIntermediate[s])
+            delete intermediate[s];
+        newedIntermediate[s] = false;
+        intermediate[s] = nullptr;
+
+        for (auto shader = stages[s].begin(); shader != stages[s].end(); ++shader)
+            (*shader)->releaseIntermediate();
+    }
+}
+
+bool TProgram::wasCancelled() const
+{
+    for (int s = 0; s < EShLangCount; ++s) {
+        for (auto shader = stages[s].begin(); shader != stages[s].end(); ++shader) {
+            if ((*shader)->wasCancelled())
+                return true;
+        }
+    }
+
+    return false;
+}
+
 //
 // Merge the compilation units within each stage into a single TIntermediate.
 // All starting compilation units need to be the result of calling TShader::parse().
@@ -1795,11 +2076,20 @@ bool TProgram::link(EShMessages messages)
 
     SetThreadPoolAllocator(pool);
 
+    TPhaseTimer timer(&phaseTimes.link);
     for (int s = 0; s < EShLangCount; ++s) {
         if (! linkStage((EShLanguage)s, messages))
             error = true;
     }
 
+#ifdef GLSLANG_COMPILE_STATS
+    for (int s = 0; s < EShLangCount; ++s) {
+        for (auto shader = stages[s].begin(); shader != stages[s].end(); ++shader)
+            compileStats.add((*shader)->compileStats);
+    }
+    compileStats.poolBytes += pool->getAllocatedBytes();
+#endif
+
     // TODO: Link: cross-stage error checking
 
     return ! error;
@@ -1891,7 +2181,11 @@ bool TProgram::buildReflection()
     if (! linked || reflection)
         return false;
 
+    // The reflection's types are cloned into the program's pool, so they
+    // outlive releaseIntermediates().
+    SetThreadPoolAllocator(pool);
     reflection = new TReflection;
+    TPhaseTimer timer(&phaseTimes.reflection);
 
     for (int s = 0; s < EShLangCount; ++s) {
         if (intermediate[s]) {
@@ -1926,6 +2220,7 @@ const TType* TProgram::getUniformBlockTType(int index) const { return reflection
 unsigned TProgram::getLocalSize(int dim) const               { return reflection->getLocalSize(dim); }
 
 void TProgram::dumpReflection()                      { reflection->dump(); }
+void TProgram::dumpReflection(std::string& text)     { reflection->dump(text); }
 
 //
 // I/O mapping implementation.
@@ -1936,6 +2231,7 @@ bool TProgram::mapIO(TIoMapResolver* resolver)
         return false;
 
     ioMapper = new TIoMapper;
+    TPhaseTimer timer(&phaseTimes.ioMap);
 
     for (int s = 0; s < EShLangCount; ++s) {
         if (intermediate[s]) {
@@ -1947,4 +2243,343 @@ bool TProgram::mapIO(TIoMapResolver* resolver)
     return true;
 }
 
+//
+// To do this on the fly, we want to leave the current state of our thread's
+// pool allocator intact, so:
+//  - Switch to a new pool for parsing the built-ins
+//  - Do the parsing, which builds the symbol table, using the new pool
+//  - Switch to the pool of these tables to save a copy of the resulting symbol table
+//  - Free up the new pool used to parse the built-ins
+//  - Switch back to the original thread's pool
+//
+// This only gets done the first time any thread needs a particular symbol table
+// (lazy evaluation).
+//
+void TBuiltInTables::setup(int version, EProfile profile, const SpvVersion& spvVersion, EShSource source)
+{
+    // See if it's already been done for this version/profile combination
+    int versionIndex = MapVersionToIndex(version);
+    int spvVersionIndex = MapSpvVersionToIndex(spvVersion);
+    int profileIndex = MapProfileToIndex(profile);
+    int sourceIndex = MapSourceToIndex(source);
+    std::atomic<bool>& isReady = ready[versionIndex][spvVersionIndex][profileIndex][sourceIndex];
+    lastUse[versionIndex][spvVersionIndex][profileIndex][sourceIndex].store(
+        useClock.fetch_add(1, std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (isReady.load(std::memory_order_acquire))
+        return;
+
+    TInfoSink infoSink;
+
+    // Make sure only one thread tries to do this at a time
+    GLSLANG_LOCK_GUARD(guard, mutex, ELockBuiltIns);
+    if (isReady.load(std::memory_order_relaxed))
+        return;
+
+    TSymbolTable** common = commonTables[versionIndex][spvVersionIndex][profileIndex][sourceIndex];
+    TSymbolTable** shared = sharedTables[versionIndex][spvVersionIndex][profileIndex][sourceIndex];
+
+    TPoolAllocator*& pool = pools[versionIndex][spvVersionIndex][profileIndex][sourceIndex];
+    assert(pool == nullptr);
+    pool = new TPoolAllocator;
+    pool->setPageCache(pageCache);
+
+    // Switch to a new pool
+    TPoolAllocator& previousAllocator = GetThreadPoolAllocator();
+    TPoolAllocator* builtInPoolAllocator = new TPoolAllocator;
+    builtInPoolAllocator->setPageCache(pageCache);
+    SetThreadPoolAllocator(builtInPoolAllocator);
+
+    // Dynamically allocate the local symbol tables so we can control when they are deallocated WRT when the pool is popped.
+    TSymbolTable* commonTable[EPcCount];
+    TSymbolTable* stageTables[EShLangCount];
+    for (int precClass = 0; precClass < EPcCount; ++precClass)
+        commonTable[precClass] = new TSymbolTable;
+    for (int stage = 0; stage < EShLangCount; ++stage)
+        stageTables[stage] = new TSymbolTable;
+
+    // Generate the local symbol tables using the new pool
+    InitializeSymbolTables(infoSink, commonTable, stageTables, version, profile, spvVersion, source);
+
+    // Switch to the pool of these tables
+    SetThreadPoolAllocator(pool);
+
+    // Copy the local symbol tables from the new pool to these tables using their pool
+    for (int precClass = 0; precClass < EPcCount; ++precClass) {
+        if (! commonTable[precClass]->isEmpty()) {
+            common[precClass] = new TSymbolTable;
+            common[precClass]->copyTable(*commonTable[precClass]);
+            common[precClass]->readOnly();
+        }
+    }
+    for (int stage = 0; stage < EShLangCount; ++stage) {
+        if (! stageTables[stage]->isEmpty()) {
+            shared[stage] = new TSymbolTable;
+            shared[stage]->adoptLevels(*common[CommonIndex(profile, (EShLanguage)stage)]);
+            shared[stage]->copyTable(*stageTables[stage]);
+            shared[stage]->readOnly();
+        }
+    }
+
+    // Clean up the local tables before deleting the pool they used.
+    for (int precClass = 0; precClass < EPcCount; ++precClass)
+        delete commonTable[precClass];
+    for (int stage = 0; stage < EShLangCount; ++stage)
+        delete stageTables[stage];
+
+    delete builtInPoolAllocator;
+    SetThreadPoolAllocator(&previousAllocator);
+
+    bytes += pool->getAllocatedBytes();
+    ++tableSets;
+    isReady.store(true, std::memory_order_release);
+}
+
+void TBuiltInTables::clearSet(int version, int spvVersion, int profile, int source)
+{
+    TPoolAllocator*& pool = pools[version][spvVersion][profile][source];
+    if (pool == nullptr)
+        return;
+
+    ready[version][spvVersion][profile][source].store(false, std::memory_order_relaxed);
+    for (int stage = 0; stage < EShLangCount; ++stage) {
+        delete sharedTables[version][spvVersion][profile][source][stage];
+        sharedTables[version][spvVersion][profile][source][stage] = 0;
+    }
+    for (int pc = 0; pc < EPcCount; ++pc) {
+        delete commonTables[version][spvVersion][profile][source][pc];
+        commonTables[version][spvVersion][profile][source][pc] = 0;
+    }
+
+    bytes -= pool->getAllocatedBytes();
+    delete pool;
+    pool = nullptr;
+    --tableSets;
+    ++trims;
+}
+
+void TBuiltInTables::clear()
+{
+    GLSLANG_LOCK_GUARD(guard, mutex, ELockBuiltIns);
+
+    for (int version = 0; version < VersionCount; ++version) {
+        for (int spvVersion = 0; spvVersion < SpvVersionCount; ++spvVersion) {
+            for (int p = 0; p < ProfileCount; ++p) {
+                for (int source = 0; source < SourceCount; ++source)
+                    clearSet(version, spvVersion, p, source);
+            }
+        }
+    }
+}
+
+void TBuiltInTables::trim(size_t maxBytes)
+{
+    GLSLANG_LOCK_GUARD(guard, mutex, ELockBuiltIns);
+
+    while (bytes > maxBytes && tableSets > 1) {
+        TPoolAllocator** pool = &pools[0][0][0][0];
+        std::atomic<unsigned long long>* use = &lastUse[0][0][0][0];
+        int oldest = -1;
+        for (int set = 0; set < (int)(sizeof(pools) / sizeof(pools[0][0][0][0])); ++set) {
+            if (pool[set] != nullptr && (oldest < 0 || use[set].load(std::memory_order_relaxed) <
+                                                       use[oldest].load(std::memory_order_relaxed)))
+                oldest = set;
+        }
+        clearSet(oldest / (SourceCount * ProfileCount * SpvVersionCount),
+                 oldest / (SourceCount * ProfileCount) % SpvVersionCount,
+                 oldest / SourceCount % ProfileCount,
+                 oldest % SourceCount);
+    }
+}
+
+size_t TBuiltInTables::getBytes()
+{
+    GLSLANG_LOCK_GUARD(guard, mutex, ELockBuiltIns);
+
+    return bytes;
+}
+
+TCompilerContext::TCompilerContext() :
+    builtIns(new TBuiltInTables), pageCache(new TPoolPageCache(TPoolAllocator::DefaultPageSize, limits.pageCacheBytes)),
+    includeBytes(0), includeHits(0), includeMisses(0), attachedShaders(0)
+{
+    builtIns->setPageCache(pageCache);
+}
+
+TCompilerContext::TCompilerContext(const TLimits& l) : TCompilerContext()
+{
+    setLimits(l);
+}
+
+TCompilerContext::~TCompilerContext()
+{
+    assert(attachedShaders == 0);
+    delete builtIns;
+    delete pageCache;
+}
+
+void TCompilerContext::setLimits(const TLimits& l)
+{
+    {
+        GLSLANG_LOCK_GUARD(guard, mutex, ELockCompilerContext);
+        limits = l;
+        trimIncludes(limits.includeBytes);
+        trimBuiltIns();
+    }
+    pageCache->setMaxBytes(l.pageCacheBytes);
+}
+
+TCompilerContext::TLimits TCompilerContext::getLimits()
+{
+    GLSLANG_LOCK_GUARD(guard, mutex, ELockCompilerContext);
+    return limits;
+}
+
+TCompilerContext::TStats TCompilerContext::getStats()
+{
+    TStats stats;
+
+    stats.builtInBytes = builtIns->getBytes();
+    stats.builtInTableSets = builtIns->getTableSets();
+    stats.builtInTrims = builtIns->getTrims();
+    stats.pageCacheBytes = pageCache->getBytes();
+    pageCache->getStats(stats.pageCacheHits, stats.pageCacheMisses);
+
+    GLSLANG_LOCK_GUARD(guard, mutex, ELockCompilerContext);
+    stats.includeBytes = includeBytes;
+    stats.includeEntries = (unsigned int)includes.size();
+    stats.includeHits = includeHits;
+    stats.includeMisses = includeMisses;
+    stats.attachedShaders = attachedShaders;
+
+    return stats;
+}
+
+void TCompilerContext::trim()
+{
+    {
+        GLSLANG_LOCK_GUARD(guard, mutex, ELockCompilerContext);
+        trimIncludes(0);
+        if (attachedShaders == 0)
+            builtIns->clear();
+    }
+    size_t maxBytes = getLimits().pageCacheBytes;
+    pageCache->setMaxBytes(0);
+    pageCache->setMaxBytes(maxBytes);
+}
+
+// Called with 'mutex' held.
+void TCompilerContext::trimIncludes(size_t maxBytes)
+{
+    while (includeBytes > maxBytes) {
+        auto include = includes.find(includeLru.back());
+        includeBytes -= include->second.contents->size();
+        includes.erase(include);
+        includeLru.pop_back();
+    }
+}
+
+std::shared_ptr<const std::string> TCompilerContext::findInclude(const std::string& key, std::string& name)
+{
+    GLSLANG_LOCK_GUARD(guard, mutex, ELockCompilerContext);
+
+    auto include = includes.find(key);
+    if (include == includes.end()) {
+        ++includeMisses;
+        return nullptr;
+    }
+    ++includeHits;
+    includeLru.splice(includeLru.begin(), includeLru, include->second.lru);
+    name = include->second.name;
+
+    return include->second.contents;
+}
+
+void TCompilerContext::addInclude(const std::string& key, const std::string& name,
+                                  std::shared_ptr<const std::string> contents)
+{
+    GLSLANG_LOCK_GUARD(guard, mutex, ELockCompilerContext);
+
+    if (contents->size() > limits.includeBytes || includes.find(key) != includes.end())
+        return;
+
+    includeLru.push_front(key);
+    TInclude& include = includes[key];
+    include.name = name;
+    include.contents = contents;
+    include.lru = includeLru.begin();
+    includeBytes += contents->size();
+    trimIncludes(limits.includeBytes);
+}
+
+// Called with 'mutex' held.  ASTs refer to memory of the built-in tables, so
+// they are only dropped while no shader is attached; until then, the sets
+// compiles need are added past the limit.
+void TCompilerContext::trimBuiltIns()
+{
+    if (attachedShaders == 0)
+        builtIns->trim(limits.builtInBytes);
+}
+
+void TCompilerContext::attach()
+{
+    GLSLANG_LOCK_GUARD(guard, mutex, ELockCompilerContext);
+    trimBuiltIns();
+    ++attachedShaders;
+}
+
+void TCompilerContext::detach()
+{
+    GLSLANG_LOCK_GUARD(guard, mutex, ELockCompilerContext);
+    --attachedShaders;
+    assert(attachedShaders >= 0);
+    trimBuiltIns();
+}
+
+TShader::Includer::IncludeResult* TCompilerContext::CachingIncluder::includeSystem(const char* headerName,
+                                                                                   const char* includerName,
+                                                                                   size_t inclusionDepth)
+{
+    return include(false, headerName, includerName, inclusionDepth);
+}
+
+TShader::Includer::IncludeResult* TCompilerContext::CachingIncluder::includeLocal(const char* headerName,
+                                                                                  const char* includerName,
+                                                                                  size_t inclusionDepth)
+{
+    return include(true, headerName, includerName, inclusionDepth);
+}
+
+// The results own a shared_ptr to their contents, through 'userData', so
+// evicting an include doesn't pull it out from under the parse using it.
+TShader::Includer::IncludeResult* TCompilerContext::CachingIncluder::include(bool local, const char* headerName,
+                                                                             const char* includerName,
+                                                                             size_t inclusionDepth)
+{
+    std::string key = std::string(local ? "L" : "S") + headerName + '\0' + includerName;
+    std::string name;
+    std::shared_ptr<const std::string> contents = context.findInclude(key, name);
+
+    if (contents == nullptr) {
+        IncludeResult* result = local ? includer.includeLocal(headerName, includerName, inclusionDepth)
+                                      : includer.includeSystem(headerName, includerName, inclusionDepth);
+        if (result == nullptr)
+            return nullptr;
+        name = result->headerName;
+        contents = std::make_shared<const std::string>(result->headerData, result->headerLength);
+        includer.releaseInclude(result);
+        if (! name.empty())
+            context.addInclude(key, name, contents);
+    }
+
+    return new IncludeResult(name, contents->data(), contents->size(), new std::shared_ptr<const std::string>(contents));
+}
+
+void TCompilerContext::CachingIncluder::releaseInclude(IncludeResult* result)
+{
+    if (result != nullptr) {
+        delete static_cast<std::shared_ptr<const std::string>*>(result->userData);
+        delete result;
+    }
+}
+
 } // end namespace glslang
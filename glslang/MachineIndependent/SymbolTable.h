@@ -538,7 +538,8 @@ protected:
 
 class TSymbolTable {
 public:
-    TSymbolTable() : uniqueId(0), noBuiltInRedeclarations(false), separateNameSpaces(false), adoptedLevels(0)
+    TSymbolTable() : uniqueId(0), noBuiltInRedeclarations(false), separateNameSpaces(false), adoptedLevels(0),
+                     stats(nullptr)
     {
         //
         // This symbol table cannot be used until push() is called.
@@ -584,6 +585,8 @@ public:
 
     void setNoBuiltInRedeclarations() { noBuiltInRedeclarations = true; }
     void setSeparateNameSpaces() { separateNameSpaces = true; }
+    // Count look ups into 's'.
+    void setCompileStats(TCompileStats* s) { stats = s; }
 
     void push()
     {
@@ -694,6 +697,7 @@ public:
     // at a built-in level or the current top-scope level.
     TSymbol* find(const TString& name, bool* builtIn = 0, bool* currentScope = 0, int* thisDepthP = 0)
     {
+        GLSLANG_COUNT(stats, symbolLookups, 1);
         int level = currentLevel();
         TSymbol* symbol;
         int thisDepth = 0;
@@ -818,6 +822,7 @@ protected:
     bool noBuiltInRedeclarations;
     bool separateNameSpaces;
     unsigned int adoptedLevels;
+    TCompileStats* stats;
 };
 
 } // end namespace glslang
@@ -0,0 +1,248 @@
+//
+// Copyright (C) 2018 LunarG, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+//    Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//    Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//    Neither the name of 3Dlabs Inc. Ltd. nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+//
+// An Includer over in-memory files and directory roots.  See ShaderLang.h.
+//
+
+#include "../Public/ShaderLang.h"
+#include "../Include/LockStats.h"
+
+#include <fstream>
+#include <sys/stat.h>
+
+namespace glslang {
+
+bool TVirtualFileIncluder::addFile(const std::string& path, const char* contents, size_t length)
+{
+    GLSLANG_LOCK_GUARD(guard, mutex, ELockVirtualFiles);
+
+    TFile& file = files[normalize(path)];
+    if (file.contents != nullptr)
+        return false;
+    file.contents = contents;
+    file.length = length;
+
+    // Includes that missed may find it now.
+    lookups.clear();
+
+    return true;
+}
+
+bool TVirtualFileIncluder::addFile(const std::string& path, const std::string& contents)
+{
+    std::shared_ptr<const std::string> copy = std::make_shared<const std::string>(contents);
+
+    GLSLANG_LOCK_GUARD(guard, mutex, ELockVirtualFiles);
+
+    TFile& file = files[normalize(path)];
+    if (file.contents != nullptr)
+        return false;
+    file.contents = copy->data();
+    file.length = copy->size();
+    file.copy = copy;
+    lookups.clear();
+
+    return true;
+}
+
+void TVirtualFileIncluder::addRoot(const std::string& directory)
+{
+    GLSLANG_LOCK_GUARD(guard, mutex, ELockVirtualFiles);
+
+    roots.push_back(directory);
+
+    // Forget the files found missing, and the lookups that missed them.
+    for (auto file = files.begin(); file != files.end(); ) {
+        if (file->second.contents == nullptr)
+            file = files.erase(file);
+        else
+            ++file;
+    }
+    lookups.clear();
+}
+
+void TVirtualFileIncluder::addSearchDirectory(const std::string& directory)
+{
+    GLSLANG_LOCK_GUARD(guard, mutex, ELockVirtualFiles);
+
+    searchDirectories.push_back(normalize(directory));
+    lookups.clear();
+}
+
+TShader::Includer::IncludeResult* TVirtualFileIncluder::includeSystem(const char* headerName,
+                                                                      const char* includerName,
+                                                                      size_t /*inclusionDepth*/)
+{
+    return include(false, headerName, includerName);
+}
+
+TShader::Includer::IncludeResult* TVirtualFileIncluder::includeLocal(const char* headerName,
+                                                                     const char* includerName,
+                                                                     size_t /*inclusionDepth*/)
+{
+    return include(true, headerName, includerName);
+}
+
+// The contents belong to the includer, so only the result itself goes.
+void TVirtualFileIncluder::releaseInclude(IncludeResult* result)
+{
+    delete result;
+}
+
+// "a\b/./c/../d" becomes "a/b/d".  A leading '/', and ".."s that can't be
+// resolved, are kept.
+std::string TVirtualFileIncluder::normalize(const std::string& path)
+{
+    std::string normalized;
+    std::vector<std::string> parts;
+    size_t start = 0;
+    if (! path.empty() && (path[0] == '/' || path[0] == '\\'))
+        normalized.push_back('/');
+    while (start <= path.size()) {
+        size_t end = path.find_first_of("/\\", start);
+        if (end == std::string::npos)
+            end = path.size();
+        std::string part = path.substr(start, end - start);
+        if (part == ".." && ! parts.empty() && parts.back() != "..")
+            parts.pop_back();
+        else if (! part.empty() && part != ".")
+            parts.push_back(part);
+        start = end + 1;
+    }
+
+    for (size_t p = 0; p < parts.size(); ++p) {
+        if (p > 0)
+            normalized.push_back('/');
+        normalized.append(parts[p]);
+    }
+
+    return normalized;
+}
+
+// Returns the file at normalized 'path', or nullptr if it doesn't exist.
+// Files under the roots are read on first use, outside the lock; if two
+// threads race to read one, both read the same text, and the first is kept.
+// Paths leaving the file system, absolute or above its top, never exist.
+const TVirtualFileIncluder::TFile* TVirtualFileIncluder::find(const std::string& path)
+{
+    if (path.empty() || path[0] == '/' || path.compare(0, 3, "../") == 0 || path == "..")
+        return nullptr;
+
+    std::vector<std::string> rootsToSearch;
+    {
+        GLSLANG_LOCK_GUARD(guard, mutex, ELockVirtualFiles);
+        auto file = files.find(path);
+        if (file != files.end())
+            return file->second.contents != nullptr ? &file->second : nullptr;
+        rootsToSearch = roots;
+    }
+
+    TFile found;
+    for (auto root = rootsToSearch.rbegin(); root != rootsToSearch.rend() && found.contents == nullptr; ++root) {
+        // Only regular files; a directory, say, opens but has no sensible size.
+        const std::string fileName = *root + '/' + path;
+        struct stat info;
+        if (stat(fileName.c_str(), &info) != 0 || (info.st_mode & S_IFMT) != S_IFREG)
+            continue;
+        std::ifstream stream(fileName, std::ios_base::binary | std::ios_base::ate);
+        if (! stream)
+            continue;
+        const std::streamoff size = stream.tellg();
+        if (size < 0)
+            continue;
+        std::string text((size_t)size, '\0');
+        stream.seekg(0, stream.beg);
+        if (! stream.read(&text[0], text.size()))
+            continue;
+        found.copy = std::make_shared<const std::string>(std::move(text));
+        found.contents = found.copy->data();
+        found.length = found.copy->size();
+    }
+
+    GLSLANG_LOCK_GUARD(guard, mutex, ELockVirtualFiles);
+    const TFile& file = files.insert(std::make_pair(path, found)).first->second;
+
+    return file.contents != nullptr ? &file : nullptr;
+}
+
+TShader::Includer::IncludeResult* TVirtualFileIncluder::include(bool local, const char* headerName,
+                                                                const char* includerName)
+{
+    std::string directory;
+    if (local) {
+        directory = normalize(includerName != nullptr ? includerName : "");
+        size_t last = directory.find_last_of('/');
+        directory = last == std::string::npos ? "" : directory.substr(0, last + 1);
+    }
+    const std::string key = std::string(local ? "L" : "S") + headerName + '\0' + directory;
+
+    std::string resolved;
+    std::vector<std::string> candidates;
+    {
+        GLSLANG_LOCK_GUARD(guard, mutex, ELockVirtualFiles);
+        auto lookup = lookups.find(key);
+        if (lookup != lookups.end()) {
+            if (lookup->second.empty())
+                return nullptr;
+            const TFile& file = files[lookup->second];
+            return new IncludeResult(lookup->second, file.contents, file.length, nullptr);
+        }
+
+        if (local)
+            candidates.push_back(normalize(headerName[0] == '/' ? std::string(headerName) : directory + headerName));
+        else {
+            for (auto dir = searchDirectories.rbegin(); dir != searchDirectories.rend(); ++dir)
+                candidates.push_back(normalize(dir->empty() ? std::string(headerName) : *dir + '/' + headerName));
+        }
+    }
+
+    const TFile* file = nullptr;
+    for (size_t c = 0; c < candidates.size() && file == nullptr; ++c) {
+        file = find(candidates[c]);
+        if (file != nullptr)
+            resolved = candidates[c];
+    }
+
+    GLSLANG_LOCK_GUARD(guard, mutex, ELockVirtualFiles);
+    lookups[key] = resolved;
+    if (file == nullptr)
+        return nullptr;
+
+    return new IncludeResult(resolved, file->contents, file->length, nullptr);
+}
+
+} // end namespace glslang
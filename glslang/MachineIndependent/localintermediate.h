@@ -234,7 +234,13 @@ public:
         hlslIoMapping(false),
         textureSamplerTransformMode(EShTexSampTransKeep),
         needToLegalize(false),
-        binaryDoubleOutput(false)
+        binaryDoubleOutput(false),
+        macroQueries(nullptr),
+        phaseTimes(nullptr),
+        compileStats(nullptr),
+        cancellation(nullptr),
+        cancelled(false),
+        builtInTables(nullptr)
     {
         localSize[0] = 1;
         localSize[1] = 1;
@@ -622,8 +628,9 @@ public:
 
     void setSourceFile(const char* file) { if (file != nullptr) sourceFile = file; }
     const std::string& getSourceFile() const { return sourceFile; }
-    void addSourceText(const char* text) { sourceText = sourceText + text; }
-    const std::string& getSourceText() const { return sourceText; }
+    // Not copied; the text must outlive any use of getSourceText(), e.g., by GlslangToSpv().
+    void addSourceText(const char* text, size_t len) { sourceText.push_back(std::make_pair(text, len)); }
+    const std::vector<std::pair<const char*, size_t>>& getSourceText() const { return sourceText; }
     void addProcesses(const std::vector<std::string>& p) {
         for (int i = 0; i < (int)p.size(); ++i)
             processes.addProcess(p[i]);
@@ -632,6 +639,25 @@ public:
     void addProcessArgument(const std::string& arg) { processes.addArgument(arg); }
     const std::vector<std::string>& getProcesses() const { return processes.getProcesses(); }
 
+    // Where the preprocessor should record the macro names it consults, if anywhere;
+    // see TMacroDedupVariants.
+    void setMacroQueries(std::set<std::string>* queries) { macroQueries = queries; }
+    std::set<std::string>* getMacroQueries() const { return macroQueries; }
+
+    // Where to add the time spent on built-in symbol tables, if anywhere.
+    void setPhaseTimes(TPhaseTimes* times) { phaseTimes = times; }
+    TPhaseTimes* getPhaseTimes() const { return phaseTimes; }
+    void setCompileStats(TCompileStats* stats) { compileStats = stats; }
+    TCompileStats* getCompileStats() const { return compileStats; }
+
+    // What can stop the preprocessor early, if anything.
+    void setCancellation(TCancellation* c) { cancellation = c; }
+    TCancellation* getCancellation() const { return cancellation; }
+    void setCancelled() { cancelled = true; }
+    bool wasCancelled() const { return cancelled; }
+    void setBuiltInTables(TBuiltInTables* t) { builtInTables = t; }
+    TBuiltInTables* getBuiltInTables() const { return builtInTables; }
+
     void setNeedsLegalization() { needToLegalize = true; }
     bool needsLegalization() const { return needToLegalize; }
 
@@ -740,7 +766,7 @@ protected:
 
     // source code of shader, useful as part of debug information
     std::string sourceFile;
-    std::string sourceText;
+    std::vector<std::pair<const char*, size_t>> sourceText;  // the shader's strings, in order
 
     // for OpModuleProcessed, or equivalent
     TProcesses processes;
@@ -748,6 +774,13 @@ protected:
     bool needToLegalize;
     bool binaryDoubleOutput;
 
+    std::set<std::string>* macroQueries;    // not owned
+    TPhaseTimes* phaseTimes;                // not owned
+    TCompileStats* compileStats;            // not owned
+    TCancellation* cancellation;            // not owned
+    bool cancelled;                         // the preprocessor was stopped by 'cancellation'
+    TBuiltInTables* builtInTables;          // not owned; the process-wide ones if null
+
 private:
     void operator=(TIntermediate&); // prevent assignments
 };
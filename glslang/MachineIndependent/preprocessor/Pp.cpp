@@ -642,6 +642,7 @@ int TPpContext::CPPinclude(TPpToken* ppToken)
 
     // Process the results
     if (res != nullptr && !res->headerName.empty()) {
+        GLSLANG_COUNT(stats, includes, 1);
         if (res->headerData != nullptr && res->headerLength > 0) {
             // path for processing one or more tokens from an included header, hand off 'res'
             const bool forNextLine = parseContext.lineDirectiveShouldSetNextLine();
@@ -1149,6 +1150,7 @@ MacroExpandResult TPpContext::MacroExpand(TPpToken* ppToken, bool expandUndef, b
         ppToken->ival = parseContext.getCurrentLoc().line;
         snprintf(ppToken->name, sizeof(ppToken->name), "%d", ppToken->ival);
         UngetToken(PpAtomConstInt, ppToken);
+        GLSLANG_COUNT(stats, macroExpansions, 1);
         return MacroExpandStarted;
 
     case PpAtomFileMacro: {
@@ -1157,6 +1159,7 @@ MacroExpandResult TPpContext::MacroExpand(TPpToken* ppToken, bool expandUndef, b
         ppToken->ival = parseContext.getCurrentLoc().string;
         snprintf(ppToken->name, sizeof(ppToken->name), "%s", ppToken->loc.getStringNameOrNum().c_str());
         UngetToken(PpAtomConstInt, ppToken);
+        GLSLANG_COUNT(stats, macroExpansions, 1);
         return MacroExpandStarted;
     }
 
@@ -1164,6 +1167,7 @@ MacroExpandResult TPpContext::MacroExpand(TPpToken* ppToken, bool expandUndef, b
         ppToken->ival = parseContext.version;
         snprintf(ppToken->name, sizeof(ppToken->name), "%d", ppToken->ival);
         UngetToken(PpAtomConstInt, ppToken);
+        GLSLANG_COUNT(stats, macroExpansions, 1);
         return MacroExpandStarted;
 
     default:
@@ -1287,6 +1291,7 @@ MacroExpandResult TPpContext::MacroExpand(TPpToken* ppToken, bool expandUndef, b
     pushInput(in);
     macro->busy = 1;
     macro->body.reset();
+    GLSLANG_COUNT(stats, macroExpansions, 1);
 
     return MacroExpandStarted;
 }
@@ -84,7 +84,7 @@ NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 namespace glslang {
 
 TPpContext::TPpContext(TParseContextBase& pc, const std::string& rootFileName, TShader::Includer& inclr) :
-    preamble(0), strings(0), previous_token('\n'), parseContext(pc), includer(inclr), inComment(false),
+    macroQueries(nullptr), cancellation(nullptr), cancelReported(false), stats(nullptr), preamble(0), strings(0), previous_token('\n'), parseContext(pc), includer(inclr), inComment(false),
     rootFileName(rootFileName),
     currentSourceFile(rootFileName)
 {
@@ -115,4 +115,19 @@ void TPpContext::setInput(TInputScanner& input, bool versionWillBeError)
     versionSeen = false;
 }
 
+//
+// Preprocessing is a function of the source and of the answers to macro-table
+// lookups, so recording the names looked up says which macros a compile
+// depends on.  Lookups made while defining the preambles' own macros are left
+// out, unless they find an existing definition, so that a macro set through
+// the preamble only counts if the shader itself looks at it.
+//
+void TPpContext::recordMacroQuery(int atom, const MacroSymbol* macro)
+{
+    if (macro == nullptr && parseContext.getCurrentLoc().string < 0)
+        return;
+
+    macroQueries->insert(atomStrings.getString(atom));
+}
+
 } // end namespace glslang
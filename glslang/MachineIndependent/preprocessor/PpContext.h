@@ -78,7 +78,9 @@ NVIDIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef PPCONTEXT_H
 #define PPCONTEXT_H
 
+#include <set>
 #include <stack>
+#include <string>
 #include <unordered_map>
 #include <sstream>
 
@@ -280,15 +282,30 @@ public:
     MacroSymbol* lookupMacroDef(int atom)
     {
         auto existingMacroIt = macroDefs.find(atom);
-        return (existingMacroIt == macroDefs.end()) ? nullptr : &(existingMacroIt->second);
+        MacroSymbol* macro = (existingMacroIt == macroDefs.end()) ? nullptr : &(existingMacroIt->second);
+        if (macroQueries != nullptr)
+            recordMacroQuery(atom, macro);
+        return macro;
     }
     void addMacroDef(int atom, MacroSymbol& macroDef) { macroDefs[atom] = macroDef; }
 
+    // Record the name of every macro looked up into 'queries'; see recordMacroQuery().
+    void setMacroQueries(std::set<std::string>* queries) { macroQueries = queries; }
+    // Stop producing tokens once 'c' says to.
+    void setCancellation(TCancellation* c) { cancellation = c; }
+    void setCompileStats(TCompileStats* s) { stats = s; }
+
 protected:
     TPpContext(TPpContext&);
     TPpContext& operator=(TPpContext&);
 
+    void recordMacroQuery(int atom, const MacroSymbol*);
+
     TStringAtomMap atomStrings;
+    std::set<std::string>* macroQueries;
+    TCancellation* cancellation;
+    bool cancelReported;
+    TCompileStats* stats;
     char*   preamble;               // string to parse, all before line 1 of string 0, it is 0 if no preamble
     int     preambleLength;
     char**  strings;                // official strings of shader, starting a string 0 line 1
@@ -1033,6 +1033,16 @@ int TPpContext::tStringInput::scan(TPpToken* ppToken)
 int TPpContext::tokenize(TPpToken& ppToken)
 {
     for(;;) {
+        if (cancellation != nullptr && cancellation->stopRequested()) {
+            if (! cancelReported) {
+                parseContext.ppError(parseContext.getCurrentLoc(), cancellation->isExpired() ?
+                                     "time budget exceeded" : "compilation cancelled", "", "");
+                parseContext.intermediate.setCancelled();
+                cancelReported = true;
+            }
+            return EndOfInput;
+        }
+
         int token = scanToken(&ppToken);
 
         // Handle token-pasting logic
@@ -1102,6 +1112,7 @@ int TPpContext::tokenize(TPpToken& ppToken)
             break;
         }
 
+        GLSLANG_COUNT(stats, ppTokens, 1);
         return token;
     }
 }
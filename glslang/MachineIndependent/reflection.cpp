@@ -308,7 +308,10 @@ public:
                 TType derefType(base->getType(), 0);
 
                 assert(! anonymous);
-                for (int e = 0; e < base->getType().getCumulativeArraySize(); ++e)
+                // a run-time sized array of blocks has no fixed instances to name
+                const int instances = base->getType().getArraySizes()->hasUnsized() ?
+                                      0 : base->getType().getCumulativeArraySize();
+                for (int e = 0; e < instances; ++e)
                     blockIndex = addBlockName(blockName + "[" + String(e) + "]", derefType,
                                               getBlockSize(base->getType()));
             } else
@@ -818,29 +821,40 @@ bool TReflection::addStage(EShLanguage stage, const TIntermediate& intermediate)
 
 void TReflection::dump()
 {
-    printf("Uniform reflection:\n");
+    std::string text;
+    dump(text);
+    fputs(text.c_str(), stdout);
+}
+
+// Same as dump(), but appending to 'text' rather than printing.
+void TReflection::dump(std::string& text)
+{
+    text.append("Uniform reflection:\n");
     for (size_t i = 0; i < indexToUniform.size(); ++i)
-        indexToUniform[i].dump();
-    printf("\n");
+        indexToUniform[i].dump(text);
+    text.append("\n");
 
-    printf("Uniform block reflection:\n");
+    text.append("Uniform block reflection:\n");
     for (size_t i = 0; i < indexToUniformBlock.size(); ++i)
-        indexToUniformBlock[i].dump();
-    printf("\n");
+        indexToUniformBlock[i].dump(text);
+    text.append("\n");
 
-    printf("Vertex attribute reflection:\n");
+    text.append("Vertex attribute reflection:\n");
     for (size_t i = 0; i < indexToAttribute.size(); ++i)
-        indexToAttribute[i].dump();
-    printf("\n");
+        indexToAttribute[i].dump(text);
+    text.append("\n");
 
     if (getLocalSize(0) > 1) {
         static const char* axis[] = { "X", "Y", "Z" };
 
         for (int dim=0; dim<3; ++dim)
-            if (getLocalSize(dim) > 1)
-                printf("Local size %s: %d\n", axis[dim], getLocalSize(dim));
+            if (getLocalSize(dim) > 1) {
+                char line[40];
+                snprintf(line, sizeof(line), "Local size %s: %d\n", axis[dim], getLocalSize(dim));
+                text.append(line);
+            }
 
-        printf("\n");
+        text.append("\n");
     }
 
     // printf("Live names\n");
@@ -66,15 +66,20 @@ public:
             return -1;
         return type->getQualifier().layoutBinding;
     }
-    void dump() const
+    void dump(std::string& text) const
     {
-        printf("%s: offset %d, type %x, size %d, index %d, binding %d, stages %d",
-               name.c_str(), offset, glDefineType, size, index, getBinding(), stages );
-
-        if (counterIndex != -1)
-            printf(", counter %d", counterIndex);
-
-        printf("\n");
+        char numbers[160];
+        snprintf(numbers, sizeof(numbers), ": offset %d, type %x, size %d, index %d, binding %d, stages %d",
+                 offset, glDefineType, size, index, getBinding(), stages);
+        text.append(name.c_str());
+        text.append(numbers);
+
+        if (counterIndex != -1) {
+            snprintf(numbers, sizeof(numbers), ", counter %d", counterIndex);
+            text.append(numbers);
+        }
+
+        text.append("\n");
     }
     static TObjectReflection badReflection() { return TObjectReflection(); }
 
@@ -153,6 +158,7 @@ public:
     unsigned getLocalSize(int dim) const { return dim <= 2 ? localSize[dim] : 0; }
 
     void dump();
+    void dump(std::string& text);
 
 protected:
     friend class glslang::TReflectionTraverser;
@@ -46,6 +46,10 @@
 #include <cstdio>
 #include <sys/time.h>
 #include <sys/resource.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace glslang {
 
@@ -182,11 +186,39 @@ void GetGlobalLock()
   pthread_mutex_lock(&gMutex);
 }
 
+bool TryGetGlobalLock()
+{
+  return pthread_mutex_trylock(&gMutex) == 0;
+}
+
 void ReleaseGlobalLock()
 {
   pthread_mutex_unlock(&gMutex);
 }
 
+const char* OS_MapFile(const char* fileName, size_t& size)
+{
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+
+    // The mapping stays valid after the descriptor is closed.
+    void* data = MAP_FAILED;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        size = (size_t)info.st_size;
+        data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+
+    return data != MAP_FAILED ? static_cast<const char*>(data) : nullptr;
+}
+
+void OS_UnmapFile(const char* data, size_t size)
+{
+    munmap(const_cast<char*>(data), size);
+}
+
 // #define DUMP_COUNTERS
 
 void OS_DumpMemoryCounters()
@@ -121,6 +121,11 @@ void GetGlobalLock()
     WaitForSingleObject(GlobalLock, INFINITE);
 }
 
+bool TryGetGlobalLock()
+{
+    return WaitForSingleObject(GlobalLock, 0) == WAIT_OBJECT_0;
+}
+
 void ReleaseGlobalLock()
 {
     ReleaseMutex(GlobalLock);
@@ -131,6 +136,34 @@ unsigned int __stdcall EnterGenericThread (void* entry)
     return ((TThreadEntrypoint)entry)(0);
 }
 
+const char* OS_MapFile(const char* fileName, size_t& size)
+{
+    HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    // The view stays valid after the file and mapping handles are closed.
+    const void* data = nullptr;
+    LARGE_INTEGER fileSize;
+    if (GetFileType(file) == FILE_TYPE_DISK && GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping != nullptr) {
+            size = (size_t)fileSize.QuadPart;
+            data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+
+    return static_cast<const char*>(data);
+}
+
+void OS_UnmapFile(const char* data, size_t /*size*/)
+{
+    UnmapViewOfFile(data);
+}
+
 //#define DUMP_COUNTERS
 
 void OS_DumpMemoryCounters()
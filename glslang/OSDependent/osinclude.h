@@ -35,6 +35,8 @@
 #ifndef __OSINCLUDE_H
 #define __OSINCLUDE_H
 
+#include <cstddef>
+
 namespace glslang {
 
 //
@@ -50,6 +52,7 @@ void*       OS_GetTLSValue(OS_TLSIndex nIndex);
 
 void InitGlobalLock();
 void GetGlobalLock();
+bool TryGetGlobalLock();  // false, without waiting, if another thread holds it
 void ReleaseGlobalLock();
 
 typedef unsigned int (*TThreadEntrypoint)(void*);
@@ -58,6 +61,14 @@ void OS_CleanupThreadData(void);
 
 void OS_DumpMemoryCounters();
 
+//
+// Read-only memory mapping of a whole file.  Returns nullptr if the file can't
+// be mapped (e.g., it is missing, empty, or not a regular file), in which case
+// it has to be read instead.
+//
+const char* OS_MapFile(const char* fileName, size_t& size);
+void        OS_UnmapFile(const char* data, size_t size);
+
 } // end namespace glslang
 
 #endif // __OSINCLUDE_H
@@ -213,7 +213,7 @@ enum EShMessages {
     EShMsgCascadingErrors  = (1 << 7),  // get cascading errors; risks error-recovery issues, instead of an early exit
     EShMsgKeepUncalled     = (1 << 8),  // for testing, don't eliminate uncalled functions
     EShMsgHlslOffsets      = (1 << 9),  // allow block offsets to follow HLSL rules instead of GLSL rules
-    EShMsgDebugInfo        = (1 << 10), // save debug information
+    EShMsgDebugInfo        = (1 << 10), // save debug information; the source strings must then outlive GlslangToSpv()
     EShMsgHlslEnable16BitTypes  = (1 << 11), // enable use of 16-bit types in SPIR-V for HLSL
     EShMsgHlslLegalization  = (1 << 12), // enable HLSL Legalization messages
 };
@@ -322,7 +322,14 @@ SH_IMPORT_EXPORT int ShGetUniformLocation(const ShHandle uniformMap, const char*
 // (treeRoot in TIntermediate) level, and then a full stage can be lowered.
 //
 
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <string>
 #include <utility>
 
@@ -338,6 +345,9 @@ int GetKhronosToolId();
 class TIntermediate;
 class TProgram;
 class TPoolAllocator;
+class TPoolPageCache;
+class TBuiltInTables;
+class TCompilerContext;
 
 // Call this exactly once per process before using anything else
 bool InitializeProcess();
@@ -356,6 +366,199 @@ enum TResourceType {
     EResCount
 };
 
+// Wall-clock seconds spent in each phase of compilation, summed over calls.
+// TShader fills in the front-end phases, TProgram the linking ones, and
+// GlslangToSpv() the SPIR-V ones when given one through SpvOptions; 'output'
+// is left for the caller's own writing of results.
+struct TPhaseTimes {
+    TPhaseTimes() : builtIns(0), preprocess(0), parse(0), link(0), ioMap(0), reflection(0),
+                    spirv(0), optimize(0), output(0) { }
+
+    void add(const TPhaseTimes& other)
+    {
+        builtIns += other.builtIns;
+        preprocess += other.preprocess;
+        parse += other.parse;
+        link += other.link;
+        ioMap += other.ioMap;
+        reflection += other.reflection;
+        spirv += other.spirv;
+        optimize += other.optimize;
+        output += other.output;
+    }
+    double total() const
+    {
+        return builtIns + preprocess + parse + link + ioMap + reflection + spirv + optimize + output;
+    }
+
+    double builtIns;    // setting up built-in symbol tables, for parse() or preprocess()
+    double preprocess;  // preprocess(); parse() preprocesses as it goes, counted under 'parse'
+    double parse;       // parse(), less 'builtIns'
+    double link;        // TProgram::link()
+    double ioMap;       // TProgram::mapIO()
+    double reflection;  // TProgram::buildReflection()
+    double spirv;       // GlslangToSpv(), less 'optimize'
+    double optimize;    // SPIRV-Tools legalization/optimization within GlslangToSpv()
+    double output;      // writing results, timed by the caller
+};
+
+// Counts of the work done compiling, summed over calls, to find what makes a
+// shader expensive.  TShader fills in the front-end counts, TProgram::link()
+// sums those of its shaders, and GlslangToSpv() fills in the SPIR-V counts when
+// given one through SpvOptions.  Without GLSLANG_COMPILE_STATS (CMake's
+// ENABLE_COMPILE_STATS), nothing is counted, at no cost.
+struct TCompileStats {
+    TCompileStats() : ppTokens(0), macroExpansions(0), includes(0), symbolLookups(0), overloadResolutions(0),
+                      constantFolds(0), symbolNodes(0), constantNodes(0), unaryNodes(0), binaryNodes(0),
+                      aggregateNodes(0), selectionNodes(0), switchNodes(0), loopNodes(0), branchNodes(0),
+                      poolBytes(0), spvInstructions(0), spvIds(0) { }
+
+    void add(const TCompileStats& other)
+    {
+        ppTokens += other.ppTokens;
+        macroExpansions += other.macroExpansions;
+        includes += other.includes;
+        symbolLookups += other.symbolLookups;
+        overloadResolutions += other.overloadResolutions;
+        constantFolds += other.constantFolds;
+        symbolNodes += other.symbolNodes;
+        constantNodes += other.constantNodes;
+        unaryNodes += other.unaryNodes;
+        binaryNodes += other.binaryNodes;
+        aggregateNodes += other.aggregateNodes;
+        selectionNodes += other.selectionNodes;
+        switchNodes += other.switchNodes;
+        loopNodes += other.loopNodes;
+        branchNodes += other.branchNodes;
+        poolBytes += other.poolBytes;
+        spvInstructions += other.spvInstructions;
+        spvIds += other.spvIds;
+    }
+    unsigned int astNodes() const
+    {
+        return symbolNodes + constantNodes + unaryNodes + binaryNodes + aggregateNodes + selectionNodes +
+               switchNodes + loopNodes + branchNodes;
+    }
+
+    // Whether this build counts anything.
+    static bool isGathered();
+
+    unsigned int ppTokens;              // tokens out of the preprocessor
+    unsigned int macroExpansions;
+    unsigned int includes;              // #includes resolved
+    unsigned int symbolLookups;         // symbol table look ups by name
+    unsigned int overloadResolutions;   // function calls resolved to a function
+    unsigned int constantFolds;         // operations folded to a constant
+    unsigned int symbolNodes;           // AST nodes by class, at the end of parse()
+    unsigned int constantNodes;
+    unsigned int unaryNodes;
+    unsigned int binaryNodes;
+    unsigned int aggregateNodes;
+    unsigned int selectionNodes;
+    unsigned int switchNodes;
+    unsigned int loopNodes;
+    unsigned int branchNodes;
+    size_t poolBytes;                   // pool memory in use at the end of parse(), and for TProgram, link()
+    unsigned int spvInstructions;       // in the final module
+    unsigned int spvIds;                // the module's Id bound
+};
+
+// How often one kind of glslang's internal locks was taken, and how often, and
+// for how long, a thread had to wait for it, since the start or the last
+// ResetLockStats().  GetLockStats() gives one for each kind, but only with
+// GLSLANG_LOCK_STATS (CMake's ENABLE_LOCK_STATS); otherwise, none.
+struct TLockStats {
+    const char* name;
+    unsigned long long acquisitions;
+    unsigned long long contentions;     // acquisitions that had to wait
+    double waitSeconds;                 // total time spent waiting
+};
+std::vector<TLockStats> GetLockStats();
+void ResetLockStats();
+
+// Adds the wall-clock time from construction to stop() (or destruction) onto
+// *seconds.  A null 'seconds' makes it a no-op.
+class TPhaseTimer {
+public:
+    explicit TPhaseTimer(double* seconds) : seconds(seconds)
+    {
+        if (seconds != nullptr)
+            start = std::chrono::steady_clock::now();
+    }
+    ~TPhaseTimer() { stop(); }
+
+    // Returns the seconds added.
+    double stop()
+    {
+        if (seconds == nullptr)
+            return 0.0;
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        *seconds += elapsed;
+        seconds = nullptr;
+        return elapsed;
+    }
+
+private:
+    TPhaseTimer(const TPhaseTimer&);
+    TPhaseTimer& operator=(const TPhaseTimer&);
+
+    double* seconds;
+    std::chrono::steady_clock::time_point start;
+};
+
+// Stops compiles early: when cancel() is called from any thread, or once past
+// an optional deadline.  Give it to TShader::setCancellation() and, for SPIR-V,
+// SpvOptions::cancellation; the same one can be shared by a batch of compiles.
+// A stopped parse fails with a "compilation cancelled" or "time budget
+// exceeded" error, and wasCancelled() on the TShader (and a TProgram it is
+// added to) says so; GlslangToSpv() makes no SPIR-V.
+//
+// It is checked for each preprocessor token and at each function GlslangToSpv()
+// generates.  Set any deadline before starting the compiles.
+//
+class TCancellation {
+public:
+    TCancellation() : stopped(false), expired(false), hasDeadline(false), polls(0) { }
+
+    void cancel() { stopped = true; }
+    void setDeadline(std::chrono::steady_clock::time_point time)
+    {
+        deadline = time;
+        hasDeadline = true;
+    }
+    void setTimeBudget(std::chrono::steady_clock::duration budget)
+    {
+        setDeadline(std::chrono::steady_clock::now() + budget);
+    }
+
+    // For the compiler to poll.  Only reads the clock every 64th call.
+    bool stopRequested()
+    {
+        if (stopped.load(std::memory_order_relaxed))
+            return true;
+        if (hasDeadline && (polls.fetch_add(1, std::memory_order_relaxed) & 63) == 0 &&
+            std::chrono::steady_clock::now() >= deadline) {
+            expired = true;
+            stopped = true;
+        }
+        return stopped.load(std::memory_order_relaxed);
+    }
+
+    // Whether compiles were stopped, and if so, whether by the deadline.
+    bool isStopped() const { return stopped; }
+    bool isExpired() const { return expired; }
+
+private:
+    TCancellation(const TCancellation&);
+    TCancellation& operator=(const TCancellation&);
+
+    std::atomic<bool> stopped;
+    std::atomic<bool> expired;
+    bool hasDeadline;
+    std::chrono::steady_clock::time_point deadline;
+    std::atomic<unsigned int> polls;
+};
+
 // Make one TShader per shader that you will link into a program. Then
 //  - provide the shader through setStrings() or setStringsWithLengths()
 //  - optionally call setEnv*(), see below for more detail
@@ -383,6 +586,10 @@ public:
     void setEntryPoint(const char* entryPoint);
     void setSourceEntryPoint(const char* sourceEntryPointName);
     void addProcesses(const std::vector<std::string>&);
+    // Optional; see TCancellation.  Must outlive parse().
+    void setCancellation(TCancellation*);
+    // Optional; see TCompilerContext.  Call before parse(), at most once.
+    void setCompilerContext(TCompilerContext*);
 
     // IO resolver binding data: see comments in ShaderLang.cpp
     void setShiftBinding(TResourceType res, unsigned int base);
@@ -541,6 +748,17 @@ public:
     const char* getInfoDebugLog();
     EShLanguage getStage() const { return stage; }
     TIntermediate* getIntermediate() const { return intermediate; }
+    const TPhaseTimes& getPhaseTimes() const { return phaseTimes; }
+    const TCompileStats& getCompileStats() const { return compileStats; }
+    // Whether the last parse() or preprocess() was stopped by its TCancellation.
+    bool wasCancelled() const { return cancelled; }
+
+    // Frees the AST, with the pool memory holding it, once nothing more is
+    // wanted from it (e.g., after GlslangToSpv()).  The info logs, phase times,
+    // and statistics stay.  After this, getIntermediate() returns nullptr, and
+    // the shader can't be parsed or linked again.  For a shader added to a
+    // TProgram, use TProgram::releaseIntermediates() instead.
+    void releaseIntermediate();
 
 protected:
     TPoolAllocator* pool;
@@ -557,6 +775,8 @@ protected:
     // stringNames is the optional names for all the strings. If stringNames
     // is null, then none of the strings has name. If a certain element in
     // stringNames is null, then the corresponding string does not have name.
+    // With EShMsgDebugInfo, the intermediate refers to (doesn't copy) the
+    // strings' text, so it must stay valid until the SPIR-V is generated.
     const char* const* strings;
     const int* lengths;
     const char* const* stringNames;
@@ -568,12 +788,248 @@ protected:
 
     TEnvironment environment;
 
+    TPhaseTimes phaseTimes;
+    TCompileStats compileStats;
+    TCompilerContext* compilerContext;
+    bool cancelled;
+
     friend class TProgram;
+    friend class TMacroDedupVariants;
 
 private:
     TShader& operator=(TShader&);
 };
 
+// Owns caches that compiles can share: the built-in symbol tables, #include
+// contents (through CachingIncluder), and pool allocator pages.  Attach each
+// TShader and TProgram through its setCompilerContext(); those not attached use
+// process-wide built-in tables and no other caching.  Any number of contexts can
+// coexist, each kept within its own TLimits, and each can be used by several
+// threads at once.
+//
+// N.B.: Destruct everything attached to a context *before* destructing it.
+//
+class TCompilerContext {
+public:
+    struct TLimits {
+        TLimits() : builtInBytes(32 << 20), includeBytes(16 << 20), pageCacheBytes(4 << 20) { }
+
+        // Past this, the least recently used built-in table sets are dropped, one
+        // at a time, whenever no shader is attached.  The limit is soft: while
+        // shaders are attached, the sets their compiles need are added regardless,
+        // and the most recently used set is always kept.
+        size_t builtInBytes;
+        size_t includeBytes;    // past this, least recently used includes are dropped
+        size_t pageCacheBytes;  // free pool pages kept for reuse
+    };
+
+    struct TStats {
+        size_t builtInBytes;
+        unsigned int builtInTableSets;  // version/profile/... combinations held
+        unsigned int builtInTrims;      // table sets dropped
+        size_t includeBytes;
+        unsigned int includeEntries;
+        unsigned int includeHits;
+        unsigned int includeMisses;
+        size_t pageCacheBytes;
+        unsigned int pageCacheHits;
+        unsigned int pageCacheMisses;
+        int attachedShaders;
+    };
+
+    // Resolves includes through another Includer, the first time each is asked
+    // for, and from the context's cache after that.  Only successful includes
+    // are cached; the cache is keyed by the include's name, its includer's name,
+    // and whether it is "local", so the wrapped Includer's answers should depend
+    // only on those.
+    class CachingIncluder : public TShader::Includer {
+    public:
+        CachingIncluder(TCompilerContext& context, TShader::Includer& includer) : context(context), includer(includer) { }
+
+        virtual IncludeResult* includeSystem(const char* headerName, const char* includerName, size_t inclusionDepth) override;
+        virtual IncludeResult* includeLocal(const char* headerName, const char* includerName, size_t inclusionDepth) override;
+        virtual void releaseInclude(IncludeResult*) override;
+
+    protected:
+        IncludeResult* include(bool local, const char* headerName, const char* includerName, size_t inclusionDepth);
+
+        TCompilerContext& context;
+        TShader::Includer& includer;
+
+    private:
+        CachingIncluder& operator=(const CachingIncluder&);
+    };
+
+    TCompilerContext();
+    explicit TCompilerContext(const TLimits&);
+    virtual ~TCompilerContext();
+
+    void setLimits(const TLimits&);
+    TLimits getLimits();
+    TStats getStats();
+
+    // Drops the cached includes and pages, and the built-ins if no shader is attached.
+    void trim();
+
+protected:
+    struct TInclude {
+        std::string name;                             // resolved name
+        std::shared_ptr<const std::string> contents;
+        std::list<std::string>::iterator lru;         // position of the key in 'includeLru'
+    };
+
+    std::shared_ptr<const std::string> findInclude(const std::string& key, std::string& name);
+    void addInclude(const std::string& key, const std::string& name, std::shared_ptr<const std::string> contents);
+    void trimIncludes(size_t maxBytes);
+    void trimBuiltIns();
+    void attach();
+    void detach();
+
+    std::mutex mutex;   // guards everything below but the built-ins and pages, which have their own
+    TLimits limits;
+    TBuiltInTables* builtIns;
+    TPoolPageCache* pageCache;
+    std::map<std::string, TInclude> includes;
+    std::list<std::string> includeLru;  // most recently used first
+    size_t includeBytes;
+    unsigned int includeHits;
+    unsigned int includeMisses;
+    int attachedShaders;
+
+    friend class TShader;
+    friend class TProgram;
+
+private:
+    TCompilerContext(const TCompilerContext&);
+    TCompilerContext& operator=(const TCompilerContext&);
+};
+
+// Resolves includes from a virtual file system: files given from memory
+// through addFile() (say, out of a packed archive), then files under any
+// directory roots given through addRoot(), which are read once and kept.
+// Paths are '/'-separated and relative to the file system; backslashes are
+// taken as '/', and "." and ".." are resolved.  A path that is absolute, or
+// climbs above the top of the file system, is never found.
+//
+// As with C compilers, a "local" include is looked for relative to the
+// directory of its includer, then in the search directories; a <system> one
+// only in the search directories, most recently added first.  ("" or "." for
+// a search directory is the top of the file system.)
+//
+// Resolved names and contents are cached.  Results point straight at the
+// stored contents, without copying them.  All members can be called from
+// several threads at once, so many compiles can share one of these, though
+// an include being resolved while a file or directory is added may not see it.
+//
+class TVirtualFileIncluder : public TShader::Includer {
+public:
+    TVirtualFileIncluder() { }
+    virtual ~TVirtualFileIncluder() { }
+
+    // Adds a file whose contents are not copied, and so have to outlive this.
+    // Returns false if 'path' is already a file.
+    bool addFile(const std::string& path, const char* contents, size_t length);
+    // Adds a file, keeping a copy of its contents.
+    bool addFile(const std::string& path, const std::string& contents);
+    void addRoot(const std::string& directory);
+    void addSearchDirectory(const std::string& directory);
+
+    virtual IncludeResult* includeSystem(const char* headerName, const char* includerName, size_t inclusionDepth) override;
+    virtual IncludeResult* includeLocal(const char* headerName, const char* includerName, size_t inclusionDepth) override;
+    virtual void releaseInclude(IncludeResult*) override;
+
+    static std::string normalize(const std::string& path);
+
+protected:
+    struct TFile {
+        TFile() : contents(nullptr), length(0) { }
+
+        const char* contents;                 // nullptr if it doesn't exist
+        size_t length;
+        std::shared_ptr<const std::string> copy;  // owning 'contents', if added or read as a copy
+    };
+
+    const TFile* find(const std::string& path);
+    IncludeResult* include(bool local, const char* headerName, const char* includerName);
+
+    std::mutex mutex;
+    std::map<std::string, TFile> files;           // including those found missing under the roots
+    std::map<std::string, std::string> lookups;   // resolved name of each include seen, or "" if none
+    std::vector<std::string> roots;
+    std::vector<std::string> searchDirectories;
+
+private:
+    TVirtualFileIncluder(const TVirtualFileIncluder&);
+    TVirtualFileIncluder& operator=(const TVirtualFileIncluder&);
+};
+
+// Compiles one shader under several sets of macro definitions ("variants"),
+// as with -D on the command line.  Then
+//  - each variant is a TShader made and set up by the 'setup' callback (strings,
+//    environment, entry point, preamble, ...), with the variant's macros
+//    #defined after its preamble
+//  - parse() parses the variants in order, but a variant whose macros agree
+//    with an already-parsed variant on every macro that variant's preprocessing
+//    looked at preprocesses to exactly the same tokens, so it shares that
+//    variant's TShader instead of being parsed again (deduplication by macro
+//    use; variants that do differ are each preprocessed and parsed in full)
+//  - a variant whose own #defines give any message (a bad name, a
+//    redefinition) is always parsed by itself
+//  - results are identical to compiling each variant separately; link each
+//    getShader() (the same TShader may back several variants) as usual
+//
+class TMacroDedupVariants {
+public:
+    typedef std::function<void(TShader&)> TSetup;
+
+    TMacroDedupVariants(EShLanguage, const TSetup&);
+    virtual ~TMacroDedupVariants();
+
+    // Add a variant, with macros given as "NAME" or "NAME=value"; returns its index.
+    int addVariant(const std::vector<std::string>& defines);
+
+    // Parse all the variants; returns false if any failed.
+    bool parse(const TBuiltInResource*, int defaultVersion, bool forwardCompatible, EShMessages,
+               TShader::Includer&);
+    bool parse(const TBuiltInResource* builtInResources, int defaultVersion, bool forwardCompatible,
+               EShMessages messages)
+    {
+        TShader::ForbidIncluder includer;
+        return parse(builtInResources, defaultVersion, forwardCompatible, messages, includer);
+    }
+
+    int getNumVariants() const { return (int)variants.size(); }
+    TShader* getShader(int variant) const;
+    // Which variant's parse 'variant' is using; itself if it was parsed.
+    int getParsedVariant(int variant) const { return variants[variant].parsed; }
+    // How many parses were actually done.
+    int getNumParses() const { return numParses; }
+
+protected:
+    struct TVariant {
+        TVariant() : parsed(-1), parsedOk(false) { }
+        std::vector<std::pair<std::string, std::string> > defines;  // name, body
+        std::string preamble;
+        std::unique_ptr<TShader> shader;     // only for parsed variants
+        std::set<std::string> macroQueries;  // names preprocessing looked up
+        int parsed;                          // index of the variant whose parse this uses
+        bool parsedOk;
+    };
+
+    bool sameAsParsed(const TVariant&, const TVariant& parsed) const;
+    bool macrosAreClean(const TVariant&, const TVariant& parsed, const TBuiltInResource*, bool forwardCompatible,
+                        EShMessages) const;
+
+    EShLanguage stage;
+    TSetup setup;
+    std::vector<TVariant> variants;
+    int numParses;
+
+private:
+    TMacroDedupVariants(const TMacroDedupVariants&);
+    TMacroDedupVariants& operator=(const TMacroDedupVariants&);
+};
+
 class TReflection;
 class TIoMapper;
 
@@ -661,6 +1117,21 @@ public:
     const char* getInfoDebugLog();
 
     TIntermediate* getIntermediate(EShLanguage stage) const { return intermediate[stage]; }
+    const TPhaseTimes& getPhaseTimes() const { return phaseTimes; }
+    const TCompileStats& getCompileStats() const { return compileStats; }
+    // Whether the parse of an added shader was stopped by its TCancellation,
+    // so the program can't link.
+    bool wasCancelled() const;
+
+    // Optional; see TCompilerContext.  Call before link().
+    void setCompilerContext(TCompilerContext*);
+
+    // Frees the linked intermediate of each stage, and releases those of the
+    // added shaders (see TShader::releaseIntermediate()), once the SPIR-V is
+    // generated.  The info logs, reflection, phase times, and statistics stay,
+    // but getIntermediate() returns nullptr.  Call buildReflection() first, if
+    // wanted.  N.B.: Releases shaders also added to other programs.
+    void releaseIntermediates();
 
     // Reflection Interface
     bool buildReflection();                          // call first, to do liveness analysis, index mapping, etc.; returns false on failure
@@ -687,6 +1158,7 @@ public:
     const TType* getAttributeTType(int index) const;       // returns a TType*
 
     void dumpReflection();
+    void dumpReflection(std::string& text);          // appends to 'text' instead of printing
 
     // I/O mapping: apply base offsets and map live unbound variables
     // If resolver is not provided it uses the previous approach
@@ -704,6 +1176,8 @@ protected:
     TReflection* reflection;
     TIoMapper* ioMapper;
     bool linked;
+    TPhaseTimes phaseTimes;
+    TCompileStats compileStats;
 
 private:
     TProgram(TProgram&);
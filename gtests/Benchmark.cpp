@@ -0,0 +1,487 @@
+//
+// Copyright (C) 2018 LunarG, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+//    Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//    Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//    Neither the name of 3Dlabs Inc. Ltd. nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+//
+// Microbenchmarks of each phase of compiling, over the shaders in Test/.
+//
+// Each GLSL shader there that compiles for Vulkan, on its own and without
+// includes, is taken through preprocess, parse, link, I/O mapping, reflection,
+// GlslangToSpv, remapping, and disassembly, each phase timed separately.  For
+// each phase, the fastest of the iterations over the whole corpus is reported
+// as bytes/s (of source, or of SPIR-V for remapping and disassembly) and
+// shaders/s, as a table and, with --json, as JSON for tracking regressions.
+//
+// With --threads <n>, it instead measures how compiling scales across cores:
+// the corpus is compiled (parse, link, I/O mapping, and GlslangToSpv, with a
+// TShader and TProgram for each shader) on 1, 2, 4, ... <n> threads, for the
+// throughput and speedup at each thread count.  When built with
+// ENABLE_LOCK_STATS, each count also reports the waits on glslang's locks.
+// With --context, all the compiles share one TCompilerContext.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <dirent.h>
+#endif
+
+#include "glslang/Public/ShaderLang.h"
+#include "SPIRV/GlslangToSpv.h"
+#include "SPIRV/SPVRemapper.h"
+#include "SPIRV/disassemble.h"
+#include "StandAlone/ResourceLimits.h"
+
+namespace {
+
+enum EPhase {
+    PhasePreprocess,
+    PhaseParse,
+    PhaseLink,
+    PhaseIoMap,
+    PhaseReflection,
+    PhaseSpirv,
+    PhaseRemap,
+    PhaseDisassemble,
+    PhaseCount
+};
+
+const char* const PhaseNames[PhaseCount] = {
+    "preprocess", "parse", "link", "iomap", "reflection", "spirv", "remap", "disassemble"
+};
+
+struct TShaderFile {
+    std::string name;
+    EShLanguage stage;
+    std::string text;
+    size_t spirvBytes;
+};
+
+const EShMessages Messages = (EShMessages)(EShMsgSpvRules | EShMsgVulkanRules);
+
+bool RemapFailed = false;
+
+// The files directly in 'directory', sorted by name.
+std::vector<std::string> ListFiles(const std::string& directory)
+{
+    std::vector<std::string> names;
+#ifdef _WIN32
+    WIN32_FIND_DATAA data;
+    HANDLE find = FindFirstFileA((directory + "/*").c_str(), &data);
+    if (find != INVALID_HANDLE_VALUE) {
+        do {
+            if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+                names.push_back(data.cFileName);
+        } while (FindNextFileA(find, &data));
+        FindClose(find);
+    }
+#else
+    DIR* dir = opendir(directory.c_str());
+    if (dir != nullptr) {
+        while (const dirent* entry = readdir(dir)) {
+            if (entry->d_name[0] != '.')
+                names.push_back(entry->d_name);
+        }
+        closedir(dir);
+    }
+#endif
+    std::sort(names.begin(), names.end());
+
+    return names;
+}
+
+// The stage named by a file's suffix, or EShLangCount for one that isn't a shader.
+EShLanguage FindStage(const std::string& name)
+{
+    static const char* const suffixes[] = { "vert", "tesc", "tese", "geom", "frag", "comp" };
+    static const EShLanguage stages[] = { EShLangVertex, EShLangTessControl, EShLangTessEvaluation,
+                                          EShLangGeometry, EShLangFragment, EShLangCompute };
+
+    const size_t dot = name.rfind('.');
+    if (dot == std::string::npos)
+        return EShLangCount;
+    for (int s = 0; s < (int)(sizeof(suffixes) / sizeof(suffixes[0])); ++s) {
+        if (name.compare(dot + 1, std::string::npos, suffixes[s]) == 0)
+            return stages[s];
+    }
+
+    return EShLangCount;
+}
+
+void SetUpShader(glslang::TShader& shader, const TShaderFile& file, const char*& text, int& length, const char*& name)
+{
+    text = file.text.data();
+    length = (int)file.text.size();
+    name = file.name.c_str();
+    shader.setStringsWithLengthsAndNames(&text, &length, &name, 1);
+    shader.setEnvInput(glslang::EShSourceGlsl, file.stage, glslang::EShClientVulkan, 100);
+    shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_0);
+    shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_0);
+}
+
+//
+// Take one shader through all the phases, adding the time of each to 'seconds'.
+//
+// Returns false if any phase fails.
+//
+bool RunPhases(TShaderFile& file, double seconds[PhaseCount])
+{
+    const char* text;
+    int length;
+    const char* name;
+    glslang::TShader::ForbidIncluder includer;
+
+    // Preprocessing is in a shader of its own, as parse() preprocesses as it goes.
+    {
+        glslang::TShader shader(file.stage);
+        SetUpShader(shader, file, text, length, name);
+        std::string output;
+        glslang::TPhaseTimer timer(&seconds[PhasePreprocess]);
+        if (! shader.preprocess(&glslang::DefaultTBuiltInResource, 100, ENoProfile, false, false, Messages, &output,
+                                includer))
+            return false;
+    }
+
+    // The program has to go before the shader.
+    glslang::TShader shader(file.stage);
+    SetUpShader(shader, file, text, length, name);
+    glslang::TProgram program;
+    {
+        glslang::TPhaseTimer timer(&seconds[PhaseParse]);
+        if (! shader.parse(&glslang::DefaultTBuiltInResource, 100, false, Messages, includer))
+            return false;
+    }
+    program.addShader(&shader);
+    {
+        glslang::TPhaseTimer timer(&seconds[PhaseLink]);
+        if (! program.link(Messages))
+            return false;
+    }
+    {
+        glslang::TPhaseTimer timer(&seconds[PhaseIoMap]);
+        if (! program.mapIO())
+            return false;
+    }
+    {
+        glslang::TPhaseTimer timer(&seconds[PhaseReflection]);
+        if (! program.buildReflection())
+            return false;
+    }
+
+    std::vector<unsigned int> spirv;
+    spv::SpvBuildLogger logger;
+    {
+        glslang::TPhaseTimer timer(&seconds[PhaseSpirv]);
+        glslang::GlslangToSpv(*program.getIntermediate(file.stage), spirv, &logger);
+    }
+    if (spirv.empty())
+        return false;
+    file.spirvBytes = spirv.size() * sizeof(unsigned int);
+
+    std::vector<unsigned int> remapped(spirv);
+    {
+        glslang::TPhaseTimer timer(&seconds[PhaseRemap]);
+        spv::spirvbin_t().remap(remapped);
+    }
+    if (RemapFailed)
+        return false;
+
+    std::ostringstream disassembly;
+    {
+        glslang::TPhaseTimer timer(&seconds[PhaseDisassemble]);
+        spv::Disassemble(disassembly, spirv);
+    }
+
+    return true;
+}
+
+// Parse, link, map I/O, and make SPIR-V, as for a real workload.
+bool Compile(const TShaderFile& file, glslang::TCompilerContext* context)
+{
+    const char* text;
+    int length;
+    const char* name;
+    glslang::TShader::ForbidIncluder includer;
+
+    // The program has to go before the shader.
+    glslang::TShader shader(file.stage);
+    SetUpShader(shader, file, text, length, name);
+    shader.setCompilerContext(context);
+    glslang::TProgram program;
+    program.setCompilerContext(context);
+    if (! shader.parse(&glslang::DefaultTBuiltInResource, 100, false, Messages, includer))
+        return false;
+    program.addShader(&shader);
+    if (! program.link(Messages) || ! program.mapIO())
+        return false;
+
+    std::vector<unsigned int> spirv;
+    spv::SpvBuildLogger logger;
+    glslang::GlslangToSpv(*program.getIntermediate(file.stage), spirv, &logger);
+
+    return ! spirv.empty();
+}
+
+// Compile the corpus 'iterations' times over, shared out among 'threads'
+// threads, returning the seconds taken.
+double CompileOnThreads(const std::vector<TShaderFile>& corpus, int iterations, int threads,
+                        glslang::TCompilerContext* context)
+{
+    const size_t count = corpus.size() * iterations;
+    std::atomic<size_t> next(0);
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.push_back(std::thread([&corpus, &next, count, context]() {
+            for (size_t job = next++; job < count; job = next++)
+                Compile(corpus[job % corpus.size()], context);
+        }));
+    }
+    for (auto worker = workers.begin(); worker != workers.end(); ++worker)
+        worker->join();
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::string JsonString(const std::string& text)
+{
+    std::string quoted = "\"";
+    for (size_t c = 0; c < text.size(); ++c) {
+        if (text[c] == '"' || text[c] == '\\')
+            quoted += '\\';
+        quoted += text[c];
+    }
+
+    return quoted + "\"";
+}
+
+void Usage()
+{
+    printf("Usage: glslangbench [option]...\n"
+           "\n"
+           "  --test-root <dir>  directory of the shaders (default: the source tree's Test/)\n"
+           "  --filter <text>    only the shaders whose names contain <text>\n"
+           "  --iterations <n>   times over the corpus, keeping the fastest of each phase (default: 5)\n"
+           "  --threads <n>      instead, compile the corpus --iterations times over on 1, 2, 4, ... <n>\n"
+           "                     threads, for how it scales (this machine has %u hardware threads)\n"
+           "  --context          with --threads, share one TCompilerContext among the compiles\n"
+           "  --json <file>      also write the results as JSON to <file>\n",
+           std::thread::hardware_concurrency());
+}
+
+}  // anonymous namespace
+
+int main(int argc, char* argv[])
+{
+    std::string root = GLSLANG_TEST_DIRECTORY;
+    std::string filter;
+    std::string jsonName;
+    int iterations = 5;
+    int maxThreads = 0;
+    bool useContext = false;
+
+    for (int a = 1; a < argc; ++a) {
+        const std::string arg = argv[a];
+        if (arg == "--help") {
+            Usage();
+            return 0;
+        }
+        if (arg == "--context") {
+            useContext = true;
+            continue;
+        }
+        if (a + 1 == argc) {
+            Usage();
+            return 1;
+        }
+        if (arg == "--test-root")
+            root = argv[++a];
+        else if (arg == "--filter")
+            filter = argv[++a];
+        else if (arg == "--iterations")
+            iterations = std::max(1, atoi(argv[++a]));
+        else if (arg == "--threads")
+            maxThreads = std::max(1, atoi(argv[++a]));
+        else if (arg == "--json")
+            jsonName = argv[++a];
+        else {
+            Usage();
+            return 1;
+        }
+    }
+
+    glslang::InitializeProcess();
+    spv::spirvbin_t::registerErrorHandler([](const std::string&) { RemapFailed = true; });
+
+    // The corpus: the shaders that get through every phase.  This first time
+    // through also sets up the built-in symbol tables, so they aren't timed.
+    std::vector<TShaderFile> corpus;
+    const std::vector<std::string> names = ListFiles(root);
+    for (auto name = names.begin(); name != names.end(); ++name) {
+        TShaderFile file;
+        file.name = *name;
+        file.stage = FindStage(file.name);
+        if (file.stage == EShLangCount || file.name.compare(0, 5, "hlsl.") == 0 ||
+            file.name.find(filter) == std::string::npos)
+            continue;
+
+        std::ifstream stream(root + "/" + file.name, std::ios::in | std::ios::binary);
+        std::stringstream text;
+        text << stream.rdbuf();
+        file.text = text.str();
+
+        double seconds[PhaseCount] = { };
+        RemapFailed = false;
+        if (RunPhases(file, seconds))
+            corpus.push_back(file);
+    }
+    if (corpus.empty()) {
+        printf("No shaders to benchmark in %s\n", root.c_str());
+        glslang::FinalizeProcess();
+        return 1;
+    }
+
+    size_t sourceBytes = 0;
+    size_t spirvBytes = 0;
+    for (auto file = corpus.begin(); file != corpus.end(); ++file) {
+        sourceBytes += file->text.size();
+        spirvBytes += file->spirvBytes;
+    }
+
+    std::ostringstream json;
+    json.precision(9);
+    json << "{\n"
+         << "  \"testRoot\": " << JsonString(root) << ",\n"
+         << "  \"shaders\": " << corpus.size() << ",\n"
+         << "  \"sourceBytes\": " << sourceBytes << ",\n"
+         << "  \"spirvBytes\": " << spirvBytes << ",\n"
+         << "  \"iterations\": " << iterations << ",\n";
+
+    if (maxThreads == 0) {
+        double best[PhaseCount];
+        for (int i = 0; i < iterations; ++i) {
+            double seconds[PhaseCount] = { };
+            for (auto file = corpus.begin(); file != corpus.end(); ++file)
+                RunPhases(*file, seconds);
+            for (int p = 0; p < PhaseCount; ++p)
+                best[p] = i == 0 ? seconds[p] : std::min(best[p], seconds[p]);
+        }
+
+        printf("%d shaders, %zu bytes of source, %zu bytes of SPIR-V, best of %d\n\n", (int)corpus.size(),
+               sourceBytes, spirvBytes, iterations);
+        printf("%-12s %12s %12s %12s\n", "phase", "seconds", "MB/s", "shaders/s");
+        json << "  \"phases\": [\n";
+        for (int p = 0; p < PhaseCount; ++p) {
+            const size_t bytes = p == PhaseRemap || p == PhaseDisassemble ? spirvBytes : sourceBytes;
+            const double seconds = std::max(best[p], 1e-9);
+            const double bytesPerSecond = bytes / seconds;
+            const double shadersPerSecond = corpus.size() / seconds;
+            printf("%-12s %12.6f %12.2f %12.1f\n", PhaseNames[p], best[p], bytesPerSecond / 1e6, shadersPerSecond);
+            json << "    { \"name\": " << JsonString(PhaseNames[p]) << ", \"seconds\": " << best[p]
+                 << ", \"bytesPerSecond\": " << bytesPerSecond << ", \"shadersPerSecond\": " << shadersPerSecond
+                 << " }" << (p + 1 < PhaseCount ? ",\n" : "\n");
+        }
+    } else {
+        std::vector<int> threadCounts;
+        for (int threads = 1; threads < maxThreads; threads *= 2)
+            threadCounts.push_back(threads);
+        threadCounts.push_back(maxThreads);
+
+        printf("%d shaders, %zu bytes of source, compiled %d times over\n\n", (int)corpus.size(), sourceBytes,
+               iterations);
+        // A context has built-in symbol tables of its own, so set them up untimed.
+        std::unique_ptr<glslang::TCompilerContext> context(useContext ? new glslang::TCompilerContext : nullptr);
+        if (context)
+            CompileOnThreads(corpus, 1, 1, context.get());
+
+        printf("%-8s %12s %12s %12s %10s\n", "threads", "seconds", "MB/s", "shaders/s", "speedup");
+        json << "  \"scaling\": [\n";
+        double oneThread = 0.0;
+        for (size_t c = 0; c < threadCounts.size(); ++c) {
+            glslang::ResetLockStats();
+            const double seconds = std::max(CompileOnThreads(corpus, iterations, threadCounts[c], context.get()),
+                                           1e-9);
+            const std::vector<glslang::TLockStats> locks = glslang::GetLockStats();
+            const double bytesPerSecond = (double)sourceBytes * iterations / seconds;
+            const double shadersPerSecond = (double)corpus.size() * iterations / seconds;
+            if (c == 0)
+                oneThread = shadersPerSecond;
+            const double speedup = shadersPerSecond / oneThread;
+
+            printf("%-8d %12.6f %12.2f %12.1f %10.2f\n", threadCounts[c], seconds, bytesPerSecond / 1e6,
+                   shadersPerSecond, speedup);
+            json << "    { \"threads\": " << threadCounts[c] << ", \"seconds\": " << seconds
+                 << ", \"bytesPerSecond\": " << bytesPerSecond << ", \"shadersPerSecond\": " << shadersPerSecond
+                 << ", \"speedup\": " << speedup << ", \"locks\": [";
+            for (size_t l = 0; l < locks.size(); ++l) {
+                printf("    lock %-18s %12llu taken %12llu waited %12.6f seconds waiting\n", locks[l].name,
+                       locks[l].acquisitions, locks[l].contentions, locks[l].waitSeconds);
+                json << (l == 0 ? "\n" : ",\n")
+                     << "        { \"name\": " << JsonString(locks[l].name)
+                     << ", \"acquisitions\": " << locks[l].acquisitions
+                     << ", \"contentions\": " << locks[l].contentions
+                     << ", \"waitSeconds\": " << locks[l].waitSeconds << " }";
+            }
+            json << (locks.empty() ? "] }" : "\n      ] }") << (c + 1 < threadCounts.size() ? ",\n" : "\n");
+        }
+    }
+    json << "  ]\n"
+         << "}\n";
+
+    glslang::FinalizeProcess();
+
+    if (! jsonName.empty()) {
+        std::ofstream out(jsonName);
+        out << json.str();
+        if (! out) {
+            printf("Couldn't write %s\n", jsonName.c_str());
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,124 @@
+//
+// Copyright (C) 2018 LunarG, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+//    Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//    Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//    Neither the name of 3Dlabs Inc. Ltd. nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+//
+// Stopping compiles with TCancellation.
+//
+
+#include <chrono>
+
+#include <gtest/gtest.h>
+
+#include "TestFixture.h"
+
+namespace glslangtest {
+namespace {
+
+// A cancelled or expired compile stops with its own error and makes no SPIR-V.
+TEST(CancellationTest, StopsParseAndSpirv)
+{
+    const glslang::TCompileJob job = MakeVulkanJob("spv.310.comp");
+
+    glslang::TCancellation cancelled;
+    cancelled.cancel();
+    glslang::TCompileJob cancelledJob = job;
+    cancelledJob.cancellation = &cancelled;
+    glslang::TCompileResult result = glslang::Compile(cancelledJob);
+    EXPECT_FALSE(result.success);
+    EXPECT_TRUE(result.cancelled);
+    EXPECT_TRUE(result.spirv.empty());
+
+    // Stopped by the preprocessor, once it notices the deadline passed.
+    const char* source = job.source.c_str();
+    glslang::TCancellation expired;
+    expired.setDeadline(std::chrono::steady_clock::now() - std::chrono::seconds(1));
+    glslang::TShader shader(job.stage);
+    shader.setStrings(&source, 1);
+    job.setup(shader);
+    shader.setCancellation(&expired);
+    EXPECT_FALSE(shader.parse(job.resources, 100, false, job.messages));
+    EXPECT_TRUE(expired.isStopped());
+    EXPECT_TRUE(expired.isExpired());
+    EXPECT_NE(std::string::npos, std::string(shader.getInfoLog()).find("time budget exceeded"));
+    EXPECT_TRUE(shader.wasCancelled());
+    glslang::TProgram stoppedProgram;
+    stoppedProgram.addShader(&shader);
+    EXPECT_FALSE(stoppedProgram.link(job.messages));
+    EXPECT_TRUE(stoppedProgram.wasCancelled());
+
+    // Stopped by GlslangToSpv.
+    glslang::TShader parsed(job.stage);
+    parsed.setStrings(&source, 1);
+    job.setup(parsed);
+    ASSERT_TRUE(parsed.parse(job.resources, 100, false, job.messages));
+    glslang::TProgram program;
+    program.addShader(&parsed);
+    ASSERT_TRUE(program.link(job.messages));
+    EXPECT_FALSE(parsed.wasCancelled());
+    EXPECT_FALSE(program.wasCancelled());
+    glslang::TCancellation late;
+    late.cancel();
+    glslang::SpvOptions options;
+    options.cancellation = &late;
+    std::vector<unsigned int> spirv;
+    spv::SpvBuildLogger logger;
+    glslang::GlslangToSpv(*program.getIntermediate(job.stage), spirv, &logger, &options);
+    EXPECT_TRUE(spirv.empty());
+    EXPECT_NE(std::string::npos, logger.getAllMessages().find("compilation cancelled"));
+
+    // Other failures aren't cancellations, even once the TCancellation stops.
+    const char* bad = "#version 450\nvoid main() { undeclared = 1; }\n";
+    glslang::TCancellation shared;
+    glslang::TShader failed(job.stage);
+    failed.setStrings(&bad, 1);
+    job.setup(failed);
+    failed.setCancellation(&shared);
+    EXPECT_FALSE(failed.parse(job.resources, 100, false, job.messages));
+    shared.cancel();
+    EXPECT_FALSE(failed.wasCancelled());
+
+    // A job that isn't stopped is unaffected.
+    glslang::TCancellation unused;
+    unused.setTimeBudget(std::chrono::hours(1));
+    glslang::TCompileJob budgetedJob = job;
+    budgetedJob.cancellation = &unused;
+    result = glslang::Compile(budgetedJob);
+    EXPECT_TRUE(result.success);
+    EXPECT_FALSE(result.cancelled);
+    EXPECT_EQ(glslang::Compile(job).spirv, result.spirv);
+}
+
+}  // anonymous namespace
+}  // namespace glslangtest
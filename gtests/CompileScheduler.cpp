@@ -0,0 +1,143 @@
+//
+// Copyright (C) 2018 LunarG, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+//    Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//    Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//    Neither the name of 3Dlabs Inc. Ltd. nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+//
+// Compiles on TCompileScheduler worker threads.
+//
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+
+#include <gtest/gtest.h>
+
+#include "TestFixture.h"
+
+namespace glslangtest {
+namespace {
+
+// Jobs run on the workers give what they give on the calling thread, and a
+// single worker takes queued jobs highest priority first, then in order.
+TEST(CompileSchedulerTest, MatchesSynchronousCompiles)
+{
+    const std::vector<std::string> fileNames = {
+        "spv.bool.vert", "spv.for-simple.vert", "spv.310.comp", "spv.boolInBlock.frag", "spv.multiStruct.comp",
+    };
+    const std::vector<int> priorities = { 0, 1, 0, 2, 1 };
+    const std::vector<int> expectedOrder = { 3, 1, 4, 2 };
+
+    glslang::TCompileScheduler scheduler(1);
+    EXPECT_EQ(1, scheduler.getNumThreads());
+
+    // Hold the worker in the first job until the rest are queued.
+    std::promise<void> started;
+    std::promise<void> queued;
+    std::shared_future<void> allQueued = queued.get_future().share();
+    glslang::TCompileJob first = MakeVulkanJob(fileNames[0], priorities[0]);
+    const glslang::TMacroDedupVariants::TSetup setup = first.setup;
+    first.setup = [setup, &started, allQueued](glslang::TShader& shader) {
+        started.set_value();
+        allQueued.wait();
+        setup(shader);
+    };
+
+    std::mutex mutex;
+    std::vector<int> order;
+    std::vector<std::future<glslang::TCompileResult>> results;
+    results.push_back(scheduler.submit(first));
+    started.get_future().wait();
+    for (size_t f = 1; f < fileNames.size(); ++f) {
+        const int index = (int)f;
+        scheduler.submit(MakeVulkanJob(fileNames[f], priorities[f]),
+                         [&mutex, &order, index](const glslang::TCompileResult&) {
+                             std::lock_guard<std::mutex> guard(mutex);
+                             order.push_back(index);
+                         });
+        results.push_back(scheduler.submit(MakeVulkanJob(fileNames[f], priorities[f])));
+    }
+    queued.set_value();
+    scheduler.wait();
+
+    // Each callback job runs just before its twin with the same priority.
+    EXPECT_EQ(expectedOrder, order);
+
+    for (size_t f = 0; f < fileNames.size(); ++f) {
+        glslang::TCompileResult result = results[f].get();
+        glslang::TCompileResult expected = glslang::Compile(MakeVulkanJob(fileNames[f], priorities[f]));
+        EXPECT_TRUE(result.success) << fileNames[f] << "\n" << result.log;
+        EXPECT_EQ(expected.log, result.log);
+        EXPECT_EQ(expected.spirv, result.spirv);
+    }
+}
+
+// Waiting on a batch waits for its own jobs, not for others still running.
+TEST(CompileSchedulerTest, WaitsForOneBatch)
+{
+    const std::vector<std::string> fileNames = { "spv.bool.vert", "spv.for-simple.vert", "spv.310.comp" };
+
+    glslang::TCompileScheduler scheduler(2);
+
+    // Batch 'held' has one job that doesn't finish until released.
+    glslang::TCompileBatch held;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::atomic<bool> heldDone(false);
+    scheduler.submit(MakeVulkanJob(fileNames[0]),
+                     [released, &heldDone](const glslang::TCompileResult&) {
+                         released.wait_for(std::chrono::seconds(10));
+                         heldDone = true;
+                     },
+                     &held);
+
+    glslang::TCompileBatch batch;
+    std::vector<std::future<glslang::TCompileResult>> results;
+    for (size_t f = 0; f < fileNames.size(); ++f)
+        results.push_back(scheduler.submit(MakeVulkanJob(fileNames[f]), &batch));
+    scheduler.wait(batch);
+
+    for (size_t f = 0; f < fileNames.size(); ++f) {
+        EXPECT_EQ(std::future_status::ready, results[f].wait_for(std::chrono::seconds(0))) << fileNames[f];
+        EXPECT_TRUE(results[f].get().success) << fileNames[f];
+    }
+    EXPECT_FALSE(heldDone);
+
+    release.set_value();
+    scheduler.wait(held);
+    EXPECT_TRUE(heldDone);
+}
+
+}  // anonymous namespace
+}  // namespace glslangtest
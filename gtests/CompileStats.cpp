@@ -0,0 +1,145 @@
+//
+// Copyright (C) 2018 LunarG, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+//    Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//    Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//    Neither the name of 3Dlabs Inc. Ltd. nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+//
+// Counts from TShader/TProgram::getCompileStats().
+//
+
+#include <gtest/gtest.h>
+
+#include "TestFixture.h"
+
+namespace glslangtest {
+namespace {
+
+// Each stage of a compile reports its work, and the program's counts
+// include those of its shaders.
+TEST(CompileStatsTest, CountsEachStage)
+{
+    glslang::TVirtualFileIncluder includer;
+    includer.addFile("util.h", "#define SCALE(x) ((x) * 2.0)\nfloat util(float v) { return SCALE(v); }\n");
+    const char* text = "#version 450\n"
+                       "#extension GL_GOOGLE_include_directive : require\n"
+                       "#include \"util.h\"\n"
+                       "layout(local_size_x = 1) in;\n"
+                       "layout(std430, binding = 0) buffer Out { float f; };\n"
+                       "void main() { if (f > 0.0) f = util(f) + SCALE(3.0); }\n";
+    glslang::TShader shader(EShLangCompute);
+    shader.setStrings(&text, 1);
+    shader.setEnvInput(glslang::EShSourceGlsl, EShLangCompute, glslang::EShClientVulkan, 100);
+    shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_0);
+    shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_0);
+    const EShMessages messages = (EShMessages)(EShMsgSpvRules | EShMsgVulkanRules);
+    ASSERT_TRUE(shader.parse(&glslang::DefaultTBuiltInResource, 100, false, messages, includer))
+        << shader.getInfoLog();
+
+    glslang::TProgram program;
+    program.addShader(&shader);
+    ASSERT_TRUE(program.link(messages)) << program.getInfoLog();
+    glslang::TCompileStats spvStats;
+    glslang::SpvOptions options;
+    options.compileStats = &spvStats;
+    std::vector<uint32_t> spirv;
+    glslang::GlslangToSpv(*program.getIntermediate(EShLangCompute), spirv, &options);
+    ASSERT_FALSE(spirv.empty());
+
+    const glslang::TCompileStats& stats = shader.getCompileStats();
+    if (! glslang::TCompileStats::isGathered()) {
+        EXPECT_EQ(0u, stats.ppTokens);
+        EXPECT_EQ(0u, spvStats.spvInstructions);
+        return;
+    }
+    EXPECT_GT(stats.ppTokens, 0u);
+    EXPECT_EQ(2u, stats.macroExpansions);
+    EXPECT_EQ(1u, stats.includes);
+    EXPECT_GT(stats.symbolLookups, 0u);
+    EXPECT_GE(stats.overloadResolutions, 1u);
+    EXPECT_GT(stats.constantFolds, 0u);
+    EXPECT_GT(stats.selectionNodes, 0u);
+    EXPECT_GT(stats.aggregateNodes, 0u);
+    EXPECT_GT(stats.poolBytes, 0u);
+    EXPECT_GT(spvStats.spvInstructions, 0u);
+    EXPECT_EQ(spirv[3], spvStats.spvIds);
+
+    const glslang::TCompileStats& linked = program.getCompileStats();
+    EXPECT_EQ(stats.ppTokens, linked.ppTokens);
+    EXPECT_EQ(stats.astNodes(), linked.astNodes());
+    EXPECT_GE(linked.poolBytes, stats.poolBytes);
+}
+
+// Only calls that resolve to a function count as overload resolutions, in
+// GLSL and HLSL alike.
+TEST(CompileStatsTest, CountsResolvedCallsOnly)
+{
+    if (! glslang::TCompileStats::isGathered())
+        return;
+
+    const auto countResolutions = [](glslang::EShSource source, const char* text) {
+        glslang::TShader shader(EShLangFragment);
+        shader.setStrings(&text, 1);
+        shader.setEntryPoint("main");
+        shader.setEnvInput(source, EShLangFragment, glslang::EShClientVulkan, 100);
+        shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_0);
+        shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_0);
+        EShMessages messages = (EShMessages)(EShMsgSpvRules | EShMsgVulkanRules);
+        if (source == glslang::EShSourceHlsl)
+            messages = (EShMessages)(messages | EShMsgReadHlsl);
+        shader.parse(&glslang::DefaultTBuiltInResource, 100, false, messages);
+        return shader.getCompileStats().overloadResolutions;
+    };
+
+    const unsigned int glsl = countResolutions(glslang::EShSourceGlsl,
+        "#version 450\n"
+        "layout(location = 0) out vec4 color;\n"
+        "float f(float x) { return x; }\n"
+        "void main() { color = vec4(f(1.0)); }\n");
+    EXPECT_GE(glsl, 1u);
+    EXPECT_EQ(glsl, countResolutions(glslang::EShSourceGlsl,
+        "#version 450\n"
+        "layout(location = 0) out vec4 color;\n"
+        "float f(float x) { return x; }\n"
+        "void main() { color = vec4(f(1.0) + missing(2.0)); }\n"));
+
+    const unsigned int hlsl = countResolutions(glslang::EShSourceHlsl,
+        "float f(float x) { return x; }\n"
+        "float4 main() : SV_Target0 { return f(1.0); }\n");
+    EXPECT_GE(hlsl, 1u);
+    EXPECT_EQ(hlsl, countResolutions(glslang::EShSourceHlsl,
+        "float f(float x) { return x; }\n"
+        "float4 main() : SV_Target0 { return f(1.0) + missing(2.0); }\n"));
+}
+
+}  // anonymous namespace
+}  // namespace glslangtest
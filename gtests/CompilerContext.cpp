@@ -0,0 +1,192 @@
+//
+// Copyright (C) 2018 LunarG, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+//    Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//    Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//    Neither the name of 3Dlabs Inc. Ltd. nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+//
+// Caches shared through TCompilerContext.
+//
+
+#include <gtest/gtest.h>
+
+#include "TestFixture.h"
+
+namespace glslangtest {
+namespace {
+
+// Gives "<name>'s contents" for any include, counting how often it is asked.
+class CountingIncluder : public glslang::TShader::Includer {
+public:
+    CountingIncluder() : calls(0) { }
+
+    virtual IncludeResult* includeLocal(const char* headerName, const char*, size_t) override
+    {
+        ++calls;
+        std::string* contents = new std::string(std::string(headerName) + "'s contents");
+        return new IncludeResult(headerName, contents->data(), contents->size(), contents);
+    }
+    virtual void releaseInclude(IncludeResult* result) override
+    {
+        delete static_cast<std::string*>(result->userData);
+        delete result;
+    }
+
+    int calls;
+};
+
+// Compiles give the same results with or without contexts, and each context
+// keeps its own caches, within its limits.
+TEST(CompilerContextTest, SharesCachesWithinLimits)
+{
+    const glslang::TCompileJob job = MakeVulkanJob("spv.310.comp");
+    const glslang::TCompileResult expected = glslang::Compile(job);
+    ASSERT_TRUE(expected.success) << expected.log;
+
+    glslang::TCompilerContext first;
+    glslang::TCompilerContext second;
+    glslang::TCompileJob contextJob = job;
+    for (glslang::TCompilerContext* context : { &first, &first, &second }) {
+        contextJob.context = context;
+        const glslang::TCompileResult result = glslang::Compile(contextJob);
+        EXPECT_EQ(expected.log, result.log);
+        EXPECT_EQ(expected.spirv, result.spirv);
+    }
+
+    glslang::TCompilerContext::TStats stats = first.getStats();
+    EXPECT_EQ(1u, stats.builtInTableSets);
+    EXPECT_GT(stats.builtInBytes, 0u);
+    EXPECT_LT(stats.builtInBytes, first.getLimits().builtInBytes);
+    EXPECT_GT(stats.pageCacheHits, 0u);
+    EXPECT_GT(stats.pageCacheBytes, 0u);
+    EXPECT_EQ(0, stats.attachedShaders);
+    EXPECT_EQ(1u, second.getStats().builtInTableSets);
+
+    first.trim();
+    stats = first.getStats();
+    EXPECT_EQ(0u, stats.builtInBytes);
+    EXPECT_EQ(1u, stats.builtInTrims);
+    EXPECT_EQ(0u, stats.pageCacheBytes);
+    EXPECT_GT(second.getStats().builtInBytes, 0u);
+
+    // The most recently used built-ins are kept, even over the limit.
+    glslang::TCompilerContext::TLimits limits;
+    limits.builtInBytes = 1;
+    limits.includeBytes = 40;
+    glslang::TCompilerContext limited(limits);
+    contextJob.context = &limited;
+    EXPECT_EQ(expected.spirv, glslang::Compile(contextJob).spirv);
+    stats = limited.getStats();
+    EXPECT_EQ(1u, stats.builtInTableSets);
+    EXPECT_EQ(0u, stats.builtInTrims);
+
+    // Once no shader is using them, the least recently used go first.
+    const glslang::TCompileJob other = MakeVulkanJob("spv.bool.vert");
+    contextJob = other;
+    contextJob.context = &limited;
+    EXPECT_EQ(glslang::Compile(other).spirv, glslang::Compile(contextJob).spirv);
+    stats = limited.getStats();
+    EXPECT_EQ(1u, stats.builtInTableSets);
+    EXPECT_EQ(1u, stats.builtInTrims);
+
+    // Includes are resolved once, until evicted.
+    CountingIncluder counting;
+    glslang::TCompilerContext::CachingIncluder includer(limited, counting);
+    for (const char* name : { "a.h", "a.h", "b.h", "c.h", "a.h" }) {
+        glslang::TShader::Includer::IncludeResult* result = includer.includeLocal(name, "main.comp", 1);
+        ASSERT_NE(nullptr, result);
+        EXPECT_EQ(name, result->headerName);
+        EXPECT_EQ(std::string(name) + "'s contents", std::string(result->headerData, result->headerLength));
+        includer.releaseInclude(result);
+    }
+    EXPECT_EQ(4, counting.calls);
+    stats = limited.getStats();
+    EXPECT_EQ(1u, stats.includeHits);
+    EXPECT_EQ(4u, stats.includeMisses);
+    EXPECT_EQ(2u, stats.includeEntries);
+    EXPECT_EQ(28u, stats.includeBytes);
+}
+
+// Table sets over the limit are dropped one at a time, least recently used
+// first, so those still fitting aren't set up again.
+TEST(CompilerContextTest, DropsLeastRecentlyUsedBuiltIns)
+{
+    const glslang::TCompileJob jobs[] = { MakeVulkanJob("spv.310.comp"), MakeVulkanJob("spv.bool.vert"),
+                                          MakeVulkanJob("spv.for-simple.vert") };
+
+    // Limit to room for both sets, but not three of the larger.
+    size_t setBytes[2];
+    for (int j = 0; j < 2; ++j) {
+        glslang::TCompilerContext alone;
+        glslang::TCompileJob job = jobs[j];
+        job.context = &alone;
+        ASSERT_TRUE(glslang::Compile(job).success);
+        setBytes[j] = alone.getStats().builtInBytes;
+    }
+    glslang::TCompilerContext::TLimits limits;
+    limits.builtInBytes = setBytes[0] + setBytes[1];
+    glslang::TCompilerContext context(limits);
+
+    // spv.for-simple.vert uses the same set (310 es) as spv.310.comp.
+    for (int j : { 0, 1, 2, 0, 1 }) {
+        glslang::TCompileJob job = jobs[j];
+        job.context = &context;
+        EXPECT_TRUE(glslang::Compile(job).success);
+    }
+    glslang::TCompilerContext::TStats stats = context.getStats();
+    EXPECT_EQ(2u, stats.builtInTableSets);
+    EXPECT_EQ(0u, stats.builtInTrims);
+    EXPECT_EQ(limits.builtInBytes, stats.builtInBytes);
+
+    // Lowering the limit drops the older set, then nothing more.
+    limits.builtInBytes = setBytes[1];
+    context.setLimits(limits);
+    stats = context.getStats();
+    EXPECT_EQ(1u, stats.builtInTableSets);
+    EXPECT_EQ(1u, stats.builtInTrims);
+    EXPECT_EQ(setBytes[1], stats.builtInBytes);
+    limits.builtInBytes = 0;
+    context.setLimits(limits);
+    EXPECT_EQ(1u, context.getStats().builtInTableSets);
+
+    // Coming back to the dropped set drops the other in turn.
+    glslang::TCompileJob job = jobs[0];
+    job.context = &context;
+    EXPECT_TRUE(glslang::Compile(job).success);
+    stats = context.getStats();
+    EXPECT_EQ(1u, stats.builtInTableSets);
+    EXPECT_EQ(2u, stats.builtInTrims);
+    EXPECT_EQ(setBytes[0], stats.builtInBytes);
+}
+
+}  // anonymous namespace
+}  // namespace glslangtest
@@ -0,0 +1,109 @@
+//
+// Copyright (C) 2018 LunarG, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+//    Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//    Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//    Neither the name of 3Dlabs Inc. Ltd. nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+//
+// Source text in SPIR-V debug information.
+//
+
+#include <gtest/gtest.h>
+
+#include "TestFixture.h"
+
+namespace glslangtest {
+namespace {
+
+// With debug information, the source strings, however long and however many,
+// end up whole in OpSource and its OpSourceContinued instructions.
+TEST(DebugSourceTest, SplitsLongSources)
+{
+    std::vector<std::string> pieces;
+    pieces.push_back("#version 450\nlayout(local_size_x = 1) in;\n");
+    for (int p = 0; p < 3; ++p) {
+        std::string comment = "// " + std::string(100000 + p, (char)('a' + p)) + "\n";
+        pieces.push_back(comment);
+    }
+    pieces.push_back("");
+    pieces.push_back("void main() { }\n");
+    std::vector<const char*> strings;
+    std::vector<int> lengths;
+    std::string expected;
+    for (const std::string& piece : pieces) {
+        strings.push_back(piece.data());
+        lengths.push_back((int)piece.size());
+        expected += piece;
+    }
+    std::vector<const char*> names(strings.size(), "long.comp");
+
+    glslang::TShader shader(EShLangCompute);
+    shader.setStringsWithLengthsAndNames(strings.data(), lengths.data(), names.data(), (int)strings.size());
+    const EShMessages messages = (EShMessages)(EShMsgSpvRules | EShMsgVulkanRules | EShMsgDebugInfo);
+    shader.setEnvInput(glslang::EShSourceGlsl, EShLangCompute, glslang::EShClientVulkan, 100);
+    shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_0);
+    shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_0);
+    ASSERT_TRUE(shader.parse(&glslang::DefaultTBuiltInResource, 100, false, messages)) << shader.getInfoLog();
+    glslang::TProgram program;
+    program.addShader(&shader);
+    ASSERT_TRUE(program.link(messages)) << program.getInfoLog();
+    std::vector<uint32_t> spirv;
+    glslang::SpvOptions options;
+    options.generateDebugInfo = true;
+    glslang::GlslangToSpv(*program.getIntermediate(EShLangCompute), spirv, &options);
+
+    std::string source;
+    int instructions = 0;
+    for (size_t word = 5; word < spirv.size(); ) {
+        const uint32_t wordCount = spirv[word] >> spv::WordCountShift;
+        const uint32_t opCode = spirv[word] & spv::OpCodeMask;
+        ASSERT_GT(wordCount, 0u);
+        ASSERT_LE(word + wordCount, spirv.size());
+        const size_t first = opCode == spv::OpSource ? 4 : opCode == spv::OpSourceContinued ? 1 : 0;
+        if (first > 0 && wordCount > first) {
+            const char* text = reinterpret_cast<const char*>(&spirv[word + first]);
+            const size_t size = strnlen(text, 4 * (wordCount - first));
+            EXPECT_EQ((wordCount - first) * 4, (size / 4 + 1) * 4);
+            source.append(text, size);
+            ++instructions;
+        }
+        word += wordCount;
+    }
+    // after comments for the OpModuleProcessed of SPIR-V 1.0
+    EXPECT_EQ(2, instructions);
+    const size_t preamble = source.find("#line 1\n");
+    ASSERT_NE(std::string::npos, preamble);
+    EXPECT_EQ(expected, source.substr(preamble + 8));
+}
+
+}  // anonymous namespace
+}  // namespace glslangtest
@@ -0,0 +1,78 @@
+//
+// Copyright (C) 2018 LunarG, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+//    Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//    Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//    Neither the name of 3Dlabs Inc. Ltd. nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+//
+// Counting internal locks with GetLockStats().
+//
+
+#include <gtest/gtest.h>
+
+#include "TestFixture.h"
+
+namespace glslangtest {
+namespace {
+
+// Locks are counted only in builds that ask for it.
+TEST(LockStatsTest, CountsContextLocks)
+{
+    glslang::ResetLockStats();
+    glslang::TCompilerContext context;
+    glslang::TCompileJob job = MakeVulkanJob("spv.310.comp");
+    job.context = &context;
+    ASSERT_TRUE(glslang::Compile(job).success);
+    ASSERT_TRUE(glslang::InitializeProcess());
+    glslang::FinalizeProcess();
+
+    const std::vector<glslang::TLockStats> locks = glslang::GetLockStats();
+    if (locks.empty())
+        return;
+    bool countedContext = false;
+    bool countedProcess = false;
+    for (const glslang::TLockStats& lock : locks) {
+        EXPECT_LE(lock.contentions, lock.acquisitions);
+        if (std::string("compiler context") == lock.name)
+            countedContext = lock.acquisitions > 0;
+        if (std::string("process") == lock.name)
+            countedProcess = lock.acquisitions > 0;
+    }
+    EXPECT_TRUE(countedContext);
+#ifndef GLSLANG_THREAD_LOCAL
+    // With thread_local state, InitProcess() has nothing to lock.
+    EXPECT_TRUE(countedProcess);
+#endif
+}
+
+}  // anonymous namespace
+}  // namespace glslangtest
@@ -72,5 +72,97 @@ INSTANTIATE_TEST_CASE_P(
 );
 // clang-format on
 
+using PreprocessingVariantsTest = GlslangTest<::testing::Test>;
+
+// Variants parsed together match separate compiles, and a variant only
+// shares a parse when it differs in macros the shader never looks at.
+TEST_F(PreprocessingVariantsTest, MatchSeparateCompiles)
+{
+    std::string input;
+    tryLoadFile(GlobalTestSettings.testRoot + "/preprocessor.variants.vert", "input", &input);
+    const char* source = input.c_str();
+    const EShMessages messages = EShMsgAST;
+
+    const std::vector<std::vector<std::string>> defines = {
+        { "USE_COLOR", "SCALE=1.0", "OFFSET=0.5" },
+        { "USE_COLOR", "SCALE=2.0", "OFFSET=0.5" },
+        { "SCALE=1.0", "OFFSET=0.5" },
+        { "SCALE=2.0", "OFFSET=0.5" },                  // SCALE is only used with USE_COLOR
+        { "USE_COLOR", "SCALE=1.0", "OFFSET=0.5", "UNUSED=3" },
+        { "OFFSET=0.5", "SCALE=1.0" },
+        { "OFFSET=2.0" },
+    };
+    const std::vector<int> expectedParse = { 0, 1, 2, 2, 0, 2, 6 };
+
+    glslang::TMacroDedupVariants variants(EShLangVertex, [&source](glslang::TShader& shader) {
+        shader.setStrings(&source, 1); });
+    for (size_t v = 0; v < defines.size(); ++v)
+        variants.addVariant(defines[v]);
+    EXPECT_TRUE(variants.parse(&glslang::DefaultTBuiltInResource, 100, false, messages));
+    EXPECT_EQ(4, variants.getNumParses());
+
+    for (int v = 0; v < variants.getNumVariants(); ++v) {
+        EXPECT_EQ(expectedParse[v], variants.getParsedVariant(v));
+
+        std::string preamble;
+        for (const std::string& define : defines[v]) {
+            std::string line = define;
+            const size_t equal = line.find('=');
+            if (equal != std::string::npos)
+                line[equal] = ' ';
+            preamble += "#define " + line + "\n";
+        }
+        glslang::TShader shader(EShLangVertex);
+        shader.setStrings(&source, 1);
+        shader.setPreamble(preamble.c_str());
+        EXPECT_TRUE(shader.parse(&glslang::DefaultTBuiltInResource, 100, false, messages));
+        EXPECT_EQ(std::string(shader.getInfoLog()), std::string(variants.getShader(v)->getInfoLog()));
+    }
+}
+
+// A variant whose own macros give a message compiles by itself, even when
+// the shader never looks at them, and reports just what a separate compile would.
+TEST_F(PreprocessingVariantsTest, BadMacrosAreNotShared)
+{
+    std::string input;
+    tryLoadFile(GlobalTestSettings.testRoot + "/preprocessor.variants.vert", "input", &input);
+    const char* source = input.c_str();
+    const EShMessages messages = EShMsgAST;
+
+    const std::vector<std::vector<std::string>> defines = {
+        { "OFFSET=0.5" },
+        { "OFFSET=0.5", "1BAD" },
+        { "OFFSET=0.5", "UNUSED=1", "UNUSED=2" },      // redefined
+        { "OFFSET=0.5", "GL_FOO" },                    // only reserved in the shader's own text
+        { "OFFSET=0.5", "UNUSED" },
+    };
+    const std::vector<int> expectedParse = { 0, 1, 2, 0, 0 };
+
+    glslang::TMacroDedupVariants variants(EShLangVertex, [&source](glslang::TShader& shader) {
+        shader.setStrings(&source, 1); });
+    for (size_t v = 0; v < defines.size(); ++v)
+        variants.addVariant(defines[v]);
+    EXPECT_FALSE(variants.parse(&glslang::DefaultTBuiltInResource, 100, false, messages));
+    EXPECT_EQ(3, variants.getNumParses());
+
+    for (int v = 0; v < variants.getNumVariants(); ++v) {
+        EXPECT_EQ(expectedParse[v], variants.getParsedVariant(v));
+
+        std::string preamble;
+        for (const std::string& define : defines[v]) {
+            std::string line = define;
+            const size_t equal = line.find('=');
+            if (equal != std::string::npos)
+                line[equal] = ' ';
+            preamble += "#define " + line + "\n";
+        }
+        glslang::TShader shader(EShLangVertex);
+        shader.setStrings(&source, 1);
+        shader.setPreamble(preamble.c_str());
+        shader.parse(&glslang::DefaultTBuiltInResource, 100, false, messages);
+        EXPECT_EQ(std::string(shader.getInfoLog()), std::string(variants.getShader(v)->getInfoLog()));
+    }
+}
+
 }  // anonymous namespace
 }  // namespace glslangtest
@@ -0,0 +1,109 @@
+//
+// Copyright (C) 2018 LunarG, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+//    Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//    Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//    Neither the name of 3Dlabs Inc. Ltd. nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+//
+// Freeing ASTs once SPIR-V is made.
+//
+
+#include <gtest/gtest.h>
+
+#include "TestFixture.h"
+
+namespace glslangtest {
+namespace {
+
+// Once the SPIR-V is made, the ASTs go, while the logs and reflection stay.
+TEST(ReleaseIntermediateTest, KeepsLogsAndReflection)
+{
+    const char* mainText = "#version 450\n"
+                           "uniform vec4 color;\n"
+                           "vec4 shade();\n"
+                           "out vec4 o;\n"
+                           "void main() { o = shade(); }\n";
+    const char* shadeText = "#version 450\n"
+                            "uniform vec4 color;\n"
+                            "vec4 shade() { return color * 2.0; }\n";
+    const auto makeSpirv = [&](bool release, std::vector<uint32_t>& spirv) {
+        glslang::TShader mainShader(EShLangFragment);
+        glslang::TShader shadeShader(EShLangFragment);
+        mainShader.setStrings(&mainText, 1);
+        shadeShader.setStrings(&shadeText, 1);
+        ASSERT_TRUE(mainShader.parse(&glslang::DefaultTBuiltInResource, 100, false, EShMsgDefault));
+        ASSERT_TRUE(shadeShader.parse(&glslang::DefaultTBuiltInResource, 100, false, EShMsgDefault));
+
+        glslang::TProgram program;
+        program.addShader(&mainShader);
+        program.addShader(&shadeShader);
+        ASSERT_TRUE(program.link(EShMsgDefault)) << program.getInfoLog();
+        ASSERT_TRUE(program.buildReflection());
+        glslang::GlslangToSpv(*program.getIntermediate(EShLangFragment), spirv);
+        if (! release)
+            return;
+
+        const std::string log = std::string(mainShader.getInfoLog()) + program.getInfoLog();
+        const unsigned int astNodes = mainShader.getCompileStats().astNodes();
+        program.releaseIntermediates();
+        EXPECT_EQ(nullptr, program.getIntermediate(EShLangFragment));
+        EXPECT_EQ(nullptr, mainShader.getIntermediate());
+        EXPECT_EQ(nullptr, shadeShader.getIntermediate());
+        EXPECT_EQ(log, std::string(mainShader.getInfoLog()) + program.getInfoLog());
+        EXPECT_EQ(astNodes, mainShader.getCompileStats().astNodes());
+
+        ASSERT_EQ(1, program.getNumLiveUniformVariables());
+        EXPECT_STREQ("color", program.getUniformName(0));
+        ASSERT_NE(nullptr, program.getUniformTType(0));
+        EXPECT_EQ(glslang::EbtFloat, program.getUniformTType(0)->getBasicType());
+        EXPECT_EQ(4, program.getUniformTType(0)->getVectorSize());
+    };
+
+    std::vector<uint32_t> expected;
+    makeSpirv(false, expected);
+    std::vector<uint32_t> spirv;
+    makeSpirv(true, spirv);
+    EXPECT_EQ(expected, spirv);
+
+    // A shader on its own, and compiles after it, on the same thread.
+    glslang::TShader shader(EShLangFragment);
+    shader.setStrings(&shadeText, 1);
+    EXPECT_TRUE(shader.parse(&glslang::DefaultTBuiltInResource, 100, false, EShMsgDefault));
+    shader.releaseIntermediate();
+    EXPECT_EQ(nullptr, shader.getIntermediate());
+    std::vector<uint32_t> again;
+    makeSpirv(true, again);
+    EXPECT_EQ(expected, again);
+}
+
+}  // anonymous namespace
+}  // namespace glslangtest
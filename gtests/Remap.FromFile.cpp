@@ -36,6 +36,9 @@
 
 #include "TestFixture.h"
 
+#include "SPIRV/SPVCompress.h"
+#include "SPIRV/SpvParser.h"
+
 namespace glslangtest {
 namespace {
 
@@ -58,7 +61,33 @@ std::string FileNameAsCustomTestSuffix(
     return name;
 }
 
-using RemapTest = GlslangTest<::testing::TestWithParam<RemapTestArgs>>;
+class RemapTest : public GlslangTest<::testing::TestWithParam<RemapTestArgs>> {
+protected:
+    // Load a test's SPIR-V, compiling it first if it is a shader.
+    void loadOrCompile(const RemapTestArgs& args, std::vector<uint32_t>& spirv_binary)
+    {
+        const std::string inputFname = GlobalTestSettings.testRoot + "/" + args.fileName;
+        const EShMessages controls = DeriveOptions(args.sourceLanguage, Semantics::Vulkan, Target::Spv);
+
+        if (GetSuffix(args.fileName) == "spv") {
+            tryLoadSpvFile(inputFname, "input", spirv_binary);
+        } else {
+            std::string input;
+            tryLoadFile(inputFname, "input", &input);
+
+            const EShLanguage stage = GetShaderStage(GetSuffix(args.fileName));
+            glslang::TShader shader(stage);
+            shader.setAutoMapBindings(true);
+            shader.setAutoMapLocations(true);
+
+            glslang::TProgram program;
+            ASSERT_TRUE(compile(&shader, input, args.entryPoint, controls));
+            program.addShader(&shader);
+            ASSERT_TRUE(program.link(controls));
+            glslang::GlslangToSpv(*program.getIntermediate(stage), spirv_binary);
+        }
+    }
+};
 
 // Remapping SPIR-V modules.
 TEST_P(RemapTest, FromFile)
@@ -79,6 +108,177 @@ TEST_P(RemapTest, FromFile)
     }
 }
 
+// Remapped modules must survive a round trip through the compact encoding unchanged.
+TEST_P(RemapTest, CompressRoundTrip)
+{
+    std::vector<uint32_t> spirv_binary;
+    loadOrCompile(GetParam(), spirv_binary);
+    ASSERT_FALSE(spirv_binary.empty());
+
+    spv::spirvbin_t(0 /*verbosity*/).remap(spirv_binary, GetParam().remapOpts);
+
+    std::vector<uint8_t> compressed;
+    ASSERT_TRUE(spv::spirvcompress_t::compress(spirv_binary, compressed));
+    EXPECT_TRUE(spv::spirvcompress_t::isCompressed(compressed.data(), compressed.size()));
+    EXPECT_LT(compressed.size(), spirv_binary.size() * sizeof(uint32_t));
+
+    std::vector<uint32_t> decompressed;
+    ASSERT_TRUE(spv::spirvcompress_t::decompress(compressed.data(), compressed.size(), decompressed));
+    EXPECT_EQ(spirv_binary, decompressed);
+
+    // Truncated streams are rejected rather than silently decoded short.
+    EXPECT_FALSE(spv::spirvcompress_t::decompress(compressed.data(), compressed.size() - 1, decompressed));
+    EXPECT_TRUE(decompressed.empty());
+
+    // So are streams of another version.
+    std::vector<uint8_t> otherVersion = compressed;
+    ++otherVersion[4];
+    EXPECT_FALSE(spv::spirvcompress_t::decompress(otherVersion.data(), otherVersion.size(), decompressed));
+
+    // And a varint with bits above 32, here the word count spelled out in five
+    // bytes with bit 32 set, which would otherwise wrap around to the right count.
+    size_t countEnd = 8;
+    while (compressed[countEnd] & 0x80)
+        ++countEnd;
+    const uint32_t count = (uint32_t)spirv_binary.size();
+    std::vector<uint8_t> overlong(compressed.begin(), compressed.begin() + 8);
+    for (int shift = 0; shift < 28; shift += 7)
+        overlong.push_back(uint8_t(((count >> shift) & 0x7f) | 0x80));
+    overlong.push_back(uint8_t((count >> 28) | 0x10));
+    overlong.insert(overlong.end(), compressed.begin() + countEnd + 1, compressed.end());
+    EXPECT_FALSE(spv::spirvcompress_t::decompress(overlong.data(), overlong.size(), decompressed));
+}
+
+// The shared parser must tile the whole module with instructions, and find every
+// <id> operand within the bound.
+TEST_P(RemapTest, ParserIndex)
+{
+    std::vector<uint32_t> spirv_binary;
+    loadOrCompile(GetParam(), spirv_binary);
+    ASSERT_FALSE(spirv_binary.empty());
+
+    spv::Parser parser;
+    ASSERT_TRUE(parser.parse(spirv_binary.data(), spirv_binary.size()));
+    EXPECT_EQ(spv::Parser::ErrorNone, parser.getError());
+
+    unsigned offset = spv::Parser::headerSize;
+    for (const spv::Parser::Instruction& inst : parser.getInstructions()) {
+        EXPECT_EQ(offset, inst.offset);
+        for (unsigned id = inst.idBegin; id < inst.idEnd; ++id) {
+            const unsigned pos = parser.getIdPositions()[id];
+            EXPECT_GT(pos, inst.offset);
+            EXPECT_LT(pos, inst.offset + inst.wordCount);
+            EXPECT_LT(spirv_binary[pos], parser.getBound());
+        }
+        offset += inst.wordCount;
+    }
+    EXPECT_EQ(spirv_binary.size(), offset);
+
+    // A last instruction running past the end is reported at its offset.
+    const unsigned lastOffset = parser.getInstructions().back().offset;
+    spirv_binary[lastOffset] += 1 << spv::WordCountShift;
+    EXPECT_FALSE(parser.parse(spirv_binary.data(), spirv_binary.size()));
+    EXPECT_EQ(spv::Parser::ErrorTruncated, parser.getError());
+    EXPECT_EQ(lastOffset, parser.getErrorOffset());
+}
+
+// A string running past the end of its instruction is reported on that
+// instruction, and both the parser and the disassembler go on past it.
+TEST_P(RemapTest, ParserRecoversFromBadString)
+{
+    std::vector<uint32_t> spirv_binary;
+    loadOrCompile(GetParam(), spirv_binary);
+    ASSERT_FALSE(spirv_binary.empty());
+
+    spv::Parser parser;
+    ASSERT_TRUE(parser.parse(spirv_binary.data(), spirv_binary.size()));
+    const size_t numInstructions = parser.getInstructions().size();
+    unsigned nameOffset = 0;
+    for (const spv::Parser::Instruction& inst : parser.getInstructions()) {
+        if (inst.opCode == spv::OpName) {
+            nameOffset = inst.offset;
+            for (unsigned w = 2; w < inst.wordCount; ++w)
+                spirv_binary[inst.offset + w] = 0x41414141;
+            break;
+        }
+    }
+    if (nameOffset == 0)
+        return;
+
+    EXPECT_FALSE(parser.parse(spirv_binary.data(), spirv_binary.size()));
+    EXPECT_EQ(spv::Parser::ErrorString, parser.getError());
+    EXPECT_EQ(nameOffset, parser.getErrorOffset());
+    ASSERT_EQ(numInstructions, parser.getInstructions().size());
+    EXPECT_EQ(spv::Parser::ErrorString, parser.getInstructions()[parser.findInstruction(nameOffset)].error);
+
+    std::ostringstream disassembly;
+    spv::Disassemble(disassembly, spirv_binary);
+    EXPECT_NE(std::string::npos, disassembly.str().find("Name ERROR, literal string runs past the end"));
+    EXPECT_NE(std::string::npos, disassembly.str().find("FunctionEnd"));
+}
+
+// Each pass of remap() reports its runs and what it did to the module, for
+// that remap() alone.
+class RemapStatsTest : public RemapTest {
+};
+
+TEST_P(RemapStatsTest, CountsEachPass)
+{
+    std::vector<uint32_t> compiled;
+    loadOrCompile(GetParam(), compiled);
+    ASSERT_FALSE(compiled.empty());
+
+    typedef spv::spirvbin_t remapper_t;
+    remapper_t remapper(0 /*verbosity*/);
+    std::vector<uint32_t> spirv = compiled;
+    remapper.remap(spirv, GetParam().remapOpts);
+    ASSERT_FALSE(spirv.empty());
+
+    size_t removed = 0;
+    size_t idsMapped = 0;
+    for (int p = 0; p < remapper_t::PASS_COUNT; ++p) {
+        const remapper_t::Pass pass = remapper_t::Pass(p);
+        const remapper_t::passstats_t& stats = remapper.getPassStats(pass);
+        // DO_EVERYTHING leaves out the experimental OPT_FWD_LS.
+        EXPECT_EQ(pass == remapper_t::PASS_FWD_LOADSTORE ? 0 : 1, stats.runs) << remapper_t::getPassName(pass);
+        EXPECT_GE(stats.wordsBefore, stats.wordsAfter) << remapper_t::getPassName(pass);
+        EXPECT_GE(stats.seconds, 0.0);
+        removed += stats.wordsBefore - stats.wordsAfter;
+        idsMapped += stats.idsMapped;
+    }
+    const remapper_t::passstats_t& index = remapper.getPassStats(remapper_t::PASS_INDEX);
+    EXPECT_EQ(compiled.size(), index.wordsBefore);
+    EXPECT_EQ(compiled.size(), index.wordsAfter);
+    EXPECT_EQ(compiled.size() - spirv.size(), removed);
+    EXPECT_GT(remapper.getPassStats(remapper_t::PASS_STRIP_DEBUG).wordsMarked, 0u);
+    EXPECT_EQ(remapper.getPassStats(remapper_t::PASS_STRIP_DEBUG).wordsMarked,
+              remapper.getPassStats(remapper_t::PASS_STRIP).wordsBefore -
+              remapper.getPassStats(remapper_t::PASS_STRIP).wordsAfter);
+    EXPECT_EQ(0u, remapper.getPassStats(remapper_t::PASS_STRIP).wordsMarked);
+    EXPECT_EQ(0u, remapper.getPassStats(remapper_t::PASS_STRIP_DCE).wordsMarked);
+    EXPECT_GT(idsMapped, 0u);
+    EXPECT_EQ(0u, remapper.getPassStats(remapper_t::PASS_APPLY_MAP).idsMapped);
+
+    // Only the passes asked for run, and counts start over with each remap().
+    std::vector<uint32_t> unmapped = compiled;
+    remapper.remap(unmapped, remapper_t::NONE);
+    EXPECT_EQ(compiled, unmapped);
+    EXPECT_EQ(1, remapper.getPassStats(remapper_t::PASS_INDEX).runs);
+    EXPECT_EQ(1, remapper.getPassStats(remapper_t::PASS_STRIP).runs);
+    EXPECT_EQ(1, remapper.getPassStats(remapper_t::PASS_STRIP_DCE).runs);
+    EXPECT_EQ(compiled.size(), remapper.getPassStats(remapper_t::PASS_STRIP_DCE).wordsAfter);
+    EXPECT_EQ(0, remapper.getPassStats(remapper_t::PASS_STRIP_DEBUG).runs);
+    EXPECT_EQ(0, remapper.getPassStats(remapper_t::PASS_DCE_TYPES).runs);
+    EXPECT_EQ(0, remapper.getPassStats(remapper_t::PASS_APPLY_MAP).runs);
+    EXPECT_EQ(0u, remapper.getPassStats(remapper_t::PASS_MAP_NAMES).idsMapped);
+}
+
+INSTANTIATE_TEST_CASE_P(
+    ToSpirv, RemapStatsTest,
+    ::testing::Values(RemapTestArgs{ "remap.basic.everything.frag", "main", Source::GLSL, spv::spirvbin_t::DO_EVERYTHING }),
+    FileNameAsCustomTestSuffix
+);
+
 // clang-format off
 INSTANTIATE_TEST_CASE_P(
     ToSpirv, RemapTest,
@@ -161,4 +161,22 @@ std::string GetSuffix(const std::string& name)
     return (pos == std::string::npos) ? "" : name.substr(name.rfind('.') + 1);
 }
 
+glslang::TCompileJob MakeVulkanJob(const std::string& fileName, int priority)
+{
+    glslang::TCompileJob job;
+    job.stage = GetShaderStage(GetSuffix(fileName));
+    job.name = fileName;
+    job.source = ReadFile(GlobalTestSettings.testRoot + "/" + fileName).second;
+    job.setup = [](glslang::TShader& shader) {
+        shader.setEnvInput(glslang::EShSourceGlsl, shader.getStage(), glslang::EShClientVulkan, 100);
+        shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_0);
+        shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_0);
+    };
+    job.resources = &glslang::DefaultTBuiltInResource;
+    job.messages = static_cast<EShMessages>(EShMsgSpvRules | EShMsgVulkanRules);
+    job.priority = priority;
+
+    return job;
+}
+
 }  // namespace glslangtest
@@ -44,6 +44,7 @@
 
 #include <gtest/gtest.h>
 
+#include "SPIRV/CompileScheduler.h"
 #include "SPIRV/GlslangToSpv.h"
 #include "SPIRV/disassemble.h"
 #include "SPIRV/doc.h"
@@ -96,6 +97,9 @@ bool WriteFile(const std::string& path, const std::string& contents);
 // Returns the suffix of the given |name|.
 std::string GetSuffix(const std::string& name);
 
+// Returns a job compiling the file |fileName| under Test/ for Vulkan 1.0.
+glslang::TCompileJob MakeVulkanJob(const std::string& fileName, int priority = 0);
+
 // Base class for glslang integration tests. It contains many handy utility-like
 // methods such as reading shader source files, compiling into AST/SPIR-V, and
 // comparing with expected outputs.
@@ -0,0 +1,108 @@
+//
+// Copyright (C) 2018 LunarG, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+//    Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//    Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//    Neither the name of 3Dlabs Inc. Ltd. nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+//
+// Compiling on threads glslang didn't start.
+//
+
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "TestFixture.h"
+
+#ifdef GLSLANG_THREAD_LOCAL
+#include "glslang/Include/PoolAlloc.h"
+
+namespace glslang {
+extern thread_local TPoolAllocator* ThreadPoolAllocator;
+}
+#endif
+
+namespace glslangtest {
+namespace {
+
+// Threads compile without any set up of their own, each on its first use.
+TEST(ThreadTest, ShortLivedThreadsCompile)
+{
+    const glslang::TCompileJob job = MakeVulkanJob("spv.310.comp");
+    const glslang::TCompileResult expected = glslang::Compile(job);
+    ASSERT_TRUE(expected.success) << expected.log;
+
+    std::vector<glslang::TCompileResult> results(16);
+    for (size_t round = 0; round < results.size(); round += 4) {
+        std::vector<std::thread> threads;
+        for (size_t r = round; r < round + 4; ++r)
+            threads.push_back(std::thread([&job, &results, r]() { results[r] = glslang::Compile(job); }));
+        for (std::thread& thread : threads)
+            thread.join();
+    }
+    for (const glslang::TCompileResult& result : results) {
+        EXPECT_EQ(expected.log, result.log);
+        EXPECT_EQ(expected.spirv, result.spirv);
+    }
+}
+
+#ifdef GLSLANG_THREAD_LOCAL
+// Built with ENABLE_THREAD_LOCAL, each thread's current pool starts out null
+// rather than through InitThread(), and setting it affects only that thread.
+TEST(ThreadTest, ThreadLocalPoolStartsNullInEachThread)
+{
+    glslang::TPoolAllocator* const previous = glslang::ThreadPoolAllocator;
+    glslang::TPoolAllocator mainPool;
+    glslang::SetThreadPoolAllocator(&mainPool);
+
+    const glslang::TCompileJob job = MakeVulkanJob("spv.310.comp");
+    bool startedNull = false;
+    bool setOwnPool = false;
+    glslang::TCompileResult result;
+    std::thread thread([&]() {
+        startedNull = glslang::ThreadPoolAllocator == nullptr;
+        result = glslang::Compile(job);
+        setOwnPool = glslang::ThreadPoolAllocator != nullptr && glslang::ThreadPoolAllocator != &mainPool;
+    });
+    thread.join();
+
+    EXPECT_TRUE(startedNull);
+    EXPECT_TRUE(setOwnPool);
+    EXPECT_TRUE(result.success) << result.log;
+    EXPECT_EQ(&mainPool, glslang::ThreadPoolAllocator);
+
+    glslang::SetThreadPoolAllocator(previous);
+}
+#endif
+
+}  // anonymous namespace
+}  // namespace glslangtest
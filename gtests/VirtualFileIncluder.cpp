@@ -0,0 +1,137 @@
+//
+// Copyright (C) 2018 LunarG, Inc.
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//
+//    Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//
+//    Redistributions in binary form must reproduce the above
+//    copyright notice, this list of conditions and the following
+//    disclaimer in the documentation and/or other materials provided
+//    with the distribution.
+//
+//    Neither the name of 3Dlabs Inc. Ltd. nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+// FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+// COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+// BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+// ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+
+//
+// Resolving #includes with TVirtualFileIncluder.
+//
+
+#include <future>
+
+#include <gtest/gtest.h>
+
+#include "TestFixture.h"
+
+namespace glslangtest {
+namespace {
+
+// Includes resolve from memory and from directory roots, without copying
+// contents, for compiles on several threads sharing one includer.
+TEST(VirtualFileIncluderTest, ResolvesFromMemoryAndRoots)
+{
+    EXPECT_EQ("a/b/d", glslang::TVirtualFileIncluder::normalize("a\\b/./c/../d"));
+    EXPECT_EQ("/x/z", glslang::TVirtualFileIncluder::normalize("//x/y/../z/"));
+    EXPECT_EQ("../a", glslang::TVirtualFileIncluder::normalize("../a"));
+
+    static const char util[] = "#ifndef UTIL_H\n#define UTIL_H\nfloat util() { return 1.0; }\n#endif\n";
+    glslang::TVirtualFileIncluder includer;
+    EXPECT_TRUE(includer.addFile("lib/util.h", util, sizeof(util) - 1));
+    EXPECT_TRUE(includer.addFile("shaders\\common.h", "#include \"../lib/util.h\"\n"
+                                                      "float twice() { return 2.0 * util(); }\n"));
+    EXPECT_FALSE(includer.addFile("shaders/./common.h", ""));
+    includer.addSearchDirectory("lib");
+
+    glslang::TShader::Includer::IncludeResult* result = includer.includeSystem("util.h", "shaders/main.comp", 1);
+    ASSERT_NE(nullptr, result);
+    EXPECT_EQ("lib/util.h", result->headerName);
+    EXPECT_EQ(util, result->headerData);
+    includer.releaseInclude(result);
+    EXPECT_EQ(nullptr, includer.includeLocal("util.h", "shaders/main.comp", 1));
+    EXPECT_EQ(nullptr, includer.includeSystem("missing.h", "shaders/main.comp", 1));
+
+    glslang::TCompileJob job = MakeVulkanJob("spv.310.comp");
+    job.name = "shaders/main.comp";
+    job.source = "#version 450\n"
+                 "#extension GL_GOOGLE_include_directive : require\n"
+                 "#include \"common.h\"\n"
+                 "#include <util.h>\n"
+                 "layout(local_size_x = 1) in;\n"
+                 "layout(std430, binding = 0) buffer Out { float f; };\n"
+                 "void main() { f = twice() + util(); }\n";
+    job.includer = &includer;
+    const glslang::TCompileResult expected = glslang::Compile(job);
+    ASSERT_TRUE(expected.success) << expected.log;
+
+    glslang::TCompileScheduler scheduler(4);
+    std::vector<std::future<glslang::TCompileResult>> results;
+    for (int j = 0; j < 16; ++j)
+        results.push_back(scheduler.submit(job));
+    for (auto& future : results) {
+        const glslang::TCompileResult result = future.get();
+        EXPECT_EQ(expected.log, result.log);
+        EXPECT_EQ(expected.spirv, result.spirv);
+    }
+
+    // Files under a root, where "parent.h" is found through the search
+    // directory at the top, rather than beside its includer inc1/bar.h.
+    glslang::TVirtualFileIncluder rootIncluder;
+    rootIncluder.addRoot(GlobalTestSettings.testRoot);
+    rootIncluder.addSearchDirectory(".");
+    const std::string source = ReadFile(GlobalTestSettings.testRoot + "/include.vert").second;
+    const char* text = source.c_str();
+    const char* name = "include.vert";
+    const int length = (int)source.size();
+    glslang::TShader shader(EShLangVertex);
+    shader.setStringsWithLengthsAndNames(&text, &length, &name, 1);
+    EXPECT_TRUE(shader.parse(&glslang::DefaultTBuiltInResource, 100, false, EShMsgDefault, rootIncluder))
+        << shader.getInfoLog();
+}
+
+// Nothing outside the roots is read: not through an absolute path, nor
+// through ".." above the top, and directories aren't taken as files.
+TEST(VirtualFileIncluderTest, StaysUnderRoots)
+{
+    glslang::TVirtualFileIncluder includer;
+    includer.addRoot(GlobalTestSettings.testRoot + "/inc1");
+    includer.addSearchDirectory(".");
+
+    glslang::TShader::Includer::IncludeResult* result = includer.includeLocal("foo.h", "main.vert", 1);
+    ASSERT_NE(nullptr, result);
+    includer.releaseInclude(result);
+
+    EXPECT_EQ(nullptr, includer.includeLocal("../include.vert", "main.vert", 1));
+    EXPECT_EQ(nullptr, includer.includeLocal("../../Test/include.vert", "a/main.vert", 1));
+    EXPECT_EQ(nullptr, includer.includeSystem("../include.vert", "main.vert", 1));
+    const std::string absolute = GlobalTestSettings.testRoot + "/include.vert";
+    if (absolute[0] == '/') {
+        EXPECT_EQ(nullptr, includer.includeLocal(absolute.c_str(), "main.vert", 1));
+        EXPECT_EQ(nullptr, includer.includeSystem(absolute.c_str(), "main.vert", 1));
+    }
+
+    EXPECT_EQ(nullptr, includer.includeLocal("path1", "main.vert", 1));
+    EXPECT_EQ(nullptr, includer.includeLocal(".", "main.vert", 1));
+}
+
+}  // anonymous namespace
+}  // namespace glslangtest
@@ -5278,8 +5278,11 @@ TIntermTyped* HlslParseContext::handleFunctionCall(const TSourceLoc& loc, TFunct
             }
         }
 
-        if (fnCandidate == nullptr)
+        if (fnCandidate == nullptr) {
             fnCandidate = findFunction(loc, *function, builtIn, thisDepth, arguments);
+            if (fnCandidate != nullptr)
+                GLSLANG_COUNT(intermediate.getCompileStats(), overloadResolutions, 1);
+        }
 
         if (fnCandidate) {
             // This is a declared function that might map to